@@ -1,5 +1,6 @@
 #include <string.h>
 #include <memory.h>
+#include <platform/clock.h>
 #include <platform/log.h>
 #include <pjson.h>
 #include "adapter_price.h"
@@ -10,7 +11,149 @@ namespace example {
 PriceAdapter::PriceAdapter(fin::interface::StockDataObserver *observer)
   : fin::BaseStockDataConnector(observer)
   , m_started(false)
-{ }
+  , m_depthScanner(true)
+  , m_jsonIndex(false)
+  , m_workerQueueSize(0)
+  , m_workerQueueFull(platform::QueueFullPolicy::Grow)
+  , m_workerWait(platform::QueueWait::Yield)
+  , m_workerSpins(0)
+{
+  m_entries.reserve(400);
+}
+
+PriceAdapter::~PriceAdapter()
+{
+  stop();
+  stopWorkers();
+}
+
+// Frame copy queued to a parse worker, returns the buffer to the pool when done.
+// Small enough to be stored in the worker's ring slot; moved, never copied, so the buffer is released once
+class PriceAdapter::FrameTask
+{
+public:
+  FrameTask(PriceAdapter *adapter, std::string *frame, unsigned long netTime)
+    : m_adapter(adapter)
+    , m_frame(frame)
+    , m_netTime(netTime)
+  { }
+
+  FrameTask(FrameTask &&other)
+    : m_adapter(other.m_adapter)
+    , m_frame(other.m_frame)
+    , m_netTime(other.m_netTime)
+  {
+    other.m_frame = nullptr;
+  }
+
+  ~FrameTask() {
+    if(m_frame) {
+      m_adapter->m_framePool.release(m_frame);
+    }
+  }
+
+  void operator ()(platform::TaskQueue *queue) {
+    try {
+      m_adapter->processFrame(&(*m_frame)[0], m_frame->size(), m_netTime, static_cast<ParseWorker*>(queue)->entries);
+    } catch(std::exception &e) {
+      m_adapter->setConnectorError(std::current_exception());
+    }
+  }
+
+private:
+  FrameTask(const FrameTask &) = delete;
+  void operator =(const FrameTask &) = delete;
+
+  PriceAdapter *m_adapter;
+  std::string *m_frame;
+  unsigned long m_netTime;
+};
+
+// Marks the frames queued to a worker before it as parsed. The state tells whether it ran,
+// or was destroyed unrun because the ring was full under QueueFullPolicy::Drop or the worker stopped
+class PriceAdapter::DrainTask
+{
+public:
+  enum State { Pending, Ran, Dropped };
+
+  DrainTask(std::atomic<int> *state)
+    : m_state(state)
+  { }
+
+  DrainTask(DrainTask &&other)
+    : m_state(other.m_state)
+  {
+    other.m_state = nullptr;
+  }
+
+  ~DrainTask() {
+    if(m_state) {
+      m_state->store(Dropped, std::memory_order_release);
+    }
+  }
+
+  void operator ()(platform::TaskQueue *) {
+    m_state->store(Ran, std::memory_order_release);
+    m_state = nullptr;
+  }
+
+private:
+  DrainTask(const DrainTask &) = delete;
+  void operator =(const DrainTask &) = delete;
+
+  std::atomic<int> *m_state;
+};
+
+/**
+ * Starts threads parsing WebSocket frames. Frames of one channel always go to the same worker,
+ * so updates of an instrument keep their order.
+ * @param count number of worker threads
+ */
+void PriceAdapter::startWorkers(int count)
+{
+  stopWorkers();
+  for(int i = 0; i < count; i ++) {
+    ParseWorker *worker = new ParseWorker(m_workerQueueSize, m_workerQueueFull);
+    worker->setWait(m_workerWait, m_workerSpins);
+    worker->setName("parse-" + std::to_string(i));
+    m_workers.emplace_back(worker);
+    m_workerThreads.emplace_back([worker]() { worker->run(); });
+    // Queue is usable only after run() has registered its thread
+    while(!worker->running()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void PriceAdapter::stopWorkers()
+{
+  for(auto &worker : m_workers) {
+    worker->stop();
+  }
+  for(auto &thread : m_workerThreads) {
+    thread.join();
+  }
+  m_workerThreads.clear();
+  m_workers.clear();
+}
+
+/**
+ * Waits until the workers have parsed every frame queued so far, so data invalidated
+ * after it is not rebuilt from frames received before.
+ */
+void PriceAdapter::drainWorkers()
+{
+  for(auto &worker : m_workers) {
+    std::atomic<int> state(DrainTask::Dropped);
+    while(state.load(std::memory_order_acquire) == DrainTask::Dropped && worker->running()) {
+      state.store(DrainTask::Pending, std::memory_order_relaxed);
+      worker->post(DrainTask(&state));
+      while(state.load(std::memory_order_acquire) == DrainTask::Pending) {
+        std::this_thread::yield();
+      }
+    }
+  }
+}
 
 /**
  * Implementation of the subscribe method of the interface
@@ -19,31 +162,126 @@ PriceAdapter::PriceAdapter(fin::interface::StockDataObserver *observer)
  */
 void PriceAdapter::subscribe(const fin::InstrumentsList& instruments)
 {
+  std::vector<std::string> channels;
+  std::vector<std::pair<std::string, fin::ChannelRouter::Route>> routes;
+  {
   std::lock_guard<std::mutex> lock(m_subscriptionLock);
   for(auto instrumentHandle : instruments) {
     auto instrument = m_exchangeDictionary.instrumentToExchange(instrumentHandle);
     if(instrument != nullptr) {
-      WSPriceConnector::subscribe(instrument);
+      channels.push_back(std::string("ok_sub_spot_") + instrument + "_depth");
+      routes.push_back(std::make_pair(channels.back(), fin::ChannelRouter::Route{ instrumentHandle, fin::ChannelRouter::Kind::Depth }));
+      if(m_candleSticks) {
+        channels.push_back(std::string("ok_sub_spot_") + instrument + "_deals");
+        routes.push_back(std::make_pair(channels.back(), fin::ChannelRouter::Route{ instrumentHandle, fin::ChannelRouter::Kind::Trades }));
+      }
       m_subscriptions.push_back(instrumentHandle);
     } else {
       platform::LogError() << "no mapping for instrument " << instrumentHandle;
     }
   }
+  }
+  // Routes go first, so frames arriving right after the subscription are recognized
+  m_channels.add(routes);
+  // One call, so channels are coalesced into as few addChannel frames as configured
+  subscribeChannels(channels);
+
+  if(m_bookSync) {
+    for(auto instrumentHandle : instruments) {
+      if(m_exchangeDictionary.instrumentToExchange(instrumentHandle) != nullptr) {
+        m_bookSync->sync(instrumentHandle);
+      }
+    }
+  }
+}
+
+/**
+ * Requests depth snapshot for the orderbook synchronization, the response goes to onDepthResponse
+ */
+bool PriceAdapter::requestSnapshot(fin::InstrumentHandle instr)
+{
+  auto instrument = m_exchangeDictionary.instrumentToExchange(instr);
+  if(instrument == nullptr) {
+    return false;
+  }
+  // The response handlers own the context once the request is sent; getDepth throws only before that,
+  // e.g. without an HttpClient, and the instrument stays unsynchronized then
+  std::unique_ptr<SnapshotRequest> context(new SnapshotRequest(platform::Clock::instance().now() / 1000000, m_bookSync->getGeneration()));
+  try {
+    bool sent = getDepth(instrument, 200, context.get());
+    if(sent) {
+      context.release();
+    }
+    return sent;
+  } catch(std::exception &e) {
+    platform::LogWarning() << "Depth snapshot request for " << instrument << " failed: " << e.what();
+    return false;
+  }
+}
+
+// Synchronized snapshots replace the book, deltas are passed as they are
+void PriceAdapter::onBookSyncOutput(fin::InstrumentHandle instr, fin::OrderBookSpan entries, bool snapshot, fin::ProfilingTag tag)
+{
+  if(snapshot) {
+    invalidateData(instr, tag);
+  }
+  addOrderbookSpan(entries, tag);
+  if(m_candleSticks) {
+    m_candleSticks->onOrderbook(entries, snapshot, tag.timestamp / 1000000);
+  }
+}
+
+fin::OrderBookSync::Stats PriceAdapter::getBookSyncStats()
+{
+  return m_bookSync ? m_bookSync->getStats() : fin::OrderBookSync::Stats();
 }
 
 void PriceAdapter::onDepthResponse(std::string data, const char *symbol, connector::example::RequestContext *userdata)
 {
   auto instr = m_exchangeDictionary.instrumentFromExchange(symbol);
+  std::unique_ptr<SnapshotRequest> snapshot(dynamic_cast<SnapshotRequest*>(userdata));
+
+  auto lease = m_jsonPool.acquire();
+  if(m_jsonIndex) {
+    platform::JsonIndex &doc = lease.index();
+    doc.deserialize_in_place(const_cast<char*>(data.c_str()), data.size());
+    processDepthResponse<platform::JsonValue>(doc, instr, snapshot.get());
+  } else {
+    pjson::document &doc = *lease;
+    doc.deserialize_in_place(const_cast<char*>(data.c_str()));
+    processDepthResponse<pjson::value_variant>(doc, instr, snapshot.get());
+  }
+}
 
-  pjson::document doc;
-  doc.deserialize_in_place(const_cast<char*>(data.c_str()));
+template<typename Value>
+void PriceAdapter::processDepthResponse(const Value &doc, fin::InstrumentHandle instr, SnapshotRequest *snapshot)
+{
+  // Errors come back as objects too, e.g. {"error_code":...}; applying one would leave an empty book
+  const bool depth = doc.is_object() && doc.has_key("asks") && doc["asks"].is_array() &&
+                     doc.has_key("bids") && doc["bids"].is_array();
+  if(snapshot && m_bookSync) {
+    if(!depth || instr == fin::NoInstrument) {
+      m_bookSync->onSnapshotFailed(instr, snapshot->generation);
+      return;
+    }
+    // Versions are local times, deltas carry their receive time: the snapshot contains at least the deltas
+    // received before the request was issued. Deltas received between the request and the response may or may not
+    // be in it; they are all replayed, which is harmless as their amounts are absolute. The exchange timestamp
+    // of the response is not used, it comes from another clock than the receive times.
+    fin::ProfilingTag tag;
+    fin::OrderBookList entries;
+    parseLevels(time(NULL) * 1000, instr, doc, entries);
+    m_bookSync->onSnapshot(instr, snapshot->generation, snapshot->issued, entries, tag);
+    return;
+  }
 
-  if(doc.is_object()) {
+  if(depth) {
     invalidateData(instr); // We got full depth
     long timestamp = time(NULL) * 1000;
     fin::ProfilingTag tag;
+    fin::OrderBookList entries; // REST responses may come from several HttpClient threads
     // Parse response
-    parseData(timestamp, tag.timestamp, instr, doc);
+    parseData(timestamp, tag.timestamp, instr, doc, entries, true);
   }
 }
 
@@ -60,31 +298,56 @@ void PriceAdapter::onKlineResponse(std::string data, const char *symbol, connect
 {
   using namespace pjson;
   auto instr = m_exchangeDictionary.instrumentFromExchange(symbol);
-  unsigned long interval = reinterpret_cast<RequestedInterval*>(userdata)->interval;
+  unsigned long interval = static_cast<RequestedInterval*>(userdata)->interval;
   delete userdata;
 
-  document doc;
+  auto lease = m_jsonPool.acquire();
+  document &doc = *lease;
   doc.deserialize_in_place(const_cast<char*>(data.c_str()));
 
+  if(!doc.is_array()) {
+    return;
+  }
+
+  fin::CandleStickSeries *series = nullptr;
+  if(m_candleStickStore && instr != fin::NoInstrument) {
+    try {
+      series = &m_candleStickStore->series(instr, interval);
+    } catch(std::exception &e) {
+      platform::LogError() << "Candlestick store: " << e.what();
+    }
+  }
+
   fin::CandleStickEntry entry;
 
   for (unsigned int i = 0; i < doc.size(); i ++) {
     const auto &cs = doc[i];
     entry.instrument = instr;
     entry.timestamp = cs[0].as_int64();
-    entry.interval = (intptr_t)userdata;
+    entry.interval = interval;
     entry.open.assign(cs[1].as_double());
     entry.high.assign(cs[2].as_double());
     entry.low.assign(cs[3].as_double());
     entry.close.assign(cs[4].as_double());
     entry.volume.assign(cs[5].as_double());
 
+    if(series) {
+      series->append(entry);
+    }
     addCandleStickEntry(std::move(entry));
   }
 }
 
 void PriceAdapter::onHTTPError(std::string symbol, const platform::HttpResponse *r, connector::example::RequestContext *userdata)
 {
+  // Failed snapshot is requested again, the connector stays usable meanwhile
+  std::unique_ptr<SnapshotRequest> snapshot(dynamic_cast<SnapshotRequest*>(userdata));
+  if(snapshot && m_bookSync) {
+    platform::LogWarning() << "Depth snapshot of " << symbol << " failed, retrying";
+    m_bookSync->onSnapshotFailed(m_exchangeDictionary.instrumentFromExchange(symbol.c_str()), snapshot->generation);
+    return;
+  }
+
   try {
     // Try to repeat???
     throw std::runtime_error("Connector HTTP error");
@@ -95,6 +358,13 @@ void PriceAdapter::onHTTPError(std::string symbol, const platform::HttpResponse
 
 void PriceAdapter::onTimeout(std::string symbol, connector::example::RequestContext *userdata)
 {
+  std::unique_ptr<SnapshotRequest> snapshot(dynamic_cast<SnapshotRequest*>(userdata));
+  if(snapshot && m_bookSync) {
+    platform::LogWarning() << "Depth snapshot of " << symbol << " timed out, retrying";
+    m_bookSync->onSnapshotFailed(m_exchangeDictionary.instrumentFromExchange(symbol.c_str()), snapshot->generation);
+    return;
+  }
+
   try {
     throw std::runtime_error("HTTP response timeout");
   } catch(std::exception &e) {
@@ -109,64 +379,79 @@ void PriceAdapter::onTimeout(std::string symbol, connector::example::RequestCont
  */
 void PriceAdapter::fetchStack(fin::InstrumentHandle symbol)
 {
+  if(m_bookSync) {
+    m_bookSync->sync(symbol);
+    return;
+  }
   auto instrument = m_exchangeDictionary.instrumentToExchange(symbol);
   getDepth(instrument, 200);
 }
 
 /**
  * Implementation of the fetchCandleSticks method of the interface
+ * Bars already in the candlestick store are emitted right away, only the missing tail is requested.
+ * A gap in the stored bars, left by downtime, ends the stored part: everything from the gap on is requested.
+ * If the store starts after since, the whole range is requested instead, as bars older than the store can not be added to it.
  * @param symbol The handle to the instrument to get candlesticks for
  * @param interval The interval for candlesticks (in seconds)
- * @param since The starting timestamp (in seconds)
+ * @param since The starting timestamp (in exchange units, milliseconds)
  * @see fin::interface::StockDataConnector::fetchCandleSticks(fin::InstrumentHandle, long, long)
  */
 void PriceAdapter::fetchCandleSticks(fin::InstrumentHandle symbol, long interval, long since)
 {
+  // Exchange kline types, the smallest one covering requested interval is used
+  static const struct {
+    long seconds;
+    const char *type;
+  } klineTypes[] = {
+    {60, "1min"}, {180, "3min"}, {300, "5min"}, {900, "15min"}, {1800, "30min"},
+    {3600, "1hour"}, {7200, "2hour"}, {14400, "4hour"}, {21600, "6hour"}, {43200, "12hour"},
+    {86400, "day"}, {604800, "week"}
+  };
+
   auto instrument = m_exchangeDictionary.instrumentToExchange(symbol);
-  std::string suffix = "min";
-  int number = 0;
-  std::vector<int> minutes({1, 3, 5, 15, 30});
-  std::vector<int> hours({1, 2, 4, 6, 12});
-  std::string type;
-
-  for(auto minute : minutes) {
-    if(interval <= minute * 60) {
-      number = minute;
+  const char *type = nullptr;
+  long barInterval = 0;
+
+  for(const auto &klineType : klineTypes) {
+    if(interval <= klineType.seconds) {
+      type = klineType.type;
+      barInterval = klineType.seconds;
       break;
     }
   }
-  if(!number) {
-    interval /= 60;
-    suffix = "hour";
-    for(auto hour : hours) {
-      if(interval <= hour * 60) {
-        number = hour;
-        type = boost::lexical_cast<std::string>(number) + suffix;
-        break;
-      }
-    }
+
+  if(!type) {
+    return;
   }
 
-  if(!number) {
-    interval /= 60; // hours
-    suffix = "day";
-    if(interval <= 24) {
-      type = suffix;
-      number = 1;
-    }
-    else {
-      interval /= 24; // days
-      suffix = "week";
-      type = suffix;
-      number = 1;
-      
-      if(interval > 7) {
-        return;
+  if(m_candleStickStore) {
+    try {
+      auto &series = m_candleStickStore->series(symbol, barInterval);
+      auto stored = series.range(since);
+      if(!stored.empty() && stored.timestamp[0] > since + barInterval * 1000) {
+        stored = fin::CandleStickColumns();
+      }
+      if(!stored.empty()) {
+        // Only the bars up to the first gap are used, the store misses the bars of the downtime after it
+        size_t contiguous = 1;
+        while(contiguous < stored.size &&
+              stored.timestamp[contiguous] - stored.timestamp[contiguous - 1] <= barInterval * 1000) {
+          contiguous ++;
+        }
+        // The last stored bar may have been open when it was saved, or be rewritten by a response meanwhile,
+        // so it is requested again rather than read; so is the bar before a gap, which the request starts from
+        for(size_t i = 0; i + 1 < contiguous; i ++) {
+          addCandleStickEntry(stored.entry(i, symbol, barInterval));
+        }
+        since = stored.timestamp[contiguous - 1];
       }
+    } catch(std::exception &e) {
+      platform::LogError() << "Candlestick store: " << e.what();
     }
   }
 
-  getKline(instrument, type.c_str(), 200, since, new RequestedInterval(interval));
+  getKline(instrument, type, 200, since, new RequestedInterval(barInterval));
 }
 
 /**
@@ -215,6 +500,113 @@ void PriceAdapter::config(std::string conf)
           fin::InstrumentRegistry::instance().findInstrument(symbolA, symbolB));
     }
   }
+
+  if(doc.has_key("ws-url")) {
+    setUrl(doc["ws-url"].as_string_ptr());
+  }
+
+  // Redundant connections, one per entry, each entry is the local interface to connect from ("" for the default one)
+  if(doc.has_key("ws-legs")) {
+    const auto &legs = doc["ws-legs"];
+    for(unsigned int i = 0; i < legs.size(); i ++) {
+      addLeg(legs[i].as_string_ptr());
+    }
+  }
+
+  // Channels per addChannel frame, frame size limit in bytes and frames per second at most
+  if(doc.has_key("ws-subscribe-batch")) {
+    setSubscriptionBatch(doc["ws-subscribe-batch"].as_int64(), doc.has_key("ws-subscribe-frame-size") ? doc["ws-subscribe-frame-size"].as_int64() : 0);
+  }
+
+  if(doc.has_key("ws-subscribe-rate")) {
+    setSubscriptionRate(doc["ws-subscribe-rate"].as_double());
+  }
+
+  if(doc.has_key("ws-compression")) {
+    setCompression(doc["ws-compression"].as_bool());
+  }
+
+  // DOM parser: "pjson" (default) or "index" for the SIMD structural index parser,
+  // whose kernel may be forced with "json-index-backend": "avx2", "sse2" or "scalar"
+  if(doc.has_key("json-parser")) {
+    m_jsonIndex = !strcmp(doc["json-parser"].as_string_ptr(), "index");
+  }
+  if(doc.has_key("json-index-backend")) {
+    const char *backend = doc["json-index-backend"].as_string_ptr();
+    m_jsonPool.setIndexBackend(!strcmp(backend, "avx2") ? platform::JsonIndex::Backend::AVX2 :
+                               !strcmp(backend, "sse2") ? platform::JsonIndex::Backend::SSE2 :
+                               !strcmp(backend, "scalar") ? platform::JsonIndex::Backend::Scalar : platform::JsonIndex::Backend::Auto);
+  }
+
+  // Set to false to parse every frame with the generic DOM parser
+  if(doc.has_key("depth-scanner")) {
+    m_depthScanner = doc["depth-scanner"].as_bool();
+  }
+
+  if(doc.has_key("rest-url")) {
+    setBaseUrl(doc["rest-url"].as_string_ptr());
+  }
+
+  // Subscribed instruments start from a REST snapshot, WebSocket deltas are buffered meanwhile and replayed over it.
+  // Snapshots are requested in parallel, at most "depth-sync-concurrency" at once.
+  if(doc.has_key("depth-sync") && doc["depth-sync"].as_bool()) {
+    size_t concurrency = doc.has_key("depth-sync-concurrency") ? doc["depth-sync-concurrency"].as_int64() : 4;
+    size_t buffer = doc.has_key("depth-sync-buffer") ? doc["depth-sync-buffer"].as_int64() : 1024;
+    m_bookSync.reset(new fin::OrderBookSync([this](fin::InstrumentHandle instr) { return requestSnapshot(instr); },
+                                            [this](fin::InstrumentHandle instr, fin::OrderBookSpan entries, bool snapshot, fin::ProfilingTag tag) {
+                                              onBookSyncOutput(instr, entries, snapshot, tag);
+                                            },
+                                            concurrency, buffer));
+  }
+
+  // Frames are handed to the workers through a lock-free ring of "parse-queue-size" frames instead of the spinlock queue.
+  // When a ring is full "parse-queue-full" decides: "grow" (default) to an overflow list, "block" the WebSocket thread or "drop" the frame
+  if(doc.has_key("parse-queue-size")) {
+    m_workerQueueSize = doc["parse-queue-size"].as_int64();
+  }
+  if(doc.has_key("parse-queue-full")) {
+    const char *policy = doc["parse-queue-full"].as_string_ptr();
+    m_workerQueueFull = !strcmp(policy, "block") ? platform::QueueFullPolicy::Block :
+                        !strcmp(policy, "drop") ? platform::QueueFullPolicy::Drop : platform::QueueFullPolicy::Grow;
+  }
+
+  // Idle workers "spin", "yield" (default) or "park" until the WebSocket thread wakes them,
+  // after checking their queue "parse-queue-spins" times
+  if(doc.has_key("parse-queue-wait")) {
+    const char *wait = doc["parse-queue-wait"].as_string_ptr();
+    m_workerWait = !strcmp(wait, "spin") ? platform::QueueWait::BusySpin :
+                   !strcmp(wait, "park") ? platform::QueueWait::Park : platform::QueueWait::Yield;
+  }
+  if(doc.has_key("parse-queue-spins")) {
+    m_workerSpins = doc["parse-queue-spins"].as_int64();
+  }
+
+  // Parse frames on worker threads instead of the WebSocket thread.
+  // The observer then receives updates of different instruments concurrently.
+  if(doc.has_key("parse-workers")) {
+    startWorkers(doc["parse-workers"].as_int64());
+  }
+
+  // Directory for the candlestick history, fetchCandleSticks only requests bars missing there.
+  // "candlestick-store-capacity" is the number of rows of a new series, 2^20 by default.
+  if(doc.has_key("candlestick-store")) {
+    size_t capacity = doc.has_key("candlestick-store-capacity") ? doc["candlestick-store-capacity"].as_int64() : 1 << 20;
+    m_candleStickStore.reset(new fin::CandleStickStore(doc["candlestick-store"].as_string_ptr(), capacity));
+  }
+
+  // Intervals (in seconds) of candlesticks built locally from trades and top of book
+  if(doc.has_key("candlesticks")) {
+    const auto &intervals = doc["candlesticks"];
+    m_candleSticks.reset(new fin::CandleStickAggregator([this](fin::CandleStickEntry entry) {
+                                                          addCandleStickEntry(std::move(entry));
+                                                        }));
+    for(unsigned int i = 0; i < intervals.size(); i ++) {
+      m_candleSticks->addInterval(intervals[i].as_int64());
+    }
+    m_candleStickTimer.reset(platform::TimerService::instance().createTimer([this](platform::Timer*) {
+                                                                              closeCandleSticks();
+                                                                            }));
+  }
 }
 
 /**
@@ -231,6 +623,9 @@ void PriceAdapter::start()
     m_subscriptions.swap(subscriptions);
     }
     subscribe(subscriptions);
+    if(m_candleStickTimer) {
+      m_candleStickTimer->start(std::chrono::seconds(1));
+    }
     m_started = true;
   } catch(std::exception &e) {
     setConnectorError(std::current_exception());
@@ -243,20 +638,104 @@ void PriceAdapter::start()
  */
 void PriceAdapter::stop()
 {
+  if(m_candleStickTimer) {
+    m_candleStickTimer->stop();
+  }
   WSPriceConnector::stop();
 }
 
+/**
+ * Emits candlesticks whose interval is over, even if the instrument had no updates since
+ */
+void PriceAdapter::closeCandleSticks()
+{
+  m_candleSticks->closeExpired(platform::Clock::instance().now() / 1000000);
+  m_candleStickTimer->start(std::chrono::seconds(1));
+}
+
+// FNV-1a hash of the channel name, frames start with [{"binary":0,"channel":"...
+static inline size_t channelHash(const char *msg, size_t size)
+{
+  static const char key[] = "\"channel\":\"";
+  const char *p = (const char*)memmem(msg, std::min<size_t>(size, 64), key, sizeof(key) - 1);
+  if(!p) {
+    return 0;
+  }
+
+  uint32_t hash = 2166136261u;
+  for(p += sizeof(key) - 1; p < msg + size && *p != '"'; p ++) {
+    hash = (hash ^ (unsigned char)*p) * 16777619u;
+  }
+  return hash;
+}
+
 void PriceAdapter::onData(const char *msg, size_t size, unsigned long netTime)
 {
-  using namespace pjson;
+  if(!m_workers.empty()) {
+    // The WebSocket thread only copies the frame, parsing happens on the worker owning the channel
+    std::string *frame = m_framePool.acquire();
+    frame->assign(msg, size);
+    m_workers[channelHash(msg, size) % m_workers.size()]->post(FrameTask(this, frame, netTime));
+    return;
+  }
 
   if(size) {
     const_cast<char*>(msg)[size] = '\0';
   }
+  processFrame(const_cast<char*>(msg), size, netTime, m_entries);
+}
 
-  document doc;
-  doc.deserialize_in_place(const_cast<char*>(msg));
+/**
+ * Parses a NUL terminated frame in place and passes the updates to the observer
+ * @param msg frame text, modified by the parser
+ * @param size frame size
+ * @param netTime frame receive time in nanoseconds
+ * @param entries buffer for the orderbook entries, owned by the calling thread
+ */
+void PriceAdapter::processFrame(char *msg, size_t size, unsigned long netTime, fin::OrderBookList &entries)
+{
+  using namespace pjson;
 
+  if(m_depthScanner) {
+    DepthScanner::Update updates[DepthScanner::MaxUpdates];
+    entries.resize(0);
+    int count = DepthScanner::scan(msg, size, netTime / 1000, updates, entries);
+    if(count >= 0) {
+      for(int i = 0; i < count; i ++) {
+        const fin::ChannelRouter::Route *route = m_channels.find(updates[i].channel, updates[i].channelSize);
+        if(!route || route->kind != fin::ChannelRouter::Kind::Depth) {
+          continue;
+        }
+        fin::InstrumentHandle instrument = route->instrument;
+        fin::OrderBookEntry *first = entries.data() + updates[i].first;
+        for(size_t n = 0; n < updates[i].count; n ++) {
+          first[n].instrument = instrument;
+        }
+        deliverDepth(instrument, netTime, fin::OrderBookSpan(first, updates[i].count), false);
+      }
+      return;
+    }
+  }
+
+  auto lease = m_jsonPool.acquire();
+  if(m_jsonIndex) {
+    platform::JsonIndex &doc = lease.index();
+    doc.deserialize_in_place(msg, size);
+    processDocument<platform::JsonValue>(doc, netTime, entries);
+  } else {
+    document &doc = *lease;
+    doc.deserialize_in_place(msg);
+    processDocument<value_variant>(doc, netTime, entries);
+  }
+}
+
+/**
+ * Passes the updates of a parsed frame to the observer
+ * @param doc frame document, strings are modified
+ */
+template<typename Value>
+void PriceAdapter::processDocument(const Value &doc, unsigned long netTime, fin::OrderBookList &entries)
+{
   if(!doc.is_array()) {
     return;
   }
@@ -266,52 +745,102 @@ void PriceAdapter::onData(const char *msg, size_t size, unsigned long netTime)
       continue;
     }
 
-    auto &data = doc[n]["data"];
-
-    if(!data.is_object()) {
+    // Replies to addChannel and channels not subscribed to have no route
+    const fin::ChannelRouter::Route *route = m_channels.find(doc[n].as_string_ptr("channel"));
+    if(!route) {
       continue;
     }
 
-    const char *name = doc[n].as_string_ptr("channel");
-    char *divisor = const_cast<char*>(strrchr(name, '_'));
-
-    if(!divisor || (divisor - name) < 12) {
-      return;
+    const auto &data = doc[n]["data"];
+    switch(route->kind) {
+    case fin::ChannelRouter::Kind::Depth:
+      if(data.is_object()) {
+        parseData(netTime / 1000, netTime, route->instrument, data, entries, false);
+      }
+      break;
+    case fin::ChannelRouter::Kind::Trades:
+      if(m_candleSticks && data.is_array()) {
+        parseDeals(netTime, route->instrument, data);
+      }
+      break;
+    default:
+      break;
     }
+  }
+}
 
-    name += 12;
-    *divisor = 0;
-
-    fin::InstrumentHandle instrument = m_exchangeDictionary.instrumentFromExchange(name);
+template<typename Value>
+void PriceAdapter::parseData(long timestamp, unsigned long netTimestamp, fin::InstrumentHandle instr, const Value &data,
+                             fin::OrderBookList &entries, bool snapshot) {
+  if(instr != fin::NoInstrument) {
+    parseLevels(timestamp, instr, data, entries);
+    deliverDepth(instr, netTimestamp, entries, snapshot);
+  }
+}
 
-    if(instrument == fin::NoInstrument) {
-      continue;
+/**
+ * Passes depth update of one instrument to the observer
+ * @param netTimestamp receive time in nanoseconds, the version of the delta for depth sync
+ * @param snapshot true for a full depth response, false for a WebSocket delta
+ */
+void PriceAdapter::deliverDepth(fin::InstrumentHandle instr, unsigned long netTimestamp, fin::OrderBookSpan entries, bool snapshot)
+{
+  fin::ProfilingTag tag(netTimestamp);
+  if(m_bookSync) {
+    // Receive time orders the delta against the snapshots, which are versioned by their local request time
+    m_bookSync->onDelta(instr, netTimestamp / 1000000, entries, tag);
+  } else {
+    addOrderbookSpan(entries, tag);
+    // With depth sync the candlesticks follow the synchronized book, see onBookSyncOutput()
+    if(m_candleSticks) {
+      m_candleSticks->onOrderbook(entries, snapshot, netTimestamp / 1000000);
     }
-
-    parseData(netTime / 1000, netTime, instrument, data);
   }
 }
 
-void PriceAdapter::parseData(long timestamp, unsigned long netTimestamp, fin::InstrumentHandle instr, const pjson::value_variant &data) {
-  if(instr != fin::NoInstrument) {
-    fin::OrderBookList entries;
+template<typename Value>
+void PriceAdapter::parseLevels(long timestamp, fin::InstrumentHandle instr, const Value &data, fin::OrderBookList &entries)
+{
+  entries.resize(0); // Keeps capacity, so steady state parsing does not allocate
 
-    if (data.has_key("asks")) {
-      auto &arr = data["asks"];
-      processDirection(timestamp, fin::OrderDir::Ask, arr, instr, std::back_inserter(entries));
-    }
-    if (data.has_key("bids")) {
-      auto &arr = data["bids"];
-      processDirection(timestamp, fin::OrderDir::Bid, arr, instr, std::back_inserter(entries));
+  if (data.has_key("asks")) {
+    const auto &arr = data["asks"];
+    processDirection(timestamp, fin::OrderDir::Ask, arr, instr, std::back_inserter(entries));
+  }
+  if (data.has_key("bids")) {
+    const auto &arr = data["bids"];
+    processDirection(timestamp, fin::OrderDir::Bid, arr, instr, std::back_inserter(entries));
+  }
+}
+
+/**
+ * Passes trades to the candlestick aggregator
+ * Trade format: ["tid", "price", "amount", "HH:MM:SS", "bid|ask"]
+ */
+template<typename Value>
+void PriceAdapter::parseDeals(unsigned long netTimestamp, fin::InstrumentHandle instr, const Value &data)
+{
+  for(unsigned int i = 0; i < data.size(); i ++) {
+    const auto &deal = data[i];
+    if(!deal.is_array() || deal.size() < 3) {
+      continue;
     }
-    fin::ProfilingTag tag(netTimestamp);
-    addOrderbookBulk(std::move(entries), tag);
+    // Trade time has no date, so the receive time is used instead
+    m_candleSticks->onTrade(instr, strtod(deal[1].as_string_ptr(), NULL), strtod(deal[2].as_string_ptr(), NULL),
+                            netTimestamp / 1000000);
   }
 }
 
 void PriceAdapter::onClose()
 {
   platform::LogInfo() << "Connection closing";
+  drainWorkers();
+  if(m_bookSync) {
+    m_bookSync->reset();
+  }
+  if(m_candleSticks) {
+    m_candleSticks->resetBooks();
+  }
   invalidateData();
   if(m_started) {
     try {
@@ -325,6 +854,13 @@ void PriceAdapter::onClose()
 void PriceAdapter::onPingTimeout()
 {
   platform::LogError() << "Ping timeout!";
+  drainWorkers();
+  if(m_bookSync) {
+    m_bookSync->reset();
+  }
+  if(m_candleSticks) {
+    m_candleSticks->resetBooks();
+  }
   invalidateData();
   try {
     throw std::runtime_error("OKex connector ping timeout!");
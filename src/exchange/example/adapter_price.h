@@ -3,13 +3,23 @@
 #include <stdexcept>
 #include <list>
 #include <algorithm>
+#include <memory>
+#include <thread>
 #include <boost/lexical_cast.hpp>
+#include <fin/candlestick_aggregator.h>
+#include <fin/candlestick_store.h>
+#include <fin/channel_router.h>
 #include <fin/instrument_registry.h>
 #include <fin/market.h>
+#include <fin/orderbook_sync.h>
 #include <fin/exchange_dictionary.h>
+#include <platform/buffer_pool.h>
+#include <platform/json_pool.h>
+#include <platform/task_queue.h>
 #include <pjson.h>
 #include "connector_rest_price.h"
 #include "connector_ws_price.h"
+#include "depth_scanner.h"
 
 namespace adaptor {
 namespace example {
@@ -26,7 +36,7 @@ class PriceAdapter
   , public fin::BaseStockDataConnector {
 public:
   PriceAdapter(fin::interface::StockDataObserver *observer);
-  virtual ~PriceAdapter() override = default;
+  virtual ~PriceAdapter() override;
 
    //! Implements subscribe method of the interface
   virtual void subscribe(const fin::InstrumentsList &instruments) override;
@@ -45,6 +55,9 @@ public:
   //! Implements stop method of the interface
   virtual void stop() override;
 
+  fin::OrderBookSync::Stats getBookSyncStats(); //!< Depth synchronization counters, zero when "depth-sync" is off
+  platform::JsonDocumentPool::Stats getJsonStats() { return m_jsonPool.getStats(); } //!< Parser allocator counters
+
 protected:
   // Overrides WSSpotPriceAPI::onData
   virtual void onData(const char *msg, size_t size, unsigned long timestamp) override;
@@ -65,9 +78,23 @@ protected:
   // Overrides RESTSpotPriceAPI::onCandleSticksResponse
   virtual void onKlineResponse(std::string data, const char *symbol, connector::example::RequestContext *userdata = nullptr) override;
 
-  void parseData(long timestamp, unsigned long netTimestamp, fin::InstrumentHandle instr, const pjson::value_variant &data);
-  template<typename InsertIterator>
-  void processDirection(long timestamp, fin::OrderDir direction, const pjson::value_variant &arr, 
+  // Parsing is templated on the value type, pjson::value_variant or platform::JsonValue ("json-parser" config key)
+  template<typename Value>
+  void parseData(long timestamp, unsigned long netTimestamp, fin::InstrumentHandle instr, const Value &data,
+                 fin::OrderBookList &entries, bool snapshot);
+  template<typename Value>
+  void parseLevels(long timestamp, fin::InstrumentHandle instr, const Value &data, fin::OrderBookList &entries);
+  void deliverDepth(fin::InstrumentHandle instr, unsigned long netTimestamp, fin::OrderBookSpan entries, bool snapshot);
+  bool requestSnapshot(fin::InstrumentHandle instr);
+  void onBookSyncOutput(fin::InstrumentHandle instr, fin::OrderBookSpan entries, bool snapshot, fin::ProfilingTag tag);
+  template<typename Value>
+  void parseDeals(unsigned long netTimestamp, fin::InstrumentHandle instr, const Value &data);
+  void processFrame(char *msg, size_t size, unsigned long netTime, fin::OrderBookList &entries);
+  template<typename Value>
+  void processDocument(const Value &doc, unsigned long netTime, fin::OrderBookList &entries);
+  void closeCandleSticks();
+  template<typename Value, typename InsertIterator>
+  void processDirection(long timestamp, fin::OrderDir direction, const Value &arr, 
                         fin::InstrumentHandle instrumentHandle, InsertIterator inserter)
   {
     fin::OrderBookEntry entry;
@@ -93,9 +120,58 @@ private:
     { }
     unsigned long interval;
   };
+
+  // Depth request issued by the orderbook synchronization
+  struct SnapshotRequest
+    : public connector::example::RequestContext
+  {
+    SnapshotRequest(long t, uint64_t g)
+      : issued(t)
+      , generation(g)
+    { }
+    long issued; // Request time, milliseconds, the snapshot version
+    uint64_t generation; // OrderBookSync generation the request belongs to
+  };
+
+  template<typename Value>
+  void processDepthResponse(const Value &doc, fin::InstrumentHandle instr, SnapshotRequest *snapshot);
+
+  // Parses WebSocket frames of the channels routed to it, keeps its own entries buffer
+  class ParseWorker
+    : public platform::TaskQueue
+  {
+  public:
+    ParseWorker(size_t capacity, platform::QueueFullPolicy policy)
+      : platform::TaskQueue(capacity, policy)
+    { entries.reserve(400); }
+    fin::OrderBookList entries;
+  };
+  class FrameTask;
+  class DrainTask;
+
+  void startWorkers(int count);
+  void stopWorkers();
+  void drainWorkers();
+
   bool m_started;
+  bool m_depthScanner; // Depth frames decoded by DepthScanner, DOM for the rest; "depth-scanner" config key
+  bool m_jsonIndex; // DOM built by platform::JsonIndex instead of pjson; "json-parser" config key
+  fin::OrderBookList m_entries; // Reused across WebSocket messages, handed to the observer as a span
   std::mutex m_subscriptionLock;
   fin::InstrumentsList m_subscriptions;
+  fin::ChannelRouter m_channels; // Channel names of the subscriptions, filled by subscribe()
+  std::unique_ptr<fin::CandleStickAggregator> m_candleSticks; // Local candlesticks, enabled by "candlesticks" config key
+  std::unique_ptr<platform::Timer> m_candleStickTimer;
+  std::unique_ptr<fin::CandleStickStore> m_candleStickStore; // Candlestick history, enabled by "candlestick-store" config key
+  platform::BufferPool m_framePool; // Frame copies handed to the workers, must outlive them
+  platform::JsonDocumentPool m_jsonPool; // Documents reused across messages by the WebSocket thread, workers and REST responses
+  std::vector<std::unique_ptr<ParseWorker>> m_workers; // Enabled by "parse-workers" config key
+  size_t m_workerQueueSize; // Lock-free ring of the workers, 0 for the spinlock queue; "parse-queue-size" config key
+  platform::QueueFullPolicy m_workerQueueFull; // "parse-queue-full" config key
+  platform::QueueWait m_workerWait; // "parse-queue-wait" config key
+  unsigned long m_workerSpins; // "parse-queue-spins" config key
+  std::vector<std::thread> m_workerThreads;
+  std::unique_ptr<fin::OrderBookSync> m_bookSync; // REST snapshots synchronized with WebSocket deltas, enabled by "depth-sync" config key
 };
 
 }
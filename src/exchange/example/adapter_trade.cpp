@@ -156,7 +156,8 @@ void TradeAdapter::stop() {
 
 void TradeAdapter::onLoginResponse(const char *data, size_t size, unsigned long timestamp) {
   const_cast<char*>(data)[size] = '\0';
-  pjson::document doc;
+  auto lease = m_jsonPool.acquire();
+  pjson::document &doc = *lease;
   bool result = parseResponse(const_cast<char*>(data), doc);
   bool loginFailed = false;
 
@@ -176,7 +177,8 @@ void TradeAdapter::onLoginResponse(const char *data, size_t size, unsigned long
 void TradeAdapter::onOrderPlacedResponse(const char *data, size_t size, unsigned long timestamp) {
   fin::TradeOrderHandle order = removeOrderRequest(OrderChannelType::ok_spot_order);
   const_cast<char*>(data)[size] = '\0';
-  pjson::document doc;
+  auto lease = m_jsonPool.acquire();
+  pjson::document &doc = *lease;
   bool result = parseResponse(const_cast<char*>(data), doc);
 
   if(!result) {
@@ -214,7 +216,8 @@ void TradeAdapter::onOrderPlacedResponse(const char *data, size_t size, unsigned
 void TradeAdapter::onOrderCancelledResponse(const char *data, size_t size, unsigned long timestamp) {
   fin::TradeOrderHandle order = removeOrderRequest(OrderChannelType::ok_spot_cancel_order);
   const_cast<char*>(data)[size] = '\0';
-  pjson::document doc;
+  auto lease = m_jsonPool.acquire();
+  pjson::document &doc = *lease;
   bool result = parseResponse(const_cast<char*>(data), doc);
 
   if(!result) {
@@ -257,7 +260,8 @@ void TradeAdapter::onOrderCancelledResponse(const char *data, size_t size, unsig
 void TradeAdapter::onUserAccountInfoResponse(const char *data, size_t size, unsigned long timestamp) {
   // ?
   const_cast<char*>(data)[size] = '\0';
-  pjson::document doc;
+  auto lease = m_jsonPool.acquire();
+  pjson::document &doc = *lease;
   bool result = parseResponse(const_cast<char*>(data), doc);
 
   if(!result) {
@@ -294,7 +298,8 @@ void TradeAdapter::onUserAccountInfoResponse(const char *data, size_t size, unsi
 void TradeAdapter::onOrderInfoResponse(const char *data, size_t size, unsigned long timestamp) {
   // Order info changed
   const_cast<char*>(data)[size] = '\0';
-  pjson::document doc;
+  auto lease = m_jsonPool.acquire();
+  pjson::document &doc = *lease;
   bool result = parseResponse(const_cast<char*>(data), doc);
 
   std::map<int, fin::OrderStatus::State> statuses = {
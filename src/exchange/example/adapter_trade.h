@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <boost/lexical_cast.hpp>
 #include <platform/http.h>
+#include <platform/json_pool.h>
 #include <fin/instrument_registry.h>
 #include <fin/exchange.h>
 #include <fin/exchange_dictionary.h>
@@ -38,6 +39,8 @@ public:
   virtual void start() override;
   virtual void stop() override;
 
+  platform::JsonDocumentPool::Stats getJsonStats() { return m_jsonPool.getStats(); } //!< Parser allocator counters
+
 protected:
   enum class OrderChannelType {
     ok_spot_order = 0,
@@ -85,6 +88,7 @@ private:
   std::atomic_flag m_lock;
   std::string m_limitsUrl;
   std::atomic<bool> m_started;
+  platform::JsonDocumentPool m_jsonPool; // Documents reused across responses
 };
 
 #undef WAIT_LOOP_DURATION
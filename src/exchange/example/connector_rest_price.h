@@ -29,6 +29,7 @@ public:
   virtual ~RESTPriceConnector() { }
 
   void setTimeout(long timeoutMs);
+  void setBaseUrl(const char *); //!< Set platform base URL (exchange or local mock server)
 
   //! Called when the last request times out. Receives symbol passed in the request, and the userdata
   virtual void onTimeout(std::string symbol, RequestContext *userdata) = 0;
@@ -49,8 +50,6 @@ public:
   bool getKline(const char *symbol, const char *type, int size, long since, RequestContext *userdata = nullptr); //!< Get candlesticks
 
 private:
-  void setBaseUrl(const char *); //!< Set platform base URL
-
   std::string m_baseUrl;
   long m_timeout;
 };
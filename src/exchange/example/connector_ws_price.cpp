@@ -2,8 +2,10 @@
 #include <chrono>
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
 #include <boost/lexical_cast.hpp>
 #include <platform/log.h>
+#include <platform/clock.h>
 #include <fin/profiling.h>
 #include "config.h"
 #include "connector_ws_price.h"
@@ -24,6 +26,12 @@ WSPriceConnector::WSPriceConnector()
   , m_pingSent(0)
   , m_pingInterval(30000000000)
   , m_lastData(0)
+  , m_compression(false)
+  , m_subscribeTimer(TimerService::instance().createTimer([this](Timer*){ this->flushSubscriptions(); }))
+  , m_subscribeBatch(1)
+  , m_subscribeFrameSize(0)
+  , m_subscribeInterval(0)
+  , m_lastSubscribe(0)
 {
   setUrl(connector::example::WS_URL);
 }
@@ -43,6 +51,21 @@ void WSPriceConnector::setUrl(const std::string &url)
   m_url = url;
 }
 
+/**
+ * Negotiates permessage-deflate on the next start(). Trades inflate CPU time for bandwidth,
+ * compare getCompressionStats() with and without it.
+ * @param enable true to offer compression to the server
+ */
+void WSPriceConnector::setCompression(bool enable)
+{
+  m_compression = enable;
+}
+
+platform::WSCompressionStats WSPriceConnector::getCompressionStats() const
+{
+  return m_wsConnection ? m_wsConnection->getCompressionStats() : platform::WSCompressionStats();
+}
+
 /**
  * Sets response timeout to ping request
  * @param pingTimeout timeout in milliseconds
@@ -63,14 +86,18 @@ void WSPriceConnector::setDataTimeout(long timeout)
 
 /**
  * Starts WebSocket connection and waits until it succeeds or fails.
+ * Redundant legs added with addLeg() are connected after the primary one,
+ * a leg that fails to connect, or closes later, is reconnected in the background.
  * Throws std::runtime_error if connect fails.
  */
 void WSPriceConnector::start()
 {
   using namespace std::placeholders;
   m_started = true;
+  m_arbiter.reset(m_legs.empty() ? nullptr : new FeedArbiter(m_legs.size() + 1));
   m_wsConnection.reset(WebSocketClient::instance().createConnection());
   m_wsConnection->setConnectionHandler(this);
+  m_wsConnection->setCompression(m_compression);
 
   // We want to wait until connection is completed
   m_connected = std::promise<bool>();
@@ -82,6 +109,129 @@ void WSPriceConnector::start()
   if(!success) {
     throw std::runtime_error("Connect to Okex WS API failed! (url: " + m_url + ").");
   }
+
+  for(auto &leg : m_legs) {
+    leg->connected = std::promise<bool>();
+    if(!leg->outboundAddr.empty() && !leg->client) {
+      leg->client.reset(new WebSocketClient(leg->outboundAddr, false, false));
+    }
+    WebSocketClient &client = leg->client ? *leg->client : WebSocketClient::instance();
+    leg->connection.reset(client.createConnection());
+    leg->connection->setConnectionHandler(this);
+    leg->connection->setCompression(m_compression);
+    leg->connection->connect(m_url.c_str());
+
+    if(!leg->connected.get_future().get()) {
+      LogWarning() << "Redundant connection to " << m_url << " via '" << leg->outboundAddr << "' failed";
+      std::lock_guard<std::mutex> lock(m_subscribeLock);
+      leg->down = true;
+      scheduleReconnect(&leg - &m_legs[0]);
+    }
+  }
+
+  // Channels subscribed before (or before the reconnect) go out again in batches
+  resubscribe();
+}
+
+/**
+ * Adds a redundant connection (leg) subscribed to the same channels. Identical messages of all legs
+ * are arbitrated, the first arrival is passed to onData() and the copies are dropped.
+ * Must be called before start().
+ * @param outboundAddr local interface for the leg, empty to connect from the default one
+ */
+void WSPriceConnector::addLeg(const std::string &outboundAddr)
+{
+  std::unique_ptr<Leg> leg(new Leg);
+  leg->outboundAddr = outboundAddr;
+  const size_t index = m_legs.size();
+  leg->reconnectTimer.reset(TimerService::instance().createTimer([this, index](Timer*){ this->reconnectLeg(index); }));
+  m_legs.emplace_back(std::move(leg));
+}
+
+/**
+ * Reconnects the leg after a delay of 1 s, doubling up to 32 s while reconnects fail.
+ * Called with m_subscribeLock held.
+ */
+void WSPriceConnector::scheduleReconnect(size_t leg)
+{
+  if(!m_started) {
+    return;
+  }
+  Leg &target = *m_legs[leg];
+  target.reconnectTimer->start(std::chrono::seconds(1 << std::min(target.retries, 5u)));
+  target.retries ++;
+}
+
+/**
+ * Replaces the closed connection of the leg with a new one. Once connected, onConnected()
+ * queues the subscribed channels for this leg alone.
+ */
+void WSPriceConnector::reconnectLeg(size_t index)
+{
+  Leg &leg = *m_legs[index];
+  std::unique_ptr<WebSocketConnection> closed; // Released after the locks
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  if(!m_started) {
+    return;
+  }
+
+  LogInfo() << "Reconnecting redundant connection " << index + 1 << " to " << m_url;
+  WebSocketClient &client = leg.client ? *leg.client : WebSocketClient::instance();
+  std::unique_ptr<WebSocketConnection> connection(client.createConnection());
+  connection->setConnectionHandler(this);
+  connection->setCompression(m_compression);
+  {
+  std::lock_guard<std::mutex> arbiterLock(m_arbiterLock);
+  closed = std::move(leg.connection);
+  leg.connection = std::move(connection);
+  }
+  leg.subscribeQueue.clear();
+  leg.connection->connect(m_url.c_str());
+}
+
+/**
+ * Returns win rate and delay behind the winning leg for every leg, the primary connection is leg 0
+ * @param reset zero the counters after reading them
+ */
+std::vector<FeedArbiter::LegStats> WSPriceConnector::getLegStats(bool reset)
+{
+  std::lock_guard<std::mutex> lock(m_arbiterLock);
+  std::vector<FeedArbiter::LegStats> result(getLegs());
+  if(m_arbiter) {
+    for(size_t i = 0; i < result.size(); i ++) {
+      result[i] = m_arbiter->getStats(i);
+    }
+    if(reset) {
+      m_arbiter->resetStats();
+    }
+  }
+  return result;
+}
+
+// Called with m_arbiterLock held, reconnectLeg() and stop() replace connections under it
+int WSPriceConnector::findLeg(WebSocketConnection *conn) const
+{
+  if(conn == m_wsConnection.get()) {
+    return 0;
+  }
+  for(size_t i = 0; i < m_legs.size(); i ++) {
+    if(conn == m_legs[i]->connection.get()) {
+      return i + 1;
+    }
+  }
+  return -1;
+}
+
+// Writes the message to the primary connection and all legs which are up.
+// Called with m_subscribeLock held, reconnectLeg() and stop() replace connections under it.
+void WSPriceConnector::send(const char *message, size_t size)
+{
+  m_wsConnection->write(message, size);
+  for(auto &leg : m_legs) {
+    if(leg->connection && !leg->down) {
+      leg->connection->write(message, size);
+    }
+  }
 }
 
 /**
@@ -91,17 +241,17 @@ void WSPriceConnector::start()
 void WSPriceConnector::ping() {
   static const std::string message = "{\"event\":\"ping\"}";
 
+  {
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
   if(!m_wsConnection) {
     return; // Throw?
   }
 
-  m_wsConnection->write(message.c_str(), message.size());
+  send(message.c_str(), message.size());
+  }
 
   // Start ping timeout timer
-  struct timespec now;
-  clock_gettime(CLOCK_REALTIME, &now);
-  unsigned long ts = now.tv_sec * 1000000000 + now.tv_nsec;
-  m_pingSent = ts;
+  m_pingSent = Clock::instance().now();
   m_pingTimer->start(std::chrono::milliseconds(m_pingTimeout));
 }
 
@@ -120,6 +270,30 @@ int WSPriceConnector::onDataReady(WebSocketConnection *conn, WSMessage msg) {
     return 0;
   }
 
+  // Acknowledgements name the addChannel channel first, data messages name the subscribed one
+  static const char channelKey[] = "\"channel\":\"";
+  static const char ackChannel[] = "addChannel\"";
+  if(msg.data) {
+    const char *head = msg.data + std::min(msg.size, (size_t)64);
+    const char *channel = std::search(msg.data, head, channelKey, channelKey + sizeof(channelKey) - 1);
+    if(channel != head && (size_t)(msg.data + msg.size - channel) >= sizeof(channelKey) + sizeof(ackChannel) - 2 &&
+       !memcmp(channel + sizeof(channelKey) - 1, ackChannel, sizeof(ackChannel) - 1)) {
+      onSubscribeAck(msg.data, msg.size);
+      return 0;
+    }
+  }
+
+  if(m_arbiter) {
+    std::lock_guard<std::mutex> lock(m_arbiterLock);
+    int leg = findLeg(conn);
+    if(leg < 0 || !m_arbiter->accept(leg, msg.data, msg.size, msg.timestamp)) {
+      return 0; // Already delivered by a faster leg
+    }
+    onData(msg.data, msg.size, msg.timestamp);
+    m_lastData = msg.timestamp;
+    return 0;
+  }
+
   //m_dataTimer->start(m_dataTimeoutDuration);
   onData(msg.data, msg.size, msg.timestamp);
   m_lastData = msg.timestamp;
@@ -132,9 +306,7 @@ void WSPriceConnector::checkTimers() {
     return;
   }
 
-  struct timespec now;
-  clock_gettime(CLOCK_REALTIME, &now);
-  unsigned long ts = now.tv_sec * 1000000000 + now.tv_nsec;
+  unsigned long ts = Clock::instance().now();
   if((ts - m_lastData) / 1000000 > (unsigned long)m_dataTimeout) {
     dataTimeout();
     m_lastData = ts;
@@ -144,12 +316,66 @@ void WSPriceConnector::checkTimers() {
 }
 
 int WSPriceConnector::onConnected(WebSocketConnection *conn) {
+  int leg;
+  {
+  std::lock_guard<std::mutex> lock(m_arbiterLock);
+  leg = findLeg(conn);
+  }
+  if(leg < 0) {
+    return 0; // Connection replaced by reconnectLeg() or released by stop()
+  }
+  if(leg > 0) {
+    Leg &target = *m_legs[leg - 1];
+    try {
+      target.connected.set_value(true);
+    } catch(std::future_error &e)
+    { }
+
+    {
+    std::lock_guard<std::mutex> lock(m_subscribeLock);
+    if(!target.down) {
+      return 0; // Subscribed by start()
+    }
+    target.retries = 0;
+    // Channels still queued reach every connection, this leg included
+    for(const auto &channel : m_channels) {
+      if(channel.second == ChannelState::Sent || channel.second == ChannelState::Acked) {
+        target.subscribeQueue.push_back(channel.first);
+      }
+    }
+    target.down = false;
+    }
+    LogInfo() << "Redundant connection " << leg << " to " << m_url << " restored";
+    flushSubscriptions();
+    return 0;
+  }
+
   // Set promise and release waiting threads
   m_connected.set_value(true);
   return 0;
 }
 
 int WSPriceConnector::onConnectFailed(WebSocketConnection *conn) {
+  int leg;
+  {
+  std::lock_guard<std::mutex> lock(m_arbiterLock);
+  leg = findLeg(conn);
+  }
+  if(leg < 0) {
+    return 0; // Connection replaced by reconnectLeg() or released by stop()
+  }
+  if(leg > 0) {
+    try {
+      m_legs[leg - 1]->connected.set_value(false);
+    } catch(std::future_error &e)
+    { }
+    std::lock_guard<std::mutex> lock(m_subscribeLock);
+    if(m_legs[leg - 1]->down) {
+      scheduleReconnect(leg - 1);
+    }
+    return 0;
+  }
+
   // Set promise and release waiting threads
   m_connected.set_value(false);
   m_started = false;
@@ -157,6 +383,24 @@ int WSPriceConnector::onConnectFailed(WebSocketConnection *conn) {
 }
 
 int WSPriceConnector::onClose(WebSocketConnection *conn) {
+  int leg;
+  {
+  std::lock_guard<std::mutex> lock(m_arbiterLock);
+  leg = findLeg(conn);
+  }
+  if(leg < 0) {
+    return 0; // Connection replaced by reconnectLeg() or released by stop()
+  }
+  if(leg > 0) {
+    // The other legs keep the feed going, only the primary connection closes the connector
+    LogWarning() << "Redundant connection " << leg << " to " << m_url << " closed";
+    std::lock_guard<std::mutex> lock(m_subscribeLock);
+    m_legs[leg - 1]->down = true;
+    m_legs[leg - 1]->retries = 0;
+    scheduleReconnect(leg - 1);
+    return 0;
+  }
+
   if(m_started) {
     m_wsConnection->disconnect(); // Tear down the connection
     m_started = false;
@@ -182,7 +426,21 @@ void WSPriceConnector::stop() {
   } catch(std::future_error &e)
   { }
 
-  m_wsConnection.reset();
+  m_subscribeTimer->stop();
+  // Released after the locks, connections before the clients serving them
+  std::vector<std::unique_ptr<WebSocketClient>> clients;
+  std::vector<std::unique_ptr<WebSocketConnection>> connections;
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  std::lock_guard<std::mutex> arbiterLock(m_arbiterLock);
+  for(auto &leg : m_legs) {
+    leg->reconnectTimer->stop();
+    leg->down = false;
+    leg->retries = 0;
+    leg->subscribeQueue.clear();
+    connections.emplace_back(std::move(leg->connection));
+    clients.emplace_back(std::move(leg->client));
+  }
+  connections.emplace_back(std::move(m_wsConnection));
 }
 
 /**
@@ -191,23 +449,202 @@ void WSPriceConnector::stop() {
  * @see https://github.com/okcoin-okex/API-docs-OKEx.com/blob/master/API-For-Spot-EN/WEBSOCKET%20API%20for%20SPOT.md#spot-price-api
  */
 void WSPriceConnector::subscribe(const char *instrument) {
-  static const char format[] = "{\"event\":\"addChannel\",\"channel\":\"ok_sub_spot_%s_depth\"}";
-  static const char formatSize = sizeof(format);
+  subscribeChannels({ std::string("ok_sub_spot_") + instrument + "_depth" });
+}
 
-  if(!m_wsConnection) {
-    return; // Throw?
+/**
+ * Subscribes to the trades of the given instrument
+ * @param instrument - trading symbol in OKex format (usdt_btc, qtum_usdt, hsr_usdt, etc.)
+ */
+void WSPriceConnector::subscribeDeals(const char *instrument) {
+  subscribeChannels({ std::string("ok_sub_spot_") + instrument + "_deals" });
+}
+
+/**
+ * Queues channels for subscription. Channels are coalesced into addChannel frames of up to
+ * setSubscriptionBatch() channels and sent at most setSubscriptionRate() frames per second.
+ * Known channels are not subscribed twice. Channels queued before start() are sent when connected.
+ * @param channels full channel names (ok_sub_spot_bch_btc_depth, etc.)
+ */
+void WSPriceConnector::subscribeChannels(const std::vector<std::string> &channels) {
+  {
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  for(const auto &channel : channels) {
+    auto inserted = m_channels.emplace(channel, ChannelState::Queued);
+    if(inserted.second || inserted.first->second == ChannelState::Rejected) {
+      inserted.first->second = ChannelState::Queued;
+      m_subscribeQueue.push_back(channel);
+    }
+  }
+  }
+  flushSubscriptions();
+}
+
+/**
+ * Queues every known channel again, acknowledgements of the previous connection are forgotten
+ */
+void WSPriceConnector::resubscribe() {
+  {
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  m_subscribeQueue.clear();
+  for(auto &channel : m_channels) {
+    channel.second = ChannelState::Queued;
+    m_subscribeQueue.push_back(channel.first);
+  }
+  m_lastSubscribe = 0;
+  }
+  flushSubscriptions();
+}
+
+/**
+ * @param channels maximum channels per frame, 1 sends the single addChannel object the exchange documents
+ * @param maxFrameSize maximum frame size in bytes, 0 for no limit. A frame always carries at least one channel.
+ */
+void WSPriceConnector::setSubscriptionBatch(size_t channels, size_t maxFrameSize) {
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  m_subscribeBatch = std::max<size_t>(channels, 1);
+  m_subscribeFrameSize = maxFrameSize;
+}
+
+/**
+ * @param framesPerSecond addChannel frames sent per second at most, 0 disables pacing
+ */
+void WSPriceConnector::setSubscriptionRate(double framesPerSecond) {
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  m_subscribeInterval = framesPerSecond > 0 ? (unsigned long)(1e9 / framesPerSecond) : 0;
+}
+
+/**
+ * Blocks until no channel waits for its frame or acknowledgement
+ * @param timeoutMs maximum time to wait in milliseconds
+ * @return false on timeout
+ */
+bool WSPriceConnector::waitSubscribed(long timeoutMs) {
+  std::unique_lock<std::mutex> lock(m_subscribeLock);
+  return m_subscribeCond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() {
+                                    for(const auto &channel : m_channels) {
+                                      if(channel.second == ChannelState::Queued || channel.second == ChannelState::Sent) {
+                                        return false;
+                                      }
+                                    }
+                                    return true;
+                                  });
+}
+
+size_t WSPriceConnector::getPendingChannels() {
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  return std::count_if(m_channels.begin(), m_channels.end(), [](const std::pair<const std::string, ChannelState> &channel) {
+                         return channel.second == ChannelState::Queued || channel.second == ChannelState::Sent;
+                       });
+}
+
+size_t WSPriceConnector::getRejectedChannels() {
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  return std::count_if(m_channels.begin(), m_channels.end(), [](const std::pair<const std::string, ChannelState> &channel) {
+                         return channel.second == ChannelState::Rejected;
+                       });
+}
+
+/**
+ * Sends queued channels as far as the rate limit allows and schedules the rest.
+ * Frames are written under m_subscribeLock, which stop() takes before it releases the connections,
+ * so a timer callback never writes to a connection being torn down. Writes only queue the frame.
+ */
+void WSPriceConnector::flushSubscriptions() {
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  if(!m_started || !m_wsConnection) {
+    return; // Sent by start()
   }
 
-  size_t len = strlen(instrument) + formatSize + 1;
-  char msg[len];
+  unsigned long now = Clock::instance().now();
+  auto leg = m_legs.begin();
+  for(;;) {
+    // Channels of every connection first, then those of reconnected legs
+    while(leg != m_legs.end() && ((*leg)->subscribeQueue.empty() || !(*leg)->connection)) {
+      ++ leg;
+    }
+    if(m_subscribeQueue.empty() && leg == m_legs.end()) {
+      break;
+    }
+    if(m_subscribeInterval && m_lastSubscribe && now < m_lastSubscribe + m_subscribeInterval) {
+      m_subscribeTimer->start(std::chrono::nanoseconds(m_lastSubscribe + m_subscribeInterval - now));
+      break;
+    }
+
+    if(!m_subscribeQueue.empty()) {
+      std::string frame = takeSubscribeFrame(m_subscribeQueue);
+      send(frame.c_str(), frame.size());
+    } else {
+      std::string frame = takeSubscribeFrame((*leg)->subscribeQueue);
+      (*leg)->connection->write(frame.c_str(), frame.size());
+    }
+    m_lastSubscribe = now;
+    m_lastData = Clock::instance().now();
+  }
+}
 
-  int msgSize = snprintf(msg, len, format, instrument);
+/**
+ * Removes the channels of the next addChannel frame from the queue and marks them as sent
+ * Called with m_subscribeLock held.
+ */
+std::string WSPriceConnector::takeSubscribeFrame(std::deque<std::string> &queue) {
+  static const char event[] = "{\"event\":\"addChannel\",\"channel\":\"";
+  static const char eventEnd[] = "\"}";
+
+  std::string frame;
+  size_t count = 0;
+  while(!queue.empty() && count < m_subscribeBatch) {
+    const std::string &channel = queue.front();
+    size_t size = sizeof(event) + channel.size() + sizeof(eventEnd) + 1;
+    if(count && m_subscribeFrameSize && frame.size() + size > m_subscribeFrameSize) {
+      break;
+    }
+    frame += count ? "," : "";
+    frame.append(event).append(channel).append(eventEnd);
+    auto state = m_channels.find(channel);
+    if(state != m_channels.end() && state->second != ChannelState::Acked) {
+      state->second = ChannelState::Sent;
+    }
+    queue.pop_front();
+    count ++;
+  }
 
-  m_wsConnection->write(msg, msgSize);
+  if(m_subscribeBatch > 1) {
+    frame = "[" + frame + "]";
+  }
+  return frame;
+}
 
-  struct timespec now;
-  clock_gettime(CLOCK_REALTIME, &now);
-  m_lastData = now.tv_sec * 1000000000 + now.tv_nsec;
+/**
+ * Marks channels of an addChannel acknowledgement (single or array) as subscribed or rejected
+ */
+void WSPriceConnector::onSubscribeAck(const char *data, size_t size) {
+  static const char resultKey[] = "\"result\":";
+  static const char channelKey[] = "\"channel\":\"";
+  const char *end = data + size;
+  const char *pos = data;
+
+  std::lock_guard<std::mutex> lock(m_subscribeLock);
+  while((pos = std::search(pos, end, resultKey, resultKey + sizeof(resultKey) - 1)) != end) {
+    pos += sizeof(resultKey) - 1;
+    bool result = (end - pos) >= 4 && !memcmp(pos, "true", 4);
+
+    pos = std::search(pos, end, channelKey, channelKey + sizeof(channelKey) - 1);
+    if(pos == end) {
+      break;
+    }
+    pos += sizeof(channelKey) - 1;
+    const char *channelEnd = std::find(pos, end, '"');
+    auto state = m_channels.find(std::string(pos, channelEnd));
+    if(state != m_channels.end() && state->second != ChannelState::Acked) {
+      state->second = result ? ChannelState::Acked : ChannelState::Rejected;
+      if(!result) {
+        LogWarning() << "Subscription to " << state->first << " rejected";
+      }
+    }
+    pos = channelEnd;
+  }
+  m_subscribeCond.notify_all();
 }
 
 }
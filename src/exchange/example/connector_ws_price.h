@@ -2,12 +2,17 @@
 
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <future>
 #include <string>
 #include <platform/websocket.h>
 #include <platform/http.h>
 #include <platform/timer.h>
+#include <platform/feed_arbiter.h>
 #include <set>
+#include <vector>
 
 namespace connector {
 namespace example {
@@ -24,10 +29,24 @@ public:
 
   void setPingTimeout(long pingTimeoutMs); //!< Set timeout for ping response
   void setDataTimeout(long timeoutMs); //!< Set data timeout to issue ping request
+  void setUrl(const std::string &url); //!< Set URL for WebSocket connection (exchange or local mock server)
+  void setCompression(bool enable); //!< Offer permessage-deflate when connecting
+  platform::WSCompressionStats getCompressionStats() const; //!< Compression counters of the current connection
+  void addLeg(const std::string &outboundAddr = ""); //!< Open one more redundant connection on start()
+  size_t getLegs() const { return m_legs.size() + 1; } //!< Number of connections including the primary one
+  std::vector<platform::FeedArbiter::LegStats> getLegStats(bool reset = false); //!< Arbitration counters per leg, primary first
 
   void start(); //!< Open WebSocket connection
   void stop(); //!< Stop WebSocket connection
   void subscribe(const char *instrument); //!< Subscribe to updates for given symbol (in OKex format)
+  void subscribeDeals(const char *instrument); //!< Subscribe to trades for given symbol (in OKex format)
+  void subscribeChannels(const std::vector<std::string> &channels); //!< Queue channels for batched, rate limited subscription
+  void resubscribe(); //!< Subscribe again to every known channel, done by start() after reconnect
+  void setSubscriptionBatch(size_t channels, size_t maxFrameSize = 0); //!< Channels (and bytes, 0 unlimited) per addChannel frame
+  void setSubscriptionRate(double framesPerSecond); //!< Pace addChannel frames, 0 sends them at once
+  bool waitSubscribed(long timeoutMs); //!< Wait until every channel is acknowledged or rejected
+  size_t getPendingChannels(); //!< Channels not acknowledged yet
+  size_t getRejectedChannels(); //!< Channels the exchange refused
   void ping(); //!< Test if connection is alive
 
   virtual void onData(const char *data, size_t size, unsigned long timestamp) = 0; //!< Data callback, receives unprocessed events and market updates
@@ -35,7 +54,6 @@ public:
   virtual void onPingTimeout() = 0; //!< Called after a timeout, when we do not get pong response
 
 private:
-  void setUrl(const std::string &url); //!< Set URL for WebSocket connection (can be either OKex or OKcoin URL)
   WSPriceConnector(const WSPriceConnector &) = delete;
   void operator =(const WSPriceConnector &) = delete;
 
@@ -46,6 +64,33 @@ private:
   virtual void checkTimers() override;
   void pingTimeout();
   void dataTimeout();
+  void send(const char *message, size_t size);
+  void flushSubscriptions();
+  std::string takeSubscribeFrame(std::deque<std::string> &queue);
+  void scheduleReconnect(size_t leg);
+  void reconnectLeg(size_t leg);
+  void onSubscribeAck(const char *data, size_t size);
+
+  enum class ChannelState {
+    Queued = 0, // Waiting for its frame
+    Sent,       // Waiting for acknowledgement
+    Acked,
+    Rejected
+  };
+  int findLeg(platform::WebSocketConnection *conn) const;
+
+  // Redundant connection subscribed to the same channels as the primary one
+  struct Leg {
+    std::string outboundAddr; // Empty to use the shared WebSocketClient
+    std::unique_ptr<platform::WebSocketClient> client;
+    std::unique_ptr<platform::WebSocketConnection> connection;
+    std::promise<bool> connected;
+    std::unique_ptr<platform::Timer> reconnectTimer;
+    std::atomic<bool> down{false}; // Closed or failed, left out of send() until reconnectLeg() succeeds
+    // Guarded by m_subscribeLock
+    unsigned retries = 0; // Failed reconnects in a row, doubles the delay
+    std::deque<std::string> subscribeQueue; // Channels to subscribe on this leg only, after a reconnect
+  };
 
   std::promise<bool> m_connected;
   std::atomic<bool>  m_started;
@@ -58,6 +103,20 @@ private:
   long m_pingInterval;
   unsigned long m_lastData;
   std::string m_url;
+  bool m_compression;
+  std::vector<std::unique_ptr<Leg>> m_legs;
+  std::unique_ptr<platform::FeedArbiter> m_arbiter;
+  std::mutex m_arbiterLock; // Legs may be served by different WebSocketClient threads
+
+  std::mutex m_subscribeLock;
+  std::condition_variable m_subscribeCond;
+  std::map<std::string, ChannelState> m_channels;
+  std::deque<std::string> m_subscribeQueue;
+  std::unique_ptr<platform::Timer> m_subscribeTimer;
+  size_t m_subscribeBatch;
+  size_t m_subscribeFrameSize;
+  unsigned long m_subscribeInterval; // Nanoseconds between frames
+  unsigned long m_lastSubscribe;
 };
 
 }
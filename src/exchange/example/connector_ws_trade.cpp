@@ -7,9 +7,11 @@
 #include <boost/lexical_cast.hpp>
 #include <fin/profiling.h>
 #include <platform/log.h>
+#include <platform/clock.h>
 #include <platform/sign_util.h>
 #include "config.h"
 #include "connector_ws_trade.h"
+#include "trade_classifier.h"
 
 namespace connector {
 namespace example {
@@ -217,57 +219,43 @@ bool WSTradeConnector::sendRequest(const char *format, const std::map<std::strin
   return true;
 }
 
-const char *WSTradeConnector::strNStr(const char *start, const std::string &str, size_t size) {
-  return (const char *)memmem(start, size, str.c_str(), str.size());
-}
-
 int WSTradeConnector::onDataReady(platform::WebSocketConnection *, platform::WSMessage msg) {
-  using namespace std;
-  static string channel = "channel";
-  static string event = "event";
-  static string login = "login";
-  static string ping = "ping";
-  static string ok_spot_orderinfo = "ok_spot_orderinfo";
-  static string ok_spot_order = "ok_spot_order";
-  static string ok_spot_cancel_order = "ok_spot_cancel_order";
-  static string ok_spot_userinfo = "ok_spot_userinfo";
-  static string _order = "_order";
-  static string _balance = "_balance";
-
-  const char *start = strNStr(msg.data, channel.c_str(), msg.size);
-  if(!start) {
-    start = strNStr(msg.data, event.c_str(), msg.size);
-  }
-
-  if(!start) {
+  switch(TradeClassifier::classify(msg.data, msg.size)) {
+  case TradeClassifier::Kind::None:
     return 0;
-  }
-
-  char const *end = strNStr(start, ",", msg.size - (start - msg.data));
-  if(!end) {
-    end = msg.data + msg.size;
-  }
-
-  size_t len = end - start;
-  if(strNStr(start, "login", len)) {
+  case TradeClassifier::Kind::Login:
     onLogin(msg.data, msg.size, msg.timestamp);
-  } else if(strNStr(start, ok_spot_orderinfo, len)) { // order info
+    break;
+  case TradeClassifier::Kind::OrderInfo:
     onOrderInfo(msg.data, msg.size, msg.timestamp);
-  } else if(strNStr(start, ok_spot_order, len)) { // order placement
+    break;
+  case TradeClassifier::Kind::OrderPlaced:
     onOrderPlaced(msg.data, msg.size, msg.timestamp);
-  } else if(strNStr(start, ok_spot_cancel_order, len)) { // cancel order
+    break;
+  case TradeClassifier::Kind::OrderCancelled:
     onOrderCancelled(msg.data, msg.size, msg.timestamp);
-  } else if(strNStr(start, ok_spot_userinfo, len)) { // user info
+    break;
+  case TradeClassifier::Kind::UserInfo:
     onUserAccountInfo(msg.data, msg.size, msg.timestamp);
-  } else if(strNStr(start, _order, len)) { // trade record
+    break;
+  case TradeClassifier::Kind::Trades:
     onTrades(msg.data, msg.size, msg.timestamp);
-  } else if(strNStr(start, _balance, len)) { // balance
+    break;
+  case TradeClassifier::Kind::Balance:
     onBalance(msg.data, msg.size, msg.timestamp);
-  } else if(strNStr(start, ping, len)) { // ping
-    m_pingTimer->stop();
+    break;
+  case TradeClassifier::Kind::Ping:
+  case TradeClassifier::Kind::Pong:
+    onPong(msg.data, msg.size, msg.timestamp);
+    break;
+  default:
+    break;
   }
 
-  m_requestTimestamps.pop();
+  // Unsolicited messages (pushed trades and balances, pongs) may outnumber the requests
+  if(!m_requestTimestamps.empty()) {
+    m_requestTimestamps.pop();
+  }
 
   return 0;
 }
@@ -337,9 +325,7 @@ int WSTradeConnector::onMessageSent(platform::WebSocketConnection *, platform::W
 }
 
 void WSTradeConnector::checkTimers() {
-  struct timespec now;
-  clock_gettime(CLOCK_REALTIME, &now);
-  unsigned long ts = now.tv_sec * 1000000000 + now.tv_nsec;
+  unsigned long ts = Clock::instance().now();
 
   if((ts - m_lastPing) / 1000000 > (unsigned long)m_pingInterval) {
     ping();
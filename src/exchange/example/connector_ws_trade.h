@@ -67,7 +67,6 @@ private:
   void onTrades(const char *data, size_t size, unsigned long timestamp);
   void onPong(const char *data, size_t size, unsigned long timestamp);
 
-  const char *strNStr(const char *start, const std::string &str, size_t size);
   virtual int onDataReady(platform::WebSocketConnection *, platform::WSMessage msg) override;
   virtual int onConnected(platform::WebSocketConnection *) override;
   virtual int onConnectFailed(platform::WebSocketConnection *) override;
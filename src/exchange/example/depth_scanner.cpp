@@ -0,0 +1,299 @@
+#include <string.h>
+#include "depth_scanner.h"
+
+namespace adaptor {
+namespace example {
+
+namespace {
+
+// Position in the frame, every method returns false on unexpected input
+struct Cursor {
+  const char *p;
+  const char *end;
+
+  bool skipSpace() {
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+      p ++;
+    }
+    return p < end;
+  }
+
+  bool expect(char c) {
+    if(!skipSpace() || *p != c) {
+      return false;
+    }
+    p ++;
+    return true;
+  }
+
+  bool peek(char c) {
+    return skipSpace() && *p == c;
+  }
+
+  // Separator after a member or element: true to continue, false at the closing bracket
+  bool next(char close, bool &ok) {
+    ok = skipSpace() && (*p == ',' || *p == close);
+    return ok && *p ++ == ',';
+  }
+
+  // String without escapes, which never occur in keys, symbols or numbers
+  bool string(const char *&str, size_t &size) {
+    if(!expect('"')) {
+      return false;
+    }
+    const char *close = (const char*)memchr(p, '"', end - p);
+    if(!close || memchr(p, '\\', close - p)) {
+      return false;
+    }
+    str = p;
+    size = close - p;
+    p = close + 1;
+    return true;
+  }
+
+  // Number, quoted or not
+  bool number(const char *&str, size_t &size) {
+    if(peek('"')) {
+      return string(str, size);
+    }
+    str = p;
+    while(p < end && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E')) {
+      p ++;
+    }
+    size = p - str;
+    return size > 0;
+  }
+
+  bool skipString() {
+    for(p ++; p < end; p ++) {
+      if(*p == '\\') {
+        p ++;
+      } else if(*p == '"') {
+        p ++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool skipValue() {
+    if(!skipSpace()) {
+      return false;
+    }
+    if(*p == '"') {
+      return skipString();
+    }
+    if(*p == '{' || *p == '[') {
+      int depth = 0;
+      while(p < end) {
+        if(*p == '"') {
+          if(!skipString()) {
+            return false;
+          }
+          continue;
+        }
+        if(*p == '{' || *p == '[') {
+          depth ++;
+        } else if((*p == '}' || *p == ']') && -- depth == 0) {
+          p ++;
+          return true;
+        }
+        p ++;
+      }
+      return false;
+    }
+    const char *start = p;
+    while(p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+      p ++;
+    }
+    return p > start;
+  }
+};
+
+inline bool keyIs(const char *key, size_t size, const char *name, size_t nameSize) {
+  return size == nameSize && !memcmp(key, name, size);
+}
+
+// [["price","amount"(, more)*]*]
+bool scanLevels(Cursor &c, fin::OrderDir direction, long timestamp, fin::OrderBookList &entries) {
+  if(!c.expect('[')) {
+    return false;
+  }
+  if(c.peek(']')) {
+    c.p ++;
+    return true;
+  }
+
+  bool ok;
+  do {
+    const char *price, *amount;
+    size_t priceSize, amountSize;
+    if(!c.expect('[') || !c.number(price, priceSize) || !c.expect(',') || !c.number(amount, amountSize)) {
+      return false;
+    }
+    while(c.next(']', ok)) {
+      if(!c.skipValue()) {
+        return false;
+      }
+    }
+    if(!ok) {
+      return false;
+    }
+
+    entries.emplace_back();
+    fin::OrderBookEntry &entry = entries.back();
+    entry.direction = direction;
+    entry.timestamp = timestamp;
+    entry.price.assign(price, priceSize);
+    entry.amount.assign(amount, amountSize);
+  } while(c.next(']', ok));
+  return ok;
+}
+
+bool scanData(Cursor &c, long timestamp, fin::OrderBookList &entries, long &dataTimestamp) {
+  if(!c.expect('{')) {
+    return false;
+  }
+  if(c.peek('}')) {
+    c.p ++;
+    return true;
+  }
+
+  bool ok;
+  do {
+    const char *key;
+    size_t keySize;
+    if(!c.string(key, keySize) || !c.expect(':')) {
+      return false;
+    }
+
+    bool scanned;
+    if(keyIs(key, keySize, "asks", 4)) {
+      scanned = scanLevels(c, fin::OrderDir::Ask, timestamp, entries);
+    } else if(keyIs(key, keySize, "bids", 4)) {
+      scanned = scanLevels(c, fin::OrderDir::Bid, timestamp, entries);
+    } else if(keyIs(key, keySize, "timestamp", 9)) {
+      const char *value;
+      size_t size;
+      scanned = c.number(value, size);
+      dataTimestamp = 0;
+      for(size_t i = 0; scanned && i < size; i ++) {
+        scanned = value[i] >= '0' && value[i] <= '9';
+        dataTimestamp = dataTimestamp * 10 + (value[i] - '0');
+      }
+    } else {
+      scanned = c.skipValue();
+    }
+    if(!scanned) {
+      return false;
+    }
+  } while(c.next('}', ok));
+  return ok;
+}
+
+// {"binary":0,"channel":"...","data":{...}}, elements without data are skipped like the DOM path does
+int scanElement(Cursor &c, long timestamp, DepthScanner::Update &update, fin::OrderBookList &entries) {
+  if(!c.expect('{')) {
+    return -1;
+  }
+
+  const char *channel = nullptr;
+  size_t channelSize = 0;
+  bool hasData = false;
+  update.first = entries.size();
+  update.timestamp = -1;
+
+  if(c.peek('}')) {
+    c.p ++;
+    return 0;
+  }
+
+  bool ok;
+  do {
+    const char *key;
+    size_t keySize;
+    if(!c.string(key, keySize) || !c.expect(':')) {
+      return -1;
+    }
+
+    bool scanned;
+    if(keyIs(key, keySize, "channel", 7)) {
+      scanned = c.string(channel, channelSize);
+    } else if(keyIs(key, keySize, "data", 4)) {
+      // Deals and other arrays are left to the DOM
+      scanned = c.peek('{') && scanData(c, timestamp, entries, update.timestamp);
+      hasData = true;
+    } else {
+      scanned = c.skipValue();
+    }
+    if(!scanned) {
+      return -1;
+    }
+  } while(c.next('}', ok));
+
+  if(!ok) {
+    return -1;
+  }
+  if(!hasData || !channel) {
+    entries.resize(update.first);
+    return 0;
+  }
+
+  // ok_sub_spot_<symbol>_depth, the caller routes the channel name to the instrument
+  static const char suffix[] = "_depth";
+  const size_t suffixSize = sizeof(suffix) - 1;
+  if(channelSize <= suffixSize || memcmp(channel + channelSize - suffixSize, suffix, suffixSize)) {
+    return -1;
+  }
+  update.channel = channel;
+  update.channelSize = channelSize;
+  update.count = entries.size() - update.first;
+  return 1;
+}
+
+}
+
+/**
+ * Scans a depth frame
+ * @param msg frame text
+ * @param size frame size
+ * @param entryTimestamp timestamp given to the entries
+ * @param updates receives one update per depth channel, MaxUpdates at most
+ * @param entries entries of all updates are appended, instruments are left to the caller
+ * @return number of updates, -1 if the frame must be parsed by the DOM; entries are unchanged then
+ */
+int DepthScanner::scan(const char *msg, size_t size, long entryTimestamp, Update *updates, fin::OrderBookList &entries)
+{
+  Cursor c{ msg, msg + size };
+  const size_t mark = entries.size();
+  int count = 0;
+  bool ok = c.expect('[');
+
+  if(ok && c.peek(']')) {
+    return 0;
+  }
+
+  while(ok) {
+    Update update;
+    int scanned = scanElement(c, entryTimestamp, update, entries);
+    if(scanned < 0 || (scanned && (size_t)count == MaxUpdates)) {
+      ok = false;
+      break;
+    }
+    if(scanned) {
+      updates[count ++] = update;
+    }
+    if(!c.next(']', ok)) {
+      break;
+    }
+  }
+
+  if(!ok) {
+    entries.resize(mark);
+    return -1;
+  }
+  return count;
+}
+
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <fin/orderbook.h>
+
+namespace adaptor {
+namespace example {
+
+/**
+ * Single pass scanner of depth frames, decodes price levels straight into orderbook entries without building a DOM.
+ * Expected frame: [{"binary":0,"channel":"ok_sub_spot_<symbol>_depth","data":{"asks":[["price","amount"],...],"bids":[...],"timestamp":N}}]
+ * Keys may come in any order and unknown keys are skipped. Anything else (other channels, escaped strings,
+ * malformed JSON) makes scan() fail without side effects, and the frame is parsed by the DOM instead.
+ * The frame is not modified and needs no terminator.
+ */
+class DepthScanner {
+public:
+  static const size_t MaxUpdates = 8; //!< Channels per frame, frames with more go to the DOM
+
+  //! Depth update of one channel
+  struct Update {
+    const char *channel; //!< Channel name inside the frame, not NUL terminated
+    size_t channelSize; //!< Channel name length
+    long timestamp; //!< "timestamp" of the data, -1 if missing
+    size_t first; //!< Index of the first entry of the update
+    size_t count; //!< Number of entries
+  };
+
+  //! Scans the frame, returns number of updates or -1 if the frame must go to the DOM
+  static int scan(const char *msg, size_t size, long entryTimestamp, Update *updates, fin::OrderBookList &entries);
+};
+
+}
+}
@@ -0,0 +1,176 @@
+#include <stdint.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "platform/broadcast_ring.h"
+
+// Publishes numbered events into a platform::BroadcastRing read by several consumer threads and checks
+// that every consumer sees the events in order, never sees a partially written event, and accounts
+// for every event it did not read as lost. The first pass uses a ring holding all events, so no
+// event may be lost; the second pass uses a small ring and a slow consumer, so consumers are lapped.
+// Exits with 1 if any check fails.
+
+namespace {
+
+using platform::BroadcastReadResult;
+
+// Every word is derived from the sequence and written separately, a torn read mixes two events
+struct Event {
+  static const int Words = 7;
+
+  uint64_t sequence;
+  uint64_t words[Words];
+
+  static uint64_t word(uint64_t sequence, int i) { return (sequence + 1) * 0x9e3779b97f4a7c15ULL + i; }
+};
+
+typedef platform::BroadcastRing<Event> Ring;
+
+struct Result {
+  uint64_t read = 0;
+  uint64_t lost = 0;
+  uint64_t torn = 0;
+  uint64_t reordered = 0;
+  uint64_t overruns = 0;
+};
+
+void consume(Ring &ring, Ring::Cursor cursor, uint64_t events, bool slow, std::atomic<bool> &start, Result &result) {
+  while(!start.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+
+  while(cursor.getNext() < events) {
+    const uint64_t expected = cursor.getNext();
+    Event event;
+    BroadcastReadResult status = ring.read(cursor, event);
+    if(status == BroadcastReadResult::Empty) {
+      std::this_thread::yield();
+      continue;
+    }
+    if(status == BroadcastReadResult::Overrun) {
+      result.overruns ++;
+      continue;
+    }
+
+    // The cursor only moves forward by one on Ok, the event must be the one it pointed to
+    if(event.sequence != expected) {
+      result.reordered ++;
+    }
+    for(int i = 0; i < Event::Words; i ++) {
+      if(event.words[i] != Event::word(event.sequence, i)) {
+        result.torn ++;
+        break;
+      }
+    }
+    result.read ++;
+
+    if(slow && !(result.read % 256)) {
+      usleep(200);
+    }
+  }
+  result.lost = cursor.getLost();
+}
+
+/**
+ * Runs one pass, returns false if a check failed. A ring holding all events must not lose any.
+ * @param slowConsumer the last consumer sleeps regularly and gets lapped by the producer
+ */
+bool run(size_t capacity, uint64_t events, int consumers, bool slowConsumer, int pace) {
+  Ring ring(capacity);
+  std::atomic<bool> start(false);
+  std::vector<Result> results(consumers);
+  std::vector<std::thread> threads;
+  for(int i = 0; i < consumers; i ++) {
+    bool slow = slowConsumer && i == consumers - 1;
+    threads.emplace_back(consume, std::ref(ring), ring.subscribe(), events, slow, std::ref(start), std::ref(results[i]));
+  }
+
+  auto started = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  for(uint64_t sequence = 0; sequence < events; sequence ++) {
+    ring.publish([sequence](Event &event) {
+                   event.sequence = sequence;
+                   for(int i = 0; i < Event::Words; i ++) {
+                     event.words[i] = Event::word(sequence, i);
+                   }
+                 });
+    // Consumers share the CPUs with the producer, give them a chance to run between events
+    if(pace && !(sequence % pace)) {
+      std::this_thread::yield();
+    }
+  }
+  for(auto &thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  const bool lossless = capacity >= events;
+  bool ok = true;
+  std::cout << "Capacity " << capacity << ", events " << events << ", " << seconds << "s" << std::endl;
+  for(int i = 0; i < consumers; i ++) {
+    const Result &result = results[i];
+    bool accounted = result.read + result.lost == events;
+    bool passed = accounted && !result.torn && !result.reordered && !(lossless && result.lost);
+    ok = ok && passed;
+    std::cout << "  consumer " << i << (slowConsumer && i == consumers - 1 ? " (slow)" : "")
+              << ": read " << result.read
+              << ", lost " << result.lost
+              << ", overruns " << result.overruns
+              << ", torn " << result.torn
+              << ", reordered " << result.reordered
+              << (accounted ? "" : ", UNACCOUNTED")
+              << (passed ? "" : " FAILED") << std::endl;
+  }
+  return ok;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  int consumers;
+  uint64_t events;
+  size_t capacity;
+  int pace;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("consumers,c", po::value<int>(&consumers)->default_value(3), "Consumer threads")
+    ("events,e", po::value<uint64_t>(&events)->default_value(1000000), "Events published per pass")
+    ("capacity", po::value<size_t>(&capacity)->default_value(1024), "Ring size of the lapping pass, power of 2")
+    ("pace", po::value<int>(&pace)->default_value(64), "Producer yields every this many events, 0 never");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [options]\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+    if(consumers < 1 || !platform::BroadcastRingView<Event>::isValidCapacity(capacity)) {
+      throw std::invalid_argument("Need at least one consumer and a power of 2 capacity");
+    }
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  size_t full = 1;
+  while(full < events) {
+    full <<= 1;
+  }
+
+  bool ok = run(full, events, consumers, false, pace);
+  ok = run(capacity, events, consumers, true, pace) && ok;
+  std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <pjson.h>
+
+#include "platform/json_index.h"
+#include "example/depth_scanner.h"
+
+// Decodes depth frames with the pjson DOM (the PriceAdapter fallback path), with the JsonIndex DOM
+// on each kernel the CPU supports and with DepthScanner, checks that all produce the same entries
+// and reports the time per frame of each.
+// Frames are generated, or read one per line from a file. The JsonIndex check also covers frames
+// with unquoted numbers, the form REST depth responses use.
+
+namespace {
+
+std::string makeFrame(int levels, int seed, bool quoted = true) {
+  std::string frame = "[{\"binary\":0,\"channel\":\"ok_sub_spot_eth_btc_depth\",\"data\":{";
+  const char *sides[] = { "asks", "bids" };
+  char level[64];
+  for(int side = 0; side < 2; side ++) {
+    frame += std::string(side ? "," : "") + "\"" + sides[side] + "\":[";
+    for(int i = 0; i < levels; i ++) {
+      snprintf(level, sizeof(level), quoted ? "%s[\"%d.%04d\",\"%d.%03d\"]" : "%s[%d.%04d, %d.%03d]", i ? "," : "",
+               side ? 99 - i : 100 + i, (seed + i) % 10000, 1 + i % 7, (seed * 7 + i) % 1000);
+      frame += level;
+    }
+    frame += "]";
+  }
+  return frame + ",\"timestamp\":1504529236946}}]";
+}
+
+// DOM path of PriceAdapter::processFrame/parseLevels
+template<typename Document>
+void parseDom(Document &doc, char *msg, long timestamp, fin::OrderBookList &entries) {
+  doc.deserialize_in_place(msg);
+  entries.resize(0);
+  if(!doc.is_array()) {
+    return;
+  }
+  for(unsigned int n = 0; n < doc.size(); n ++) {
+    if(!doc[n].has_key("channel") || !doc[n].has_key("data")) {
+      continue;
+    }
+    const auto &data = doc[n]["data"];
+    if(!data.is_object()) {
+      continue;
+    }
+    const char *sides[] = { "asks", "bids" };
+    for(int side = 0; side < 2; side ++) {
+      if(!data.has_key(sides[side])) {
+        continue;
+      }
+      const auto &arr = data[sides[side]];
+      fin::OrderBookEntry entry;
+      entry.direction = side ? fin::OrderDir::Bid : fin::OrderDir::Ask;
+      entry.timestamp = timestamp;
+      for(size_t i = 0; i < arr.size(); i ++) {
+        entry.price.assign(arr[i][0].as_string_ptr());
+        entry.amount.assign(arr[i][1].as_string_ptr());
+        entries.push_back(entry);
+      }
+    }
+  }
+}
+
+bool sameEntries(const fin::OrderBookList &a, const fin::OrderBookList &b) {
+  if(a.size() != b.size()) {
+    return false;
+  }
+  for(size_t i = 0; i < a.size(); i ++) {
+    if(a[i].direction != b[i].direction || a[i].price != b[i].price || a[i].amount != b[i].amount) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  int levels;
+  int count;
+  int iterations;
+  std::string file;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("levels,l", po::value<int>(&levels)->default_value(20), "Levels per side in generated frames")
+    ("frames,f", po::value<int>(&count)->default_value(1000), "Number of generated frames")
+    ("iterations,i", po::value<int>(&iterations)->default_value(100), "Passes over the frames")
+    ("input", po::value<std::string>(&file), "Read frames from this file, one per line");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [--levels N | --input frames.txt]\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  std::vector<std::string> frames;
+  if(!file.empty()) {
+    std::ifstream input(file);
+    std::string line;
+    while(std::getline(input, line)) {
+      if(!line.empty()) {
+        frames.push_back(line);
+      }
+    }
+  } else {
+    for(int i = 0; i < count; i ++) {
+      frames.push_back(makeFrame(levels, i));
+    }
+  }
+  if(frames.empty()) {
+    std::cerr << "No frames" << std::endl;
+    return -1;
+  }
+  std::vector<std::string> numericFrames;
+  for(int i = 0; i < 100; i ++) {
+    numericFrames.push_back(makeFrame(levels, i, false));
+  }
+
+  // Both paths get a fresh copy of the frame, the DOM parses in place
+  pjson::document doc;
+  fin::OrderBookList domEntries, scanEntries;
+  adaptor::example::DepthScanner::Update updates[adaptor::example::DepthScanner::MaxUpdates];
+  std::string copy;
+  size_t fallbacks = 0, mismatches = 0, entries = 0;
+
+  for(const auto &frame : frames) {
+    copy = frame;
+    parseDom(doc, &copy[0], 0, domEntries);
+    scanEntries.resize(0);
+    if(adaptor::example::DepthScanner::scan(frame.data(), frame.size(), 0, updates, scanEntries) < 0) {
+      fallbacks ++;
+    } else if(!sameEntries(domEntries, scanEntries)) {
+      mismatches ++;
+    }
+    entries += domEntries.size();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for(int n = 0; n < iterations; n ++) {
+    for(const auto &frame : frames) {
+      copy = frame;
+      parseDom(doc, &copy[0], 0, domEntries);
+    }
+  }
+  double dom = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for(int n = 0; n < iterations; n ++) {
+    for(const auto &frame : frames) {
+      copy = frame;
+      scanEntries.resize(0);
+      adaptor::example::DepthScanner::scan(&copy[0], copy.size(), 0, updates, scanEntries);
+    }
+  }
+  double scan = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  double total = (double)frames.size() * iterations;
+  std::cout << "Frames: " << frames.size() << ", entries per frame: " << (double)entries / frames.size()
+            << ", scanner fallbacks: " << fallbacks << ", mismatches: " << mismatches << "\n"
+            << "DOM: " << dom / total << " ns/frame\n"
+            << "Scanner: " << scan / total << " ns/frame, " << (scan > 0 ? dom / scan : 0) << "x" << std::endl;
+
+  // JsonIndex kernels up to the best one of this CPU
+  using platform::JsonIndex;
+  for(auto backend : { JsonIndex::Backend::Scalar, JsonIndex::Backend::SSE2, JsonIndex::Backend::AVX2 }) {
+    if(backend > JsonIndex::detectBackend()) {
+      continue;
+    }
+    JsonIndex index(backend);
+    fin::OrderBookList indexEntries;
+    size_t indexMismatches = 0;
+    for(const auto &frame : frames) {
+      copy = frame;
+      parseDom(doc, &copy[0], 0, domEntries);
+      copy = frame;
+      parseDom(index, &copy[0], 0, indexEntries);
+      if(!sameEntries(domEntries, indexEntries)) {
+        indexMismatches ++;
+      }
+    }
+    for(const auto &frame : numericFrames) {
+      copy = frame;
+      parseDom(doc, &copy[0], 0, domEntries);
+      copy = frame;
+      parseDom(index, &copy[0], 0, indexEntries);
+      if(!sameEntries(domEntries, indexEntries)) {
+        indexMismatches ++;
+      }
+    }
+
+    start = std::chrono::steady_clock::now();
+    for(int n = 0; n < iterations; n ++) {
+      for(const auto &frame : frames) {
+        copy = frame;
+        parseDom(index, &copy[0], 0, indexEntries);
+      }
+    }
+    double indexed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "JsonIndex " << JsonIndex::getBackendName(backend) << ": " << indexed / total << " ns/frame, "
+              << (indexed > 0 ? dom / indexed : 0) << "x, mismatches: " << indexMismatches << std::endl;
+    mismatches += indexMismatches;
+  }
+  return mismatches ? 1 : 0;
+}
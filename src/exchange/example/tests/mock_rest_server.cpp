@@ -0,0 +1,417 @@
+#include <signal.h>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+// Local mock of the example exchange REST API for HttpClient throughput tests.
+// Serves synthetic responses to depth, ticker, trades and kline requests over HTTP/1.1 with keep-alive.
+// Latency, jitter, error and timeout rates are configurable, so onHTTPError and onTimeout paths
+// can be exercised deterministically (--seed).
+
+namespace {
+
+using boost::asio::ip::tcp;
+
+struct Options {
+  int port;
+  int threads;
+  long latencyUs;     // Base response delay
+  long jitterUs;      // Uniform random addition to the delay
+  double errorRate;   // Fraction of requests answered with 500
+  double timeoutRate; // Fraction of requests never answered
+  int depth;          // Default levels per side, overridden by "size" parameter
+  unsigned seed;
+};
+
+struct Stats {
+  std::atomic<unsigned long> connections{0};
+  std::atomic<unsigned long> requests{0};
+  std::atomic<unsigned long> errors{0};
+  std::atomic<unsigned long> timeouts{0};
+  std::atomic<unsigned long> bytes{0};
+};
+
+typedef std::map<std::string, std::string> QueryParams;
+
+// Generates response bodies in the exchange format the adapter parses
+class ResponseGenerator {
+public:
+  ResponseGenerator(const Options &options, std::mt19937 &random)
+    : m_options(options)
+    , m_random(random)
+  { }
+
+  std::string depth(const QueryParams &params) {
+    int size = param(params, "size", m_options.depth);
+    double mid = price(params);
+    std::uniform_real_distribution<double> amount(0.001, 10);
+    std::string body;
+    body.reserve(64 * size + 64);
+    char level[64];
+
+    body = "{\"asks\":[";
+    for(int i = size - 1; i >= 0; i --) {
+      snprintf(level, sizeof(level), "[\"%.8f\",\"%.4f\"]%s", mid * (1.0 + 0.0001 * (i + 1)), amount(m_random), i ? "," : "");
+      body += level;
+    }
+    body += "],\"bids\":[";
+    for(int i = 0; i < size; i ++) {
+      snprintf(level, sizeof(level), "%s[\"%.8f\",\"%.4f\"]", i ? "," : "", mid * (1.0 - 0.0001 * (i + 1)), amount(m_random));
+      body += level;
+    }
+    body += "],\"timestamp\":" + boost::lexical_cast<std::string>(time(NULL)) + "}";
+    return body;
+  }
+
+  std::string ticker(const QueryParams &params) {
+    double mid = price(params);
+    char body[256];
+    snprintf(body, sizeof(body),
+             "{\"ticker\":{\"vol\":\"%.4f\",\"last\":\"%.8f\",\"sell\":\"%.8f\",\"buy\":\"%.8f\",\"high\":\"%.8f\",\"low\":\"%.8f\"},\"date\":\"%lu\"}",
+             1000.0, mid, mid * 1.0001, mid * 0.9999, mid * 1.01, mid * 0.99, (unsigned long)time(NULL) * 1000);
+    return body;
+  }
+
+  std::string trades(const QueryParams &params) {
+    int size = param(params, "size", 50);
+    long since = param(params, "since", 1L);
+    double mid = price(params);
+    std::uniform_real_distribution<double> amount(0.001, 2);
+    std::bernoulli_distribution side(0.5);
+    std::string body = "[";
+    char trade[192];
+
+    for(int i = 0; i < size; i ++) {
+      bool bid = side(m_random);
+      snprintf(trade, sizeof(trade),
+               "%s{\"amount\":\"%.4f\",\"price\":\"%.8f\",\"tid\":%ld,\"date\":%lu,\"type\":\"%s\",\"trade_type\":\"%s\"}",
+               i ? "," : "", amount(m_random), mid * (bid ? 1.0001 : 0.9999), since + i, (unsigned long)time(NULL),
+               bid ? "buy" : "sell", bid ? "bid" : "ask");
+      body += trade;
+    }
+    return body + "]";
+  }
+
+  std::string kline(const QueryParams &params) {
+    int size = param(params, "size", 200);
+    long since = param(params, "since", 0L);
+    double mid = price(params);
+    std::normal_distribution<double> step(0, 0.002);
+    std::string body = "[";
+    char candle[192];
+
+    for(int i = 0; i < size; i ++) {
+      double open = mid;
+      double close = mid * (1.0 + step(m_random));
+      snprintf(candle, sizeof(candle), "%s[%ld,%.8f,%.8f,%.8f,%.8f,%.4f]", i ? "," : "",
+               since + i * 60000L, open, std::max(open, close) * 1.001, std::min(open, close) * 0.999, close, 100.0);
+      body += candle;
+      mid = close;
+    }
+    return body + "]";
+  }
+
+private:
+  template<typename T>
+  static T param(const QueryParams &params, const char *name, T def) {
+    auto it = params.find(name);
+    if(it == params.end()) {
+      return def;
+    }
+    try {
+      return boost::lexical_cast<T>(it->second);
+    } catch(boost::bad_lexical_cast &) {
+      return def;
+    }
+  }
+
+  // Stable per-market price, so responses for the same market look alike
+  static double price(const QueryParams &params) {
+    auto it = params.find("market");
+    size_t hash = std::hash<std::string>()(it != params.end() ? it->second : std::string());
+    return 1.0 + (hash % 10000) / 100.0;
+  }
+
+  const Options &m_options;
+  std::mt19937 &m_random;
+};
+
+class Session
+  : public std::enable_shared_from_this<Session>
+{
+public:
+  Session(boost::asio::io_service &service, tcp::socket socket, const Options &options, Stats &stats, unsigned seed)
+    : m_socket(std::move(socket))
+    , m_timer(service)
+    , m_options(options)
+    , m_stats(stats)
+    , m_random(seed)
+    , m_generator(options, m_random)
+  { }
+
+  void start() {
+    m_socket.set_option(tcp::no_delay(true));
+    read();
+  }
+
+private:
+  void read() {
+    auto self = shared_from_this();
+    boost::asio::async_read_until(m_socket, m_input, "\r\n\r\n",
+      [this, self](const boost::system::error_code &error, size_t size) {
+        if(error) {
+          return;
+        }
+        std::string head(boost::asio::buffers_begin(m_input.data()), boost::asio::buffers_begin(m_input.data()) + size);
+        m_input.consume(size);
+        onRequest(head);
+      });
+  }
+
+  void onRequest(const std::string &head) {
+    m_stats.requests ++;
+
+    // Request line: METHOD SP target SP version
+    size_t start = head.find(' ');
+    size_t end = start == std::string::npos ? start : head.find(' ', start + 1);
+    if(end == std::string::npos) {
+      respond(400, "{\"error\":\"bad request\"}");
+      return;
+    }
+    std::string target = head.substr(start + 1, end - start - 1);
+    m_keepAlive = head.compare(end + 1, 8, "HTTP/1.0") != 0 && head.find("Connection: close") == std::string::npos;
+
+    std::uniform_real_distribution<double> chance(0, 1);
+    double roll = chance(m_random);
+    if(roll < m_options.timeoutRate) {
+      m_stats.timeouts ++;
+      // Never answer, the client gives up and closes the connection
+      read();
+      return;
+    }
+
+    std::string body;
+    int status = 200;
+    if(roll < m_options.timeoutRate + m_options.errorRate) {
+      m_stats.errors ++;
+      status = 500;
+      body = "{\"error\":\"internal error\"}";
+    } else {
+      status = route(target, body);
+    }
+
+    long delay = m_options.latencyUs;
+    if(m_options.jitterUs > 0) {
+      delay += std::uniform_int_distribution<long>(0, m_options.jitterUs)(m_random);
+    }
+
+    if(delay > 0) {
+      auto self = shared_from_this();
+      m_timer.expires_from_now(std::chrono::microseconds(delay));
+      m_timer.async_wait([this, self, status, body](const boost::system::error_code &error) {
+        if(!error) {
+          respond(status, body);
+        }
+      });
+    } else {
+      respond(status, body);
+    }
+  }
+
+  int route(const std::string &target, std::string &body) {
+    size_t query = target.find('?');
+    std::string path = target.substr(0, query);
+    QueryParams params;
+    if(query != std::string::npos) {
+      parseQuery(target.substr(query + 1), params);
+    }
+
+    // Base URL prefix is not significant, only the last path segment is
+    std::string method = path.substr(path.rfind('/') + 1);
+    if(method == "depth") {
+      body = m_generator.depth(params);
+    } else if(method == "ticker") {
+      body = m_generator.ticker(params);
+    } else if(method == "trades") {
+      body = m_generator.trades(params);
+    } else if(method == "kline") {
+      body = m_generator.kline(params);
+    } else {
+      body = "{\"error\":\"not found\"}";
+      return 404;
+    }
+    return 200;
+  }
+
+  static void parseQuery(const std::string &query, QueryParams &params) {
+    size_t pos = 0;
+    while(pos < query.size()) {
+      size_t amp = query.find('&', pos);
+      if(amp == std::string::npos) {
+        amp = query.size();
+      }
+      size_t eq = query.find('=', pos);
+      if(eq != std::string::npos && eq < amp) {
+        params[query.substr(pos, eq - pos)] = query.substr(eq + 1, amp - eq - 1);
+      }
+      pos = amp + 1;
+    }
+  }
+
+  void respond(int status, const std::string &body) {
+    static const std::map<int, const char*> reasons = {
+      {200, "OK"}, {400, "Bad Request"}, {404, "Not Found"}, {500, "Internal Server Error"}
+    };
+
+    m_output = "HTTP/1.1 " + boost::lexical_cast<std::string>(status) + " " + reasons.at(status) + "\r\n"
+               "Content-Type: application/json\r\n"
+               "Content-Length: " + boost::lexical_cast<std::string>(body.size()) + "\r\n" +
+               (m_keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n") +
+               "\r\n" + body;
+    m_stats.bytes += m_output.size();
+
+    auto self = shared_from_this();
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_output),
+      [this, self](const boost::system::error_code &error, size_t) {
+        if(error) {
+          return;
+        }
+        if(m_keepAlive) {
+          read();
+        } else {
+          boost::system::error_code ignored;
+          m_socket.shutdown(tcp::socket::shutdown_both, ignored);
+        }
+      });
+  }
+
+  tcp::socket m_socket;
+  boost::asio::steady_timer m_timer;
+  boost::asio::streambuf m_input;
+  std::string m_output;
+  const Options &m_options;
+  Stats &m_stats;
+  std::mt19937 m_random;
+  ResponseGenerator m_generator;
+  bool m_keepAlive = true;
+};
+
+class MockRestServer {
+public:
+  MockRestServer(boost::asio::io_service &service, const Options &options)
+    : m_service(service)
+    , m_acceptor(service, tcp::endpoint(tcp::v4(), options.port))
+    , m_socket(service)
+    , m_options(options)
+    , m_seed(options.seed)
+  {
+    accept();
+  }
+
+  Stats &getStats() { return m_stats; }
+
+private:
+  void accept() {
+    m_acceptor.async_accept(m_socket, [this](const boost::system::error_code &error) {
+      if(!error) {
+        m_stats.connections ++;
+        std::make_shared<Session>(m_service, std::move(m_socket), m_options, m_stats, m_seed ++)->start();
+      }
+      accept();
+    });
+  }
+
+  boost::asio::io_service &m_service;
+  tcp::acceptor m_acceptor;
+  tcp::socket m_socket;
+  const Options &m_options;
+  Stats m_stats;
+  unsigned m_seed;
+};
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+  Options options;
+
+  po::options_description description("Options");
+  description.add_options()
+    ("help,h", "Show help")
+    ("port,p", po::value<int>(&options.port)->default_value(8080), "Port to listen on")
+    ("threads,t", po::value<int>(&options.threads)->default_value(1), "Server threads")
+    ("latency,l", po::value<long>(&options.latencyUs)->default_value(0), "Response delay, microseconds")
+    ("jitter,j", po::value<long>(&options.jitterUs)->default_value(0), "Random extra delay up to this value, microseconds")
+    ("error-rate,e", po::value<double>(&options.errorRate)->default_value(0), "Fraction of requests answered with HTTP 500")
+    ("timeout-rate", po::value<double>(&options.timeoutRate)->default_value(0), "Fraction of requests never answered")
+    ("depth,d", po::value<int>(&options.depth)->default_value(200), "Default depth levels per side")
+    ("seed", po::value<unsigned>(&options.seed)->default_value(12345), "Random seed");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [options]\n" << description << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << description << std::endl;
+    return -1;
+  }
+
+  boost::asio::io_service service;
+  std::unique_ptr<MockRestServer> server;
+  try {
+    server.reset(new MockRestServer(service, options));
+  } catch(std::exception &e) {
+    std::cerr << "Can not listen on port " << options.port << ": " << e.what() << std::endl;
+    return -1;
+  }
+
+  boost::asio::signal_set signals(service, SIGINT, SIGTERM);
+  signals.async_wait([&service](const boost::system::error_code &, int) { service.stop(); });
+
+  // Per-second statistics
+  boost::asio::steady_timer reportTimer(service);
+  unsigned long lastRequests = 0;
+  std::function<void(const boost::system::error_code&)> report = [&](const boost::system::error_code &error) {
+    if(error) {
+      return;
+    }
+    Stats &stats = server->getStats();
+    unsigned long requests = stats.requests;
+    std::cout << "connections: " << stats.connections
+              << ", requests: " << requests - lastRequests << "/s"
+              << ", errors: " << stats.errors
+              << ", timeouts: " << stats.timeouts
+              << ", sent: " << stats.bytes / 1024 << " KiB" << std::endl;
+    lastRequests = requests;
+    reportTimer.expires_from_now(std::chrono::seconds(1));
+    reportTimer.async_wait(report);
+  };
+  reportTimer.expires_from_now(std::chrono::seconds(1));
+  reportTimer.async_wait(report);
+
+  std::cout << "Mock REST exchange listening on http://localhost:" << options.port << "/data/v1/" << std::endl;
+
+  std::vector<std::thread> threads;
+  for(int i = 1; i < options.threads; i ++) {
+    threads.emplace_back([&service]() { service.run(); });
+  }
+  service.run();
+  for(auto &thread : threads) {
+    thread.join();
+  }
+  return 0;
+}
@@ -0,0 +1,406 @@
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <libwebsockets.h>
+
+// Local mock of the example exchange WebSocket API for offline load testing.
+// Speaks the same protocol as WSPriceConnector expects:
+//  - {"event":"ping"} is answered with {"event":"pong"}
+//  - {"event":"addChannel","channel":"ok_sub_spot_<instrument>_depth"} streams synthetic depth snapshots
+//  - {"event":"addChannel","channel":"ok_sub_spot_<instrument>_deals"} streams synthetic trades
+// Subscriptions may also come as a JSON array of addChannel events in one frame.
+// With --shared-feed all connections subscribed to a channel get identical messages at the same
+// time, like the real exchange does, so redundant connections can be arbitrated.
+
+namespace {
+
+volatile sig_atomic_t g_running = 1;
+
+unsigned long now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
+struct Options {
+  int port;
+  double rate;           // Messages per second per subscription
+  int depth;             // Levels per side in depth messages
+  size_t maxQueue;       // Max queued messages per connection before dropping
+  bool ackSubscriptions; // Send addChannel acknowledgements
+  bool sharedFeed;       // Same message sequence for all subscribers of a channel
+};
+
+struct Book {
+  double mid;
+  unsigned long tradeId;
+};
+
+struct Subscription {
+  enum Kind {
+    Depth = 0,
+    Deals
+  };
+
+  std::string channel;
+  std::string instrument;
+  Kind kind;
+  unsigned long next;
+};
+
+struct Session {
+  std::vector<Subscription> subscriptions;
+  std::deque<std::string> outgoing; // Each message is prefixed with LWS_PRE bytes
+  std::string incoming;
+  unsigned long sent = 0;
+  unsigned long dropped = 0;
+};
+
+class MockExchange {
+public:
+  MockExchange(const Options &options)
+    : m_options(options)
+    , m_random(12345)
+    , m_sent(0)
+    , m_dropped(0)
+    , m_connections(0)
+  {
+    m_period = m_options.rate > 0 ? (unsigned long)(1e9 / m_options.rate) : 0;
+    m_buffer.reserve(64 * 1024);
+  }
+
+  static int callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len) {
+    MockExchange *server = (MockExchange*)lws_context_user(lws_get_context(wsi));
+    Session **session = (Session**)user;
+
+    switch(reason) {
+    case LWS_CALLBACK_ESTABLISHED:
+      *session = new Session;
+      server->m_sessions[wsi] = *session;
+      server->m_connections ++;
+      break;
+    case LWS_CALLBACK_RECEIVE:
+      if(*session) {
+        (*session)->incoming.append((const char*)in, len);
+        if(!lws_remaining_packet_payload(wsi) && lws_is_final_fragment(wsi)) {
+          server->onMessage(wsi, **session);
+          (*session)->incoming.clear();
+        }
+      }
+      break;
+    case LWS_CALLBACK_SERVER_WRITEABLE:
+      if(*session) {
+        return server->onWritable(wsi, **session);
+      }
+      break;
+    case LWS_CALLBACK_CLOSED:
+      if(*session) {
+        server->m_sessions.erase(wsi);
+        server->m_connections --;
+        delete *session;
+        *session = NULL;
+      }
+      break;
+    default:
+      break;
+    }
+    return 0;
+  }
+
+  // Generate messages that are due for all subscriptions
+  void tick() {
+    unsigned long ts = now();
+    for(auto &kv : m_sessions) {
+      Session &session = *kv.second;
+      bool queued = false;
+      for(auto &sub : session.subscriptions) {
+        while(m_period && sub.next <= ts) {
+          sub.next += m_period;
+          if(session.outgoing.size() >= m_options.maxQueue) {
+            session.dropped ++;
+            m_dropped ++;
+            continue;
+          }
+          queue(session, message(sub, sub.next - m_period));
+          queued = true;
+        }
+      }
+      if(queued) {
+        lws_callback_on_writable(kv.first);
+      }
+    }
+  }
+
+  void report(double seconds) {
+    std::cout << "connections: " << m_connections
+              << ", sent: " << (unsigned long)(m_sent / seconds) << " msg/s"
+              << ", dropped: " << m_dropped << std::endl;
+    m_sent = 0;
+    m_dropped = 0;
+  }
+
+private:
+  // Generates the message of the subscription due at the time slot, shared feed reuses it for all sessions
+  const std::string &message(const Subscription &sub, unsigned long slot) {
+    if(m_options.sharedFeed) {
+      auto &cached = m_feed[sub.channel];
+      if(cached.first != slot || cached.second.empty()) {
+        cached.first = slot;
+        cached.second = sub.kind == Subscription::Depth ? depthMessage(sub) : dealsMessage(sub);
+      }
+      return cached.second;
+    }
+    return sub.kind == Subscription::Depth ? depthMessage(sub) : dealsMessage(sub);
+  }
+
+  void queue(Session &session, const std::string &message) {
+    std::string frame(LWS_PRE, '\0');
+    frame.append(message);
+    session.outgoing.emplace_back(std::move(frame));
+  }
+
+  int onWritable(struct lws *wsi, Session &session) {
+    if(session.outgoing.empty()) {
+      return 0;
+    }
+
+    std::string &frame = session.outgoing.front();
+    int result = lws_write(wsi, (unsigned char*)&frame[LWS_PRE], frame.size() - LWS_PRE, LWS_WRITE_TEXT);
+    session.outgoing.pop_front();
+    if(result < 0) {
+      return -1;
+    }
+
+    session.sent ++;
+    m_sent ++;
+    if(!session.outgoing.empty()) {
+      lws_callback_on_writable(wsi);
+    }
+    return 0;
+  }
+
+  void onMessage(struct lws *wsi, Session &session) {
+    const std::string &msg = session.incoming;
+
+    if(msg.find("\"event\":\"ping\"") != std::string::npos) {
+      queue(session, "{\"event\":\"pong\"}");
+    }
+
+    if(msg.find("\"event\":\"addChannel\"") != std::string::npos) {
+      static const std::string key = "\"channel\":\"";
+      size_t pos = 0;
+      std::string acks;
+      while((pos = msg.find(key, pos)) != std::string::npos) {
+        pos += key.size();
+        size_t end = msg.find('"', pos);
+        if(end == std::string::npos) {
+          break;
+        }
+        std::string channel = msg.substr(pos, end - pos);
+        pos = end;
+        if(subscribe(session, channel) && m_options.ackSubscriptions) {
+          if(!acks.empty()) {
+            acks += ",";
+          }
+          acks += "{\"binary\":0,\"channel\":\"addChannel\",\"data\":{\"result\":true,\"channel\":\"" + channel + "\"}}";
+        }
+      }
+      if(!acks.empty()) {
+        queue(session, "[" + acks + "]");
+      }
+    }
+
+    lws_callback_on_writable(wsi);
+  }
+
+  bool subscribe(Session &session, const std::string &channel) {
+    static const std::string prefix = "ok_sub_spot_";
+    static const std::string depth = "_depth";
+    static const std::string deals = "_deals";
+
+    if(channel.compare(0, prefix.size(), prefix)) {
+      return false;
+    }
+
+    Subscription sub;
+    sub.channel = channel;
+    sub.next = now();
+    if(m_options.sharedFeed && m_period) {
+      sub.next = (sub.next / m_period + 1) * m_period; // Align to the slots of the other sessions
+    }
+    if(channel.size() > prefix.size() + depth.size() &&
+       !channel.compare(channel.size() - depth.size(), depth.size(), depth)) {
+      sub.kind = Subscription::Depth;
+      sub.instrument = channel.substr(prefix.size(), channel.size() - prefix.size() - depth.size());
+    } else if(channel.size() > prefix.size() + deals.size() &&
+              !channel.compare(channel.size() - deals.size(), deals.size(), deals)) {
+      sub.kind = Subscription::Deals;
+      sub.instrument = channel.substr(prefix.size(), channel.size() - prefix.size() - deals.size());
+    } else {
+      return false;
+    }
+
+    for(const auto &existing : session.subscriptions) {
+      if(existing.channel == channel) {
+        return true;
+      }
+    }
+
+    if(m_books.find(sub.instrument) == m_books.end()) {
+      m_books[sub.instrument] = Book{ 100.0 + m_books.size(), 1 };
+    }
+    session.subscriptions.emplace_back(std::move(sub));
+    return true;
+  }
+
+  Book &walk(const std::string &instrument) {
+    std::normal_distribution<double> step(0, 0.0005);
+    Book &book = m_books[instrument];
+    book.mid *= 1.0 + step(m_random);
+    return book;
+  }
+
+  const std::string &depthMessage(const Subscription &sub) {
+    Book &book = walk(sub.instrument);
+    std::uniform_real_distribution<double> amount(0.001, 10);
+    char level[64];
+
+    m_buffer = "[{\"binary\":0,\"channel\":\"" + sub.channel + "\",\"data\":{\"asks\":[";
+    // Asks go from the highest to the best one, like the exchange sends them
+    for(int i = m_options.depth - 1; i >= 0; i --) {
+      snprintf(level, sizeof(level), "[\"%.8f\",\"%.4f\"]%s", book.mid * (1.0 + 0.0001 * (i + 1)), amount(m_random), i ? "," : "");
+      m_buffer += level;
+    }
+    m_buffer += "],\"bids\":[";
+    for(int i = 0; i < m_options.depth; i ++) {
+      snprintf(level, sizeof(level), "%s[\"%.8f\",\"%.4f\"]", i ? "," : "", book.mid * (1.0 - 0.0001 * (i + 1)), amount(m_random));
+      m_buffer += level;
+    }
+    snprintf(level, sizeof(level), "],\"timestamp\":%lu}}]", now() / 1000000);
+    m_buffer += level;
+    return m_buffer;
+  }
+
+  const std::string &dealsMessage(const Subscription &sub) {
+    Book &book = walk(sub.instrument);
+    std::uniform_real_distribution<double> amount(0.001, 2);
+    std::bernoulli_distribution side(0.5);
+    time_t seconds = time(NULL);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    char deal[128];
+
+    bool ask = side(m_random);
+    snprintf(deal, sizeof(deal), "[\"%lu\",\"%.8f\",\"%.4f\",\"%02d:%02d:%02d\",\"%s\"]",
+             book.tradeId ++, book.mid * (ask ? 0.9999 : 1.0001), amount(m_random),
+             tm.tm_hour, tm.tm_min, tm.tm_sec, ask ? "ask" : "bid");
+    m_buffer = "[{\"binary\":0,\"channel\":\"" + sub.channel + "\",\"data\":[" + deal + "]}]";
+    return m_buffer;
+  }
+
+  Options m_options;
+  std::mt19937 m_random;
+  unsigned long m_period;
+  std::map<struct lws*, Session*> m_sessions;
+  std::map<std::string, Book> m_books;
+  std::map<std::string, std::pair<unsigned long, std::string>> m_feed; // Last message of each channel by slot
+  std::string m_buffer;
+  unsigned long m_sent;
+  unsigned long m_dropped;
+  int m_connections;
+};
+
+void onSignal(int) {
+  g_running = 0;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+  Options options;
+
+  po::options_description description("Options");
+  description.add_options()
+    ("help,h", "Show help")
+    ("port,p", po::value<int>(&options.port)->default_value(9999), "Port to listen on")
+    ("rate,r", po::value<double>(&options.rate)->default_value(10), "Messages per second per subscription")
+    ("depth,d", po::value<int>(&options.depth)->default_value(20), "Levels per side in depth messages")
+    ("max-queue", po::value<size_t>(&options.maxQueue)->default_value(10000), "Messages queued per connection before dropping")
+    ("no-ack", "Do not acknowledge addChannel subscriptions")
+    ("shared-feed", "Send identical messages to all subscribers of a channel")
+    ("deflate", "Accept permessage-deflate when the client offers it");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [options]\n" << description << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << description << std::endl;
+    return -1;
+  }
+  options.ackSubscriptions = !vm.count("no-ack");
+  options.sharedFeed = vm.count("shared-feed") > 0;
+
+  MockExchange server(options);
+
+  struct lws_protocols protocols[] = {
+    { "default-protocol", &MockExchange::callback, sizeof(Session*), 4096, 0, NULL },
+    { NULL, NULL, 0, 0 } /* terminator */
+  };
+
+  lws_set_log_level(LLL_ERR | LLL_WARN, NULL);
+
+  lws_context_creation_info info;
+  memset(&info, 0, sizeof(info));
+  info.port = options.port;
+  info.protocols = protocols;
+  info.gid = -1;
+  info.uid = -1;
+  info.user = &server;
+
+  static const struct lws_extension extensions[] = {
+    { "permessage-deflate", lws_extension_callback_pm_deflate, "permessage-deflate" },
+    { NULL, NULL, NULL } /* terminator */
+  };
+  if(vm.count("deflate")) {
+    info.extensions = extensions;
+  }
+
+  lws_context *context = lws_create_context(&info);
+  if(!context) {
+    std::cerr << "Can not create server context on port " << options.port << std::endl;
+    return -1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  std::cout << "Mock exchange listening on ws://localhost:" << options.port << "/websocket" << std::endl;
+
+  unsigned long lastReport = now();
+  while(g_running) {
+    server.tick();
+    lws_service(context, 1);
+
+    unsigned long ts = now();
+    if(ts - lastReport >= 1000000000ul) {
+      server.report((ts - lastReport) / 1e9);
+      lastReport = ts;
+    }
+  }
+
+  lws_context_destroy(context);
+  return 0;
+}
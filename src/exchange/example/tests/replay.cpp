@@ -0,0 +1,244 @@
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <boost/program_options.hpp>
+#include <pjson.h>
+
+#include "example/adapter_price.h"
+#include "fin/broadcast_observer.h"
+#include "fin/instrument_registry.h"
+#include "fin/shm_publisher.h"
+#include "platform/log.h"
+#include "platform/thread_topology.h"
+#include "platform/timer.h"
+#include "platform/ws_replay.h"
+
+// Replays recorded WebSocket journals through PriceAdapter and reports parse->book throughput
+
+class CountingObserver
+  : public fin::interface::StockDataObserver
+{
+public:
+  virtual void invalidateData(fin::InstrumentHandle, fin::ProfilingTag) override { }
+  virtual void orderbookEntryAdded(fin::OrderBookEntry, fin::ProfilingTag) override { entries ++; }
+  virtual void orderbookEntriesBulk(fin::OrderBookList list, fin::ProfilingTag) override { entries += list.size(); updates ++; }
+  virtual void orderbookEntriesSpan(fin::OrderBookSpan span, fin::ProfilingTag) override { entries += span.size; updates ++; }
+  virtual void candleStickEntryAdded(fin::CandleStickEntry, fin::ProfilingTag) override { }
+  virtual void symbolAdded(fin::SymbolHandle, fin::ProfilingTag) override { }
+  virtual void instrumentAdded(fin::InstrumentHandle, fin::ProfilingTag) override { }
+  virtual void dataConnectorError(std::exception_ptr) override { errors ++; }
+
+  // Updated from the parse workers when "parse-workers" is configured
+  std::atomic<unsigned long> entries{0};
+  std::atomic<unsigned long> updates{0};
+  std::atomic<unsigned long> errors{0};
+};
+
+// Reads the broadcast ring on its own thread, as a strategy attached to the connector would
+class BroadcastConsumer
+{
+public:
+  BroadcastConsumer(fin::MarketDataRing &ring)
+    : m_ring(ring)
+    , m_cursor(ring.subscribe())
+    , m_running(true)
+    , m_thread([this]() { run(); })
+  { }
+
+  ~BroadcastConsumer() {
+    m_running = false;
+    m_thread.join();
+  }
+
+  // Events consumed or skipped, equals published once the consumer caught up
+  uint64_t getSeen() const { return entries + invalidations + lost; }
+
+  std::atomic<unsigned long> entries{0};
+  std::atomic<unsigned long> updates{0};
+  std::atomic<unsigned long> invalidations{0};
+  std::atomic<uint64_t> lost{0};
+
+private:
+  void run() {
+    while(m_running.load(std::memory_order_relaxed)) {
+      size_t count = m_ring.poll(m_cursor, [this](const fin::MarketDataEvent &event) {
+                                   if(event.type == fin::MarketDataEvent::Type::Invalidate) {
+                                     invalidations.fetch_add(1, std::memory_order_relaxed);
+                                   } else {
+                                     entries.fetch_add(1, std::memory_order_relaxed);
+                                     if(event.index + 1 == event.count) {
+                                       updates.fetch_add(1, std::memory_order_relaxed);
+                                     }
+                                   }
+                                 }, 1024);
+      lost.store(m_cursor.getLost(), std::memory_order_relaxed);
+      if(!count && !m_ring.getLag(m_cursor)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  fin::MarketDataRing &m_ring;
+  fin::MarketDataRing::Cursor m_cursor;
+  std::atomic<bool> m_running;
+  std::thread m_thread;
+};
+
+// Registers every instrument mentioned in the adapter dictionary
+static void registerInstruments(std::string config) {
+  pjson::document doc;
+  doc.deserialize_in_place(&config[0]);
+  if(!doc.has_key("dictionary")) {
+    return;
+  }
+
+  const auto &dictionary = doc["dictionary"];
+  for(unsigned int i = 0; i < dictionary.get_object().size(); i ++) {
+    const auto &pair = dictionary.get_object()[i].get_value();
+    if(pair.is_array()) {
+      fin::InstrumentRegistry::instance().addSymbol(pair[0].as_string_ptr());
+      fin::InstrumentRegistry::instance().addSymbol(pair[1].as_string_ptr());
+      fin::InstrumentRegistry::instance().addInstrument(pair[0].as_string_ptr(), pair[1].as_string_ptr());
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  std::string configFile;
+  std::string mode;
+  double speed;
+  uint32_t connection;
+  int repeat;
+  std::string shmName;
+  size_t shmCapacity;
+  int broadcastConsumers;
+  size_t broadcastCapacity;
+  std::vector<std::string> files;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("config,c", po::value<std::string>(&configFile)->required(), "Adapter config (json with \"dictionary\")")
+    ("mode,m", po::value<std::string>(&mode)->default_value("fast"), "Pacing: original, accelerated or fast")
+    ("speed,s", po::value<double>(&speed)->default_value(10.0), "Speed factor for accelerated mode")
+    ("connection", po::value<uint32_t>(&connection)->default_value(0), "Replay only this connection ID")
+    ("repeat,r", po::value<int>(&repeat)->default_value(1), "Replay the journals this many times")
+    ("shm", po::value<std::string>(&shmName), "Also publish the books into this shared memory segment")
+    ("shm-capacity", po::value<size_t>(&shmCapacity)->default_value(1 << 16), "Shared memory ring size in deltas")
+    ("broadcast", po::value<int>(&broadcastConsumers)->default_value(0), "Publish the books into a broadcast ring read by this many consumer threads")
+    ("broadcast-capacity", po::value<size_t>(&broadcastCapacity)->default_value(1 << 16), "Broadcast ring size in events")
+    ("journal", po::value<std::vector<std::string>>(&files), "Journal files");
+
+  po::positional_options_description positional;
+  positional.add("journal", -1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(options).positional(positional).run(), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " -c config.json journal.wsj...\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+    if(broadcastConsumers && !shmName.empty()) {
+      throw std::invalid_argument("--broadcast and --shm can not be combined");
+    }
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  platform::Logger logger;
+  platform::TimerService timerService;
+  fin::InstrumentRegistry registry;
+
+  std::ifstream input(configFile);
+  std::stringstream config;
+  config << input.rdbuf();
+  registerInstruments(config.str());
+  // "threads" and "mlock"; threads already running are placed now, later ones when they start
+  platform::ThreadTopology::instance().configure(config.str());
+
+  CountingObserver observer;
+  fin::interface::StockDataObserver *sink = &observer;
+  std::unique_ptr<fin::ShmPublisher> publisher;
+  if(!shmName.empty()) {
+    publisher.reset(new fin::ShmPublisher(shmName, shmCapacity, 256, &observer));
+    sink = publisher.get();
+  }
+
+  // Kept on the stack, the ring is over-aligned; unused it holds a single slot.
+  fin::BroadcastObserver broadcast(broadcastConsumers ? broadcastCapacity : 1, &observer);
+  std::vector<std::unique_ptr<BroadcastConsumer>> consumers;
+  if(broadcastConsumers) {
+    sink = &broadcast;
+  }
+
+  adaptor::example::PriceAdapter adapter(sink);
+  adapter.config(config.str());
+  // Frames are routed by channel name, which subscribing registers; nothing is sent before start()
+  auto instruments = fin::InstrumentRegistry::instance().getInstruments();
+  adapter.subscribe(fin::InstrumentsList(instruments.begin(), instruments.end()));
+  platform::ThreadTopology::instance().report();
+
+  platform::WSReplay replay(&adapter);
+  replay.setConnectionFilter(connection);
+  if(mode == "original") {
+    replay.setMode(platform::WSReplay::Mode::Original);
+  } else if(mode == "accelerated") {
+    replay.setMode(platform::WSReplay::Mode::Accelerated, speed);
+  } else {
+    replay.setMode(platform::WSReplay::Mode::AsFastAsPossible);
+  }
+
+  for(const auto &file : files) {
+    replay.addFile(file);
+  }
+
+  for(int i = 0; i < broadcastConsumers; i ++) {
+    consumers.emplace_back(new BroadcastConsumer(broadcast.getRing()));
+  }
+
+  for(int i = 0; i < repeat; i ++) {
+    replay.run();
+    // Let the consumers drain the ring, so the counters below cover the whole run
+    for(const auto &consumer : consumers) {
+      while(consumer->getSeen() < broadcast.getRing().getPublished()) {
+        std::this_thread::yield();
+      }
+    }
+    double seconds = replay.getElapsed() / 1e9;
+    std::cout << "Frames: " << replay.getFrames()
+              << ", bytes: " << replay.getBytes()
+              << ", elapsed: " << seconds << "s"
+              << ", rate: " << (seconds > 0 ? replay.getFrames() / seconds : 0) << " msg/s"
+              << ", book updates: " << observer.updates
+              << ", entries: " << observer.entries;
+    if(publisher) {
+      std::cout << ", shm deltas: " << publisher->getPublished();
+    }
+    for(size_t c = 0; c < consumers.size(); c ++) {
+      std::cout << "\nBroadcast consumer " << c
+                << ": book updates: " << consumers[c]->updates
+                << ", entries: " << consumers[c]->entries
+                << ", invalidations: " << consumers[c]->invalidations
+                << ", lost: " << consumers[c]->lost;
+    }
+    auto json = adapter.getJsonStats();
+    std::cout << "\nJSON documents: " << json.documents
+              << ", parses: " << json.parses
+              << ", grown: " << json.grows
+              << ", max used: " << json.maxUsed << " bytes"
+              << ", held: " << json.allocated << " bytes";
+    std::cout << std::endl;
+  }
+
+  consumers.clear();
+  logger.stop();
+  return 0;
+}
@@ -0,0 +1,204 @@
+#include <signal.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "example/connector_rest_price.h"
+#include "platform/clock.h"
+#include "platform/http.h"
+
+// Keeps a fixed number of REST requests in flight against the mock exchange (mock_rest_server)
+// and reports HttpClient throughput, latency percentiles, HTTP errors and timeouts.
+// Connection reuse is reported by the server (connections vs requests).
+
+namespace {
+
+volatile sig_atomic_t g_running = 1;
+
+void onSignal(int) {
+  g_running = 0;
+}
+
+struct SentAt
+  : public connector::example::RequestContext
+{
+  SentAt(unsigned long ts)
+    : timestamp(ts)
+  { }
+  unsigned long timestamp;
+};
+
+class LoadConnector
+  : public connector::example::RESTPriceConnector
+{
+public:
+  LoadConnector(const std::string &endpoint, const std::string &market, int size)
+    : m_endpoint(endpoint)
+    , m_market(market)
+    , m_size(size)
+    , m_next(0)
+  { }
+
+  // Issues one request, picking the endpoint round-robin in "mix" mode
+  void send() {
+    static const char *endpoints[] = { "depth", "ticker", "trades", "kline" };
+    std::string endpoint = m_endpoint == "mix" ? endpoints[m_next ++ % 4] : m_endpoint;
+    SentAt *context = new SentAt(platform::Clock::instance().now());
+    m_inFlight ++;
+
+    if(endpoint == "ticker") {
+      getTicker(m_market.c_str(), context);
+    } else if(endpoint == "trades") {
+      getTrades(m_market.c_str(), 1, context);
+    } else if(endpoint == "kline") {
+      getKline(m_market.c_str(), "1min", m_size, 0, context);
+    } else {
+      getDepth(m_market.c_str(), m_size, context);
+    }
+  }
+
+  virtual void onDepthResponse(std::string data, const char *, connector::example::RequestContext *userdata) override { done(userdata, data.size()); }
+  virtual void onTickerResponse(std::string data, const char *, connector::example::RequestContext *userdata) override { done(userdata, data.size()); }
+  virtual void onTradesResponse(std::string data, const char *, connector::example::RequestContext *userdata) override { done(userdata, data.size()); }
+  virtual void onKlineResponse(std::string data, const char *, connector::example::RequestContext *userdata) override { done(userdata, data.size()); }
+
+  virtual void onTimeout(std::string, connector::example::RequestContext *userdata) override {
+    m_timeouts ++;
+    done(userdata, 0, false);
+  }
+
+  virtual void onHTTPError(std::string, const platform::HttpResponse *, connector::example::RequestContext *userdata) override {
+    m_errors ++;
+    done(userdata, 0, false);
+  }
+
+  // Prints statistics for the last period and resets them
+  void report(double seconds) {
+    std::vector<unsigned long> latencies;
+    unsigned long bytes;
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      latencies.swap(m_latencies);
+      bytes = m_bytes;
+      m_bytes = 0;
+    }
+
+    std::cout << "requests: " << (unsigned long)(latencies.size() / seconds) << "/s"
+              << ", received: " << (unsigned long)(bytes / seconds / 1024) << " KiB/s"
+              << ", errors: " << m_errors
+              << ", timeouts: " << m_timeouts;
+
+    if(!latencies.empty()) {
+      std::sort(latencies.begin(), latencies.end());
+      auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, (size_t)(latencies.size() * p))] / 1000.0;
+      };
+      std::cout << ", latency us p50: " << percentile(0.5)
+                << " p99: " << percentile(0.99)
+                << " p99.9: " << percentile(0.999)
+                << " max: " << latencies.back() / 1000.0;
+    }
+    std::cout << std::endl;
+  }
+
+  int getInFlight() const { return m_inFlight; }
+
+private:
+  // Called on the HttpClient thread, keeps the window full by sending the next request
+  void done(connector::example::RequestContext *userdata, size_t size, bool success = true) {
+    unsigned long now = platform::Clock::instance().now();
+    SentAt *context = static_cast<SentAt*>(userdata);
+    if(success) {
+      std::lock_guard<std::mutex> lock(m_lock);
+      m_latencies.push_back(now - context->timestamp);
+      m_bytes += size;
+    }
+    delete context;
+
+    m_inFlight --;
+    if(g_running) {
+      send();
+    }
+  }
+
+  std::string m_endpoint;
+  std::string m_market;
+  int m_size;
+  unsigned int m_next;
+  std::atomic<int> m_inFlight{0};
+  std::atomic<unsigned long> m_errors{0};
+  std::atomic<unsigned long> m_timeouts{0};
+  std::mutex m_lock;
+  std::vector<unsigned long> m_latencies;
+  unsigned long m_bytes = 0;
+};
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  std::string url;
+  std::string endpoint;
+  std::string market;
+  int concurrency;
+  int size;
+  long timeout;
+  int duration;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("url,u", po::value<std::string>(&url)->default_value("http://localhost:8080/data/v1/"), "Mock exchange base URL")
+    ("endpoint,e", po::value<std::string>(&endpoint)->default_value("depth"), "depth, ticker, trades, kline or mix")
+    ("market,m", po::value<std::string>(&market)->default_value("btc_usdt"), "Market to request")
+    ("concurrency,n", po::value<int>(&concurrency)->default_value(16), "Requests in flight")
+    ("size,s", po::value<int>(&size)->default_value(200), "Depth/kline size parameter")
+    ("timeout,t", po::value<long>(&timeout)->default_value(2000), "Response timeout, milliseconds")
+    ("duration,d", po::value<int>(&duration)->default_value(10), "Seconds to run, 0 runs until interrupted");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [options]\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  platform::HttpClient httpclient;
+
+  LoadConnector connector(endpoint, market, size);
+  connector.setBaseUrl(url.c_str());
+  connector.setTimeout(timeout);
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  for(int i = 0; i < concurrency; i ++) {
+    connector.send();
+  }
+
+  auto last = platform::Clock::instance().now();
+  for(int elapsed = 0; g_running && (!duration || elapsed < duration); elapsed ++) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    auto now = platform::Clock::instance().now();
+    connector.report((now - last) / 1e9);
+    last = now;
+  }
+
+  // Let outstanding requests complete before the connector goes away
+  g_running = 0;
+  for(int i = 0; connector.getInFlight() > 0 && i < timeout / 10 + 100; i ++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return 0;
+}
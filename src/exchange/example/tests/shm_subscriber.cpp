@@ -0,0 +1,123 @@
+#include <signal.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <boost/program_options.hpp>
+
+#include "platform/shm_market_data.h"
+
+// Example reader of the shared memory market data feed (fin::ShmPublisher).
+// Follows the delta ring and prints delta rate, lag, losses and the top of book table every interval.
+// Links only against the shm_subscriber library.
+
+namespace {
+
+std::atomic<bool> running(true);
+
+void onSignal(int) {
+  running = false;
+}
+
+void printTopOfBook(const platform::ShmMarketDataSubscriber &subscriber, const std::string &filter) {
+  for(uint32_t i = 0; i < subscriber.getInstrumentCount(); i ++) {
+    const char *name = subscriber.getInstrumentName(i);
+    if(!filter.empty() && filter != name) {
+      continue;
+    }
+
+    platform::ShmTopOfBook book;
+    if(subscriber.getTopOfBook(i, book)) {
+      std::cout << "  " << std::setw(16) << std::left << name << std::right
+                << " bid " << platform::ShmMarketDataSubscriber::toDouble(book.bidPrice)
+                << " x " << platform::ShmMarketDataSubscriber::toDouble(book.bidAmount)
+                << "  ask " << platform::ShmMarketDataSubscriber::toDouble(book.askPrice)
+                << " x " << platform::ShmMarketDataSubscriber::toDouble(book.askAmount)
+                << "  updates " << book.updates << "\n";
+    }
+  }
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  std::string name;
+  std::string instrument;
+  double interval;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("name,n", po::value<std::string>(&name)->default_value("/cryptoadapter-md"), "Shared memory segment name")
+    ("instrument,i", po::value<std::string>(&instrument), "Print only this instrument (BASE/QUOTE)")
+    ("interval", po::value<double>(&interval)->default_value(1.0), "Report interval, seconds");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [-n /segment]\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  try {
+    platform::ShmMarketDataSubscriber subscriber(name);
+    platform::ShmMarketDataSubscriber::Cursor cursor = subscriber.subscribe();
+
+    unsigned long deltas = 0, batches = 0, clears = 0;
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval));
+    auto reportTime = std::chrono::steady_clock::now() + period;
+
+    while(running) {
+      size_t count = subscriber.poll(cursor, [&](const platform::ShmDelta &delta) {
+                                       deltas ++;
+                                       if(delta.flags & platform::ShmDelta::BatchEnd) {
+                                         batches ++;
+                                       }
+                                       if(delta.type == platform::ShmDelta::Clear) {
+                                         clears ++;
+                                       }
+                                     }, 1024);
+
+      // Overrun leaves the cursor at the oldest delta, the next poll continues from there
+      if(!count && subscriber.getLag(cursor) == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+
+      auto now = std::chrono::steady_clock::now();
+      if(now >= reportTime) {
+        std::cout << "Deltas: " << deltas / interval << "/s"
+                  << ", batches: " << batches / interval << "/s"
+                  << ", clears: " << clears
+                  << ", lag: " << subscriber.getLag(cursor)
+                  << ", lost: " << cursor.getLost() << "\n";
+        printTopOfBook(subscriber, instrument);
+        std::cout << std::flush;
+
+        deltas = batches = clears = 0;
+        reportTime = now + period;
+
+        if(!subscriber.isPublisherAlive()) {
+          std::cout << "Publisher is gone" << std::endl;
+          break;
+        }
+      }
+    }
+  } catch(std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
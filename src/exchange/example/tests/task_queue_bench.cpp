@@ -0,0 +1,389 @@
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "platform/task_queue.h"
+
+// Pushes tasks into a platform::TaskQueue from 1 to N producer threads, with the spinlock queue
+// and with the lock-free ring, and reports the throughput and the time producers spend handing a task over:
+// a Task allocated with new, a small lambda stored in the ring slot, or a large lambda in a pooled task.
+// Then measures, for each wait strategy, the wake-up latency of a queue left idle between tasks
+// and the CPU its consumer thread burns while idle.
+// Last, market data bursts and sparse order events share one queue, without lanes and with priority lanes,
+// and the latency of the order events is reported; with "plain posts" market data is posted without a lane index
+// and must land in the lowest lane.
+
+namespace {
+
+using platform::QueueFullPolicy;
+using platform::QueueWait;
+using platform::LaneDrain;
+using platform::Task;
+using platform::TaskQueue;
+
+struct Counter {
+  unsigned long value = 0; // Consumer thread only
+};
+
+class CountTask
+  : public Task
+{
+public:
+  CountTask(Counter *counter) : m_counter(counter) { }
+  virtual void run(TaskQueue*) override { m_counter->value ++; }
+
+private:
+  Counter *m_counter;
+};
+
+enum class Handoff {
+  New,    // push(new Task), deleted by the consumer
+  Inline, // post() of a lambda which fits a ring slot
+  Pooled  // post() of a lambda too large for a slot, FunctionTask from TaskPool
+};
+
+const char *handoffName(Handoff handoff) {
+  return handoff == Handoff::New ? "new   " : handoff == Handoff::Inline ? "inline" : "pooled";
+}
+
+struct Result {
+  double seconds;
+  double pushNs;       // Mean time per task handed over by a producer, allocation included
+  unsigned long ran;
+  unsigned long dropped;
+  unsigned long overflowed;
+};
+
+Result runOnce(size_t capacity, QueueFullPolicy policy, Handoff handoff, int producers, long tasks) {
+  std::unique_ptr<TaskQueue> queue(capacity ? new TaskQueue(capacity, policy) : new TaskQueue());
+  Counter counter;
+  std::thread consumer([&queue]() { queue->run(); });
+  while(!queue->running()) {
+    std::this_thread::yield();
+  }
+
+  std::vector<double> pushTimes(producers);
+  std::vector<std::thread> threads;
+  std::atomic<int> ready(0);
+  auto start = std::chrono::steady_clock::now();
+  for(int p = 0; p < producers; p ++) {
+    threads.emplace_back([&, p]() {
+      ready ++;
+      while(ready < producers) {
+        std::this_thread::yield();
+      }
+      Counter *count = &counter;
+      const std::array<char, 64> large = { }; // Capture too big for a ring slot, goes through the task pool
+      double spent = 0;
+      for(long i = 0; i < tasks; i ++) {
+        auto before = std::chrono::steady_clock::now();
+        if(handoff == Handoff::New) {
+          queue->push(new CountTask(count));
+        } else if(handoff == Handoff::Inline) {
+          queue->post([count](TaskQueue*) { count->value ++; });
+        } else {
+          queue->post([count, large](TaskQueue*) { count->value += 1 + large[0]; });
+        }
+        spent += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - before).count();
+      }
+      pushTimes[p] = spent / tasks;
+    });
+  }
+  for(auto &thread : threads) {
+    thread.join();
+  }
+
+  // Stop from the consumer thread once everything pushed has run, a full ring could drop the stop task
+  while(!queue->empty()) {
+    std::this_thread::yield();
+  }
+  struct StopTask : public Task {
+    virtual void run(TaskQueue *queue) override { queue->stop(); }
+  };
+  queue->push(new StopTask);
+  consumer.join();
+  queue->flushQueue();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  Result result{ seconds, 0, counter.value, queue->getDropped(), queue->getOverflowed() };
+  for(double t : pushTimes) {
+    result.pushNs += t / producers;
+  }
+  return result;
+}
+
+long long nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double threadCpuSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Runs a function on the consumer thread
+template<typename Function>
+class CallTask
+  : public Task
+{
+public:
+  CallTask(Function function) : m_function(function) { }
+  virtual void run(TaskQueue*) override { m_function(); }
+
+private:
+  Function m_function;
+};
+
+template<typename Function>
+Task *call(Function function) {
+  return new CallTask<Function>(function);
+}
+
+struct WaitResult {
+  double medianUs;
+  double p99Us;
+  double idleCpu;      // Share of one CPU used by the idle consumer
+  unsigned long wakeups;
+};
+
+WaitResult measureWait(QueueWait wait, unsigned long spins, size_t capacity, int samples, int gapUs, int idleMs) {
+  std::unique_ptr<TaskQueue> queue(capacity ? new TaskQueue(capacity, QueueFullPolicy::Grow) : new TaskQueue());
+  queue->setWait(wait, spins);
+  std::thread consumer([&queue]() { queue->run(); });
+  while(!queue->running()) {
+    std::this_thread::yield();
+  }
+
+  // Wake-up latency: the consumer has gone idle (and possibly parked) before each push
+  std::vector<long long> latencies(samples);
+  std::atomic<int> done(0);
+  for(int i = 0; i < samples; i ++) {
+    std::this_thread::sleep_for(std::chrono::microseconds(gapUs));
+    long long pushed = nowNs();
+    long long *latency = &latencies[i];
+    queue->push(call([pushed, latency, &done]() { *latency = nowNs() - pushed; done ++; }));
+  }
+  while(done < samples) {
+    std::this_thread::yield();
+  }
+
+  // Idle CPU: consumer thread time between two tasks pushed idleMs apart
+  std::atomic<double> cpuStart(-1), cpuEnd(-1);
+  queue->push(call([&cpuStart]() { cpuStart = threadCpuSeconds(); }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+  queue->push(call([&cpuEnd]() { cpuEnd = threadCpuSeconds(); }));
+  while(cpuEnd < 0) {
+    std::this_thread::yield();
+  }
+
+  queue->stop();
+  consumer.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  return WaitResult{ latencies[samples / 2] / 1e3, latencies[samples * 99 / 100] / 1e3,
+                     (cpuEnd - cpuStart) * 1000 / idleMs, queue->getWakeups() };
+}
+
+// Spends about the time of a book update
+void work(int units) {
+  static std::atomic<unsigned long> sink(0);
+  unsigned long hash = 1469598103934665603UL;
+  for(int i = 0; i < units * 64; i ++) {
+    hash = (hash ^ i) * 1099511628211UL;
+  }
+  sink.store(hash, std::memory_order_relaxed);
+}
+
+struct LaneResult {
+  double medianUs;  // Order event latency
+  double p99Us;
+  double maxUs;
+  unsigned long marketData;
+  std::vector<TaskQueue::LaneStats> lanes;
+};
+
+// lanes: 0 for one queue, orders in lane 0 and market data in lane 1 otherwise
+// plain: market data posted without a lane index
+LaneResult measureLanes(size_t capacity, bool lanes, LaneDrain drain, const std::vector<unsigned> &weights,
+                        bool plain, int orders, int burst, int gapUs) {
+  std::unique_ptr<TaskQueue> queue(capacity ? new TaskQueue(capacity, QueueFullPolicy::Grow) : new TaskQueue());
+  if(lanes) {
+    queue->setLanes(weights, drain);
+  }
+  std::thread consumer([&queue]() { queue->run(); });
+  while(!queue->running()) {
+    std::this_thread::yield();
+  }
+
+  std::atomic<bool> done(false);
+  unsigned long marketData = 0; // Consumer thread only
+  unsigned long *updates = &marketData;
+  std::thread feed([&]() {
+    while(!done) {
+      for(int i = 0; i < burst; i ++) {
+        auto update = [updates](TaskQueue*) { work(4); (*updates) ++; };
+        if(plain) {
+          queue->post(update);
+        } else {
+          queue->post(update, 1);
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(gapUs));
+    }
+  });
+
+  std::vector<long long> latencies(orders);
+  std::atomic<int> ran(0);
+  for(int i = 0; i < orders; i ++) {
+    std::this_thread::sleep_for(std::chrono::microseconds(97));
+    long long pushed = nowNs();
+    long long *latency = &latencies[i];
+    queue->post([pushed, latency, &ran](TaskQueue*) { *latency = nowNs() - pushed; ran ++; }, 0);
+  }
+  while(ran < orders) {
+    std::this_thread::yield();
+  }
+  done = true;
+  feed.join();
+  while(!queue->empty()) {
+    std::this_thread::yield();
+  }
+  queue->stop();
+  consumer.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  return LaneResult{ latencies[orders / 2] / 1e3, latencies[orders * 99 / 100] / 1e3, latencies.back() / 1e3,
+                     marketData, queue->getLaneStats() };
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  long tasks;
+  int maxProducers;
+  size_t capacity;
+  std::string full;
+  int samples;
+  int gapUs;
+  int idleMs;
+  unsigned long spins;
+  int orders;
+  int burst;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("tasks,t", po::value<long>(&tasks)->default_value(1000000), "Tasks per producer")
+    ("producers,p", po::value<int>(&maxProducers)->default_value(8), "Largest number of producers")
+    ("capacity,c", po::value<size_t>(&capacity)->default_value(4096), "Ring capacity")
+    ("full,f", po::value<std::string>(&full)->default_value("grow"), "Ring full policy: block, drop or grow")
+    ("samples,s", po::value<int>(&samples)->default_value(2000), "Wake-ups measured per wait strategy")
+    ("gap,g", po::value<int>(&gapUs)->default_value(500), "Microseconds between measured wake-ups")
+    ("idle", po::value<int>(&idleMs)->default_value(500), "Milliseconds of idle CPU measurement")
+    ("spins", po::value<unsigned long>(&spins)->default_value(1000), "Empty checks spun before yielding")
+    ("orders", po::value<int>(&orders)->default_value(2000), "Order events measured per lane setup")
+    ("burst", po::value<int>(&burst)->default_value(2000), "Market data tasks per burst");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [options]\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  QueueFullPolicy policy = full == "block" ? QueueFullPolicy::Block :
+                           full == "drop" ? QueueFullPolicy::Drop : QueueFullPolicy::Grow;
+
+  int failed = 0;
+  std::cout << "producers  queue     task    Mtasks/s  handoff ns  dropped  overflowed  pool blocks" << std::endl;
+  for(int producers = 1; producers <= maxProducers; producers <<= 1) {
+    for(size_t size : { (size_t)0, capacity }) {
+      for(Handoff handoff : { Handoff::New, Handoff::Inline, Handoff::Pooled }) {
+        if(!size && handoff == Handoff::Inline) {
+          continue; // Same as pooled without a ring
+        }
+        unsigned long blocks = platform::TaskPool::getAllocated();
+        Result result = runOnce(size, policy, handoff, producers, tasks);
+        unsigned long expected = (unsigned long)tasks * producers;
+        if(result.ran + result.dropped != expected) {
+          failed ++;
+        }
+        std::cout << producers << "\t   " << (size ? "ring    " : "spinlock") << "  " << handoffName(handoff) << "  "
+                  << expected / result.seconds / 1e6 << "\t" << result.pushNs << "\t    "
+                  << result.dropped << "\t     " << result.overflowed << "\t " << platform::TaskPool::getAllocated() - blocks
+                  << (result.ran + result.dropped != expected ? "  LOST TASKS" : "") << std::endl;
+      }
+    }
+  }
+
+  struct {
+    const char *name;
+    QueueWait wait;
+    unsigned long spins;
+  } strategies[] = {
+    { "busy-spin", QueueWait::BusySpin, 0 },
+    { "yield", QueueWait::Yield, 0 },
+    { "spin-yield", QueueWait::Yield, spins },
+    { "spin-park", QueueWait::Park, spins }
+  };
+  std::cout << "\nwait        queue     wake-up us (median, p99)  idle CPU %  futex wakes" << std::endl;
+  for(const auto &strategy : strategies) {
+    for(size_t size : { (size_t)0, capacity }) {
+      WaitResult result = measureWait(strategy.wait, strategy.spins, size, samples, gapUs, idleMs);
+      std::cout << strategy.name << std::string(12 - strlen(strategy.name), ' ')
+                << (size ? "ring    " : "spinlock") << "  " << result.medianUs << ", " << result.p99Us
+                << "\t\t    " << result.idleCpu * 100 << "\t" << result.wakeups << std::endl;
+    }
+  }
+
+  struct {
+    const char *name;
+    bool lanes;
+    LaneDrain drain;
+    std::vector<unsigned> weights;
+    bool plain;
+  } setups[] = {
+    { "one queue", false, LaneDrain::Strict, { }, false },
+    { "strict", true, LaneDrain::Strict, { 1, 1 }, false },
+    { "weighted 1:64", true, LaneDrain::Weighted, { 1, 64 }, false },
+    { "plain posts", true, LaneDrain::Strict, { 1, 1 }, true }
+  };
+  std::cout << "\nlanes          queue     order us (median, p99, max)  market data" << std::endl;
+  for(const auto &setup : setups) {
+    for(size_t size : { (size_t)0, capacity }) {
+      LaneResult result = measureLanes(size, setup.lanes, setup.drain, setup.weights, setup.plain, orders, burst, 1000);
+      std::cout << setup.name << std::string(15 - strlen(setup.name), ' ')
+                << (size ? "ring    " : "spinlock") << "  " << result.medianUs << ", " << result.p99Us << ", " << result.maxUs
+                << "\t\t " << result.marketData << std::endl;
+      for(size_t i = 0; i < result.lanes.size(); i ++) {
+        const auto &lane = result.lanes[i];
+        std::cout << "  lane " << i << ": tasks " << lane.tasks << ", max depth " << lane.maxDepth
+                  << ", wait us mean " << lane.meanWait / 1e3 << ", max " << lane.maxWait / 1e3 << std::endl;
+      }
+      // Every market data task went through the lowest lane
+      if(setup.lanes && result.lanes.back().tasks != result.marketData) {
+        std::cout << "  FAILED: " << result.marketData << " market data tasks, " << result.lanes.back().tasks
+                  << " in the lowest lane" << std::endl;
+        failed ++;
+      }
+    }
+  }
+  return failed ? 1 : 0;
+}
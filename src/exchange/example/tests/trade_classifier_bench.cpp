@@ -0,0 +1,164 @@
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "example/trade_classifier.h"
+
+// Classifies a mixed stream of trade WebSocket responses with the sequential memmem checks
+// WSTradeConnector::onDataReady used before TradeClassifier and with TradeClassifier,
+// checks that both agree and reports the time per message of each.
+// Messages are generated, or read one per line from a file.
+
+namespace {
+
+using connector::example::TradeClassifier;
+
+const char *samples[] = {
+  "[{\"binary\":0,\"channel\":\"login\",\"data\":{\"result\":true}}]",
+  "[{\"binary\":0,\"channel\":\"ok_spot_order\",\"data\":{\"result\":true,\"order_id\":\"125433029\"}}]",
+  "[{\"binary\":0,\"channel\":\"ok_spot_cancel_order\",\"data\":{\"result\":true,\"order_id\":\"125433027\"}}]",
+  "[{\"binary\":0,\"channel\":\"ok_spot_userinfo\",\"data\":{\"result\":true,\"info\":{\"funds\":{\"free\":{\"btc\":\"5814.850605\","
+    "\"ltc\":\"1.0\",\"eth\":\"12.5\"},\"freezed\":{\"btc\":\"7341.0\",\"ltc\":\"0\",\"eth\":\"0\"}}}}}]",
+  "[{\"binary\":0,\"channel\":\"ok_spot_orderinfo\",\"data\":{\"result\":true,\"orders\":[{\"symbol\":\"ltc_btc\",\"amount\":\"0.1\","
+    "\"price\":\"0.008\",\"avg_price\":0,\"create_date\":1504529236946,\"deal_amount\":0,\"order_id\":125433027,"
+    "\"orders_id\":125433027,\"status\":0,\"type\":\"sell\"}]}}]",
+  "[{\"binary\":0,\"channel\":\"ok_sub_spot_ltc_btc_order\",\"data\":{\"symbol\":\"ltc_btc\",\"tradeAmount\":\"1.00\","
+    "\"createdDate\":\"1504530228987\",\"orderId\":6191,\"completedTradeAmount\":\"1.00\",\"averagePrice\":\"0.008\","
+    "\"tradePrice\":\"0.008\",\"tradeType\":\"buy\",\"status\":2,\"tradeUnitPrice\":\"0.008\"}}]",
+  "[{\"binary\":0,\"channel\":\"ok_sub_spot_ltc_btc_balance\",\"data\":{\"info\":{\"free\":{\"btc\":5814.850605,\"ltc\":1},"
+    "\"freezed\":{\"btc\":7341,\"ltc\":0}}}}]",
+  "{\"event\":\"pong\"}",
+  "[{\"binary\":0,\"channel\":\"addChannel\",\"data\":{\"result\":true,\"channel\":\"ok_sub_spot_ltc_btc_order\"}}]"
+};
+
+// The checks of WSTradeConnector::onDataReady before TradeClassifier, in their order
+TradeClassifier::Kind classifyMemmem(const char *data, size_t size) {
+  const char *start = (const char*)memmem(data, size, "channel", 7);
+  if(!start) {
+    start = (const char*)memmem(data, size, "event", 5);
+  }
+  if(!start) {
+    return TradeClassifier::Kind::None;
+  }
+  const char *end = (const char*)memmem(start, size - (start - data), ",", 1);
+  if(!end) {
+    end = data + size;
+  }
+
+  size_t len = end - start;
+  auto has = [start, len](const char *str) { return memmem(start, len, str, strlen(str)) != nullptr; };
+  if(has("login")) {
+    return TradeClassifier::Kind::Login;
+  } else if(has("ok_spot_orderinfo")) {
+    return TradeClassifier::Kind::OrderInfo;
+  } else if(has("ok_spot_order")) {
+    return TradeClassifier::Kind::OrderPlaced;
+  } else if(has("ok_spot_cancel_order")) {
+    return TradeClassifier::Kind::OrderCancelled;
+  } else if(has("ok_spot_userinfo")) {
+    return TradeClassifier::Kind::UserInfo;
+  } else if(has("_order")) {
+    return TradeClassifier::Kind::Trades;
+  } else if(has("_balance")) {
+    return TradeClassifier::Kind::Balance;
+  } else if(has("ping")) {
+    return TradeClassifier::Kind::Ping;
+  }
+  return TradeClassifier::Kind::Unknown;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  int count;
+  int iterations;
+  std::string file;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("messages,m", po::value<int>(&count)->default_value(10000), "Number of generated messages")
+    ("iterations,i", po::value<int>(&iterations)->default_value(100), "Passes over the messages")
+    ("input", po::value<std::string>(&file), "Read messages from this file, one per line");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [--messages N | --input messages.txt]\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  std::vector<std::string> messages;
+  if(!file.empty()) {
+    std::ifstream input(file);
+    std::string line;
+    while(std::getline(input, line)) {
+      if(!line.empty()) {
+        messages.push_back(line);
+      }
+    }
+  } else {
+    // Pushed trades and balances dominate a busy account, request responses are interleaved
+    const size_t mix[] = { 5, 5, 5, 6, 6, 6, 6, 1, 2, 3, 4, 7, 0, 8 };
+    for(int i = 0; i < count; i ++) {
+      messages.push_back(samples[mix[i % (sizeof(mix) / sizeof(mix[0]))]]);
+    }
+  }
+  if(messages.empty()) {
+    std::cerr << "No messages" << std::endl;
+    return -1;
+  }
+
+  // The old checks knew no pong
+  size_t mismatches = 0, differences = 0;
+  for(const auto &message : messages) {
+    auto before = classifyMemmem(message.data(), message.size());
+    auto after = TradeClassifier::classify(message.data(), message.size());
+    if(before == after) {
+      continue;
+    }
+    if(after == TradeClassifier::Kind::Pong && before == TradeClassifier::Kind::Unknown) {
+      differences ++;
+    } else {
+      mismatches ++;
+    }
+  }
+
+  size_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(int n = 0; n < iterations; n ++) {
+    for(const auto &message : messages) {
+      sum += (size_t)classifyMemmem(message.data(), message.size());
+    }
+  }
+  double sequential = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for(int n = 0; n < iterations; n ++) {
+    for(const auto &message : messages) {
+      sum += (size_t)TradeClassifier::classify(message.data(), message.size());
+    }
+  }
+  double classified = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  double total = (double)messages.size() * iterations;
+  std::cout << "Messages: " << messages.size() << ", mismatches: " << mismatches
+            << ", pongs the old checks missed: " << differences << "\n"
+            << "memmem: " << sequential / total << " ns/message\n"
+            << "TradeClassifier: " << classified / total << " ns/message, "
+            << (classified > 0 ? sequential / classified : 0) << "x" << std::endl;
+  // Kinds are never 0 in the loops, the sum keeps them from being optimized out
+  return mismatches || !sum ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "platform/task_queue.h"
+#include "platform/work_stealing_pool.h"
+
+// Runs checksum jobs of uneven cost on a platform::WorkStealingPool and on as many TaskQueue threads
+// fed round robin, the way such jobs are spread without the pool. Every job posts its checksum to
+// a collector TaskQueue. A second pass submits one job per block which splits itself from inside the pool.
+
+namespace {
+
+using platform::TaskQueue;
+using platform::WorkStealingPool;
+
+uint64_t checksum(const std::vector<uint8_t> &data, size_t begin, size_t end) {
+  uint64_t hash = 14695981039346656037ULL;
+  for(size_t i = begin; i < end; i ++) {
+    hash = (hash ^ data[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Sums the checksums on its own thread
+struct Collector {
+  uint64_t sum = 0; // Collector thread only
+  std::atomic<long> jobs{0};
+};
+
+// Job cost: every 16th job is heavy
+size_t jobSize(long i, size_t light, size_t heavy) {
+  return i % 16 == 7 ? heavy : light;
+}
+
+template<typename Submit>
+double runJobs(Submit submit, TaskQueue &collectorQueue, Collector &collector, const std::vector<uint8_t> &data,
+               long jobs, size_t light, size_t heavy) {
+  collector.jobs = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(long i = 0; i < jobs; i ++) {
+    size_t size = jobSize(i, light, heavy);
+    size_t begin = (i * 4099) % (data.size() - size);
+    submit([&data, &collectorQueue, &collector, begin, size](TaskQueue*) {
+      uint64_t sum = checksum(data, begin, begin + size);
+      collectorQueue.post([&collector, sum](TaskQueue*) {
+        collector.sum += sum;
+        collector.jobs ++;
+      });
+    });
+  }
+  while(collector.jobs < jobs) {
+    std::this_thread::yield();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Checksum of [begin, end) split in halves down to grain, from inside the pool
+void splitJob(WorkStealingPool *pool, const std::vector<uint8_t> *data, size_t begin, size_t end, size_t grain,
+              TaskQueue *collectorQueue, Collector *collector) {
+  while(end - begin > grain) {
+    size_t middle = begin + (end - begin) / 2;
+    pool->post([pool, data, middle, end, grain, collectorQueue, collector](TaskQueue*) {
+      splitJob(pool, data, middle, end, grain, collectorQueue, collector);
+    });
+    end = middle;
+  }
+  uint64_t sum = checksum(*data, begin, end);
+  collectorQueue->post([collector, sum](TaskQueue*) {
+    collector->sum += sum;
+    collector->jobs ++;
+  });
+}
+
+void printStats(const WorkStealingPool &pool) {
+  auto stats = pool.getStats();
+  for(size_t i = 0; i < stats.size(); i ++) {
+    std::cout << "  worker " << i << ": executed " << stats[i].executed << ", stolen " << stats[i].stolen
+              << ", received " << stats[i].received << ", utilization " << stats[i].utilization * 100 << "%" << std::endl;
+  }
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  int workers;
+  long jobs;
+  size_t light, heavy, grain;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("workers,w", po::value<int>(&workers)->default_value(4), "Pool workers and TaskQueue threads")
+    ("jobs,j", po::value<long>(&jobs)->default_value(20000), "Jobs submitted")
+    ("light", po::value<size_t>(&light)->default_value(4096), "Bytes summed by a light job")
+    ("heavy", po::value<size_t>(&heavy)->default_value(262144), "Bytes summed by a heavy job")
+    ("grain", po::value<size_t>(&grain)->default_value(16384), "Bytes below which a split job stops splitting");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " [options]\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  std::vector<uint8_t> data(std::max<size_t>(heavy * 4, 1 << 22));
+  for(size_t i = 0; i < data.size(); i ++) {
+    data[i] = (uint8_t)(i * 2654435761u >> 13);
+  }
+
+  Collector collector;
+  TaskQueue collectorQueue(4096, platform::QueueFullPolicy::Grow);
+  std::thread collectorThread([&collectorQueue]() { collectorQueue.run(); });
+  while(!collectorQueue.running()) {
+    std::this_thread::yield();
+  }
+
+  // TaskQueue threads, round robin
+  uint64_t queueSum;
+  double queueSeconds;
+  {
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> threads;
+    for(int i = 0; i < workers; i ++) {
+      queues.emplace_back(new TaskQueue(4096, platform::QueueFullPolicy::Grow));
+      TaskQueue *queue = queues.back().get();
+      threads.emplace_back([queue]() { queue->run(); });
+      while(!queue->running()) {
+        std::this_thread::yield();
+      }
+    }
+    size_t next = 0;
+    collectorQueue.post([&collector](TaskQueue*) { collector.sum = 0; });
+    queueSeconds = runJobs([&queues, &next](std::function<void(TaskQueue*)> job) {
+                             queues[next ++ % queues.size()]->post(std::move(job));
+                           }, collectorQueue, collector, data, jobs, light, heavy);
+    queueSum = collector.sum;
+    for(auto &queue : queues) {
+      queue->stop();
+    }
+    for(auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  WorkStealingPool pool(workers);
+  collectorQueue.post([&collector](TaskQueue*) { collector.sum = 0; });
+  double poolSeconds = runJobs([&pool](std::function<void(TaskQueue*)> job) { pool.post(std::move(job)); },
+                               collectorQueue, collector, data, jobs, light, heavy);
+  uint64_t poolSum = collector.sum;
+
+  std::cout << "Jobs: " << jobs << ", light " << light << " bytes, every 16th " << heavy << " bytes\n"
+            << "TaskQueue round robin: " << queueSeconds * 1e3 << " ms\n"
+            << "WorkStealingPool: " << poolSeconds * 1e3 << " ms" << std::endl;
+  printStats(pool);
+
+  // Split jobs: each block is one submission, halves are spawned from the workers
+  const size_t blocks = 64;
+  const size_t block = data.size() / blocks;
+  long leaves = 0;
+  for(size_t b = 0; b < blocks; b ++) {
+    size_t size = block;
+    long count = 1;
+    while(size > grain) {
+      size -= size / 2;
+      count *= 2;
+    }
+    leaves += block > grain ? count : 1;
+  }
+  collectorQueue.post([&collector](TaskQueue*) { collector.sum = 0; });
+  collector.jobs = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(size_t b = 0; b < blocks; b ++) {
+    WorkStealingPool *p = &pool;
+    const std::vector<uint8_t> *d = &data;
+    TaskQueue *c = &collectorQueue;
+    Collector *s = &collector;
+    pool.post([p, d, b, block, grain, c, s](TaskQueue*) { splitJob(p, d, b * block, (b + 1) * block, grain, c, s); });
+  }
+  while(collector.jobs < leaves) {
+    std::this_thread::yield();
+  }
+  double splitSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Split jobs: " << blocks << " blocks, " << leaves << " leaves, " << splitSeconds * 1e3 << " ms" << std::endl;
+  printStats(pool);
+
+  collectorQueue.stop();
+  collectorThread.join();
+  if(queueSum != poolSum) {
+    std::cerr << "Checksums differ" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,238 @@
+#include <signal.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <pjson.h>
+
+#include "example/adapter_price.h"
+#include "fin/instrument_registry.h"
+#include "platform/clock.h"
+#include "platform/log.h"
+#include "platform/timer.h"
+#include "platform/websocket.h"
+
+// Connects several PriceAdapters to the mock exchange (mock_ws_server) and reports
+// update throughput and receive->observer latency percentiles once per second
+
+namespace {
+
+volatile sig_atomic_t g_running = 1;
+
+void onSignal(int) {
+  g_running = 0;
+}
+
+class LatencyObserver
+  : public fin::interface::StockDataObserver
+{
+public:
+  virtual void invalidateData(fin::InstrumentHandle, fin::ProfilingTag) override { }
+  virtual void orderbookEntryAdded(fin::OrderBookEntry, fin::ProfilingTag tag) override { record(1, tag); }
+  virtual void orderbookEntriesBulk(fin::OrderBookList list, fin::ProfilingTag tag) override { record(list.size(), tag); }
+  virtual void orderbookEntriesSpan(fin::OrderBookSpan span, fin::ProfilingTag tag) override { record(span.size, tag); }
+  virtual void candleStickEntryAdded(fin::CandleStickEntry, fin::ProfilingTag) override { }
+  virtual void symbolAdded(fin::SymbolHandle, fin::ProfilingTag) override { }
+  virtual void instrumentAdded(fin::InstrumentHandle, fin::ProfilingTag) override { }
+  virtual void dataConnectorError(std::exception_ptr) override { m_errors ++; }
+
+  // Prints statistics for the last period and resets them
+  void report(double seconds) {
+    std::vector<unsigned long> latencies;
+    unsigned long entries;
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      latencies.swap(m_latencies);
+      entries = m_entries;
+      m_entries = 0;
+    }
+
+    std::cout << "updates: " << (unsigned long)(latencies.size() / seconds) << "/s"
+              << ", entries: " << (unsigned long)(entries / seconds) << "/s"
+              << ", errors: " << m_errors;
+
+    if(!latencies.empty()) {
+      std::sort(latencies.begin(), latencies.end());
+      auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, (size_t)(latencies.size() * p))] / 1000.0;
+      };
+      std::cout << ", latency us p50: " << percentile(0.5)
+                << " p99: " << percentile(0.99)
+                << " p99.9: " << percentile(0.999)
+                << " max: " << latencies.back() / 1000.0;
+    }
+    std::cout << std::endl;
+  }
+
+private:
+  void record(size_t entries, const fin::ProfilingTag &tag) {
+    unsigned long now = platform::Clock::instance().now();
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_entries += entries;
+    m_latencies.push_back(now > tag.timestamp ? now - tag.timestamp : 0);
+  }
+
+  std::mutex m_lock;
+  std::vector<unsigned long> m_latencies;
+  unsigned long m_entries = 0;
+  std::atomic<unsigned long> m_errors{0};
+};
+
+// Registers every instrument mentioned in the adapter dictionary
+fin::InstrumentsList registerInstruments(std::string config) {
+  fin::InstrumentsList result;
+  pjson::document doc;
+  doc.deserialize_in_place(&config[0]);
+  if(!doc.has_key("dictionary")) {
+    return result;
+  }
+
+  const auto &dictionary = doc["dictionary"];
+  for(unsigned int i = 0; i < dictionary.get_object().size(); i ++) {
+    const auto &pair = dictionary.get_object()[i].get_value();
+    if(pair.is_array()) {
+      auto &registry = fin::InstrumentRegistry::instance();
+      registry.addSymbol(pair[0].as_string_ptr());
+      registry.addSymbol(pair[1].as_string_ptr());
+      registry.addInstrument(pair[0].as_string_ptr(), pair[1].as_string_ptr());
+      result.push_back(registry.findInstrument(pair[0].as_string_ptr(), pair[1].as_string_ptr()));
+    }
+  }
+  return result;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+
+  std::string configFile;
+  std::string url;
+  int connections;
+  int duration;
+  int legs;
+
+  po::options_description options("Options");
+  options.add_options()
+    ("help,h", "Show help")
+    ("config,c", po::value<std::string>(&configFile)->required(), "Adapter config (json with \"dictionary\")")
+    ("url,u", po::value<std::string>(&url)->default_value("ws://localhost:9999/websocket"), "Mock exchange URL")
+    ("connections,n", po::value<int>(&connections)->default_value(1), "Number of adapters (WebSocket connections)")
+    ("duration,d", po::value<int>(&duration)->default_value(0), "Seconds to run, 0 runs until interrupted")
+    ("legs", po::value<int>(&legs)->default_value(1), "Redundant connections per adapter, arbitrated by first arrival")
+    ("compression", "Negotiate permessage-deflate and report compression ratio and inflate time");
+
+  bool compression = false;
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    if(vm.count("help")) {
+      std::cout << "Usage: " << argv[0] << " -c config.json [options]\n" << options << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+    compression = vm.count("compression") > 0;
+  } catch(std::exception &e) {
+    std::cerr << e.what() << "\n" << options << std::endl;
+    return -1;
+  }
+
+  platform::Logger logger;
+  platform::TimerService timerService;
+  platform::WebSocketClient wsclient;
+  fin::InstrumentRegistry registry;
+
+  std::ifstream input(configFile);
+  std::stringstream config;
+  config << input.rdbuf();
+  fin::InstrumentsList instruments = registerInstruments(config.str());
+
+  LatencyObserver observer;
+  std::vector<std::unique_ptr<adaptor::example::PriceAdapter>> adapters;
+  auto startTime = platform::Clock::instance().now();
+  for(int i = 0; i < connections; i ++) {
+    adapters.emplace_back(new adaptor::example::PriceAdapter(&observer));
+    adapters.back()->config(config.str());
+    adapters.back()->setUrl(url);
+    adapters.back()->setCompression(compression);
+    for(int leg = 1; leg < legs; leg ++) {
+      adapters.back()->addLeg();
+    }
+    adapters.back()->start();
+    adapters.back()->subscribe(instruments);
+  }
+
+  size_t pending = 0, rejected = 0;
+  for(auto &adapter : adapters) {
+    adapter->waitSubscribed(10000);
+    pending += adapter->getPendingChannels();
+    rejected += adapter->getRejectedChannels();
+  }
+  std::cout << "Connected and subscribed in " << (platform::Clock::instance().now() - startTime) / 1e6 << " ms"
+            << ", unacknowledged channels: " << pending << ", rejected: " << rejected << std::endl;
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  auto last = platform::Clock::instance().now();
+  platform::WSCompressionStats lastStats;
+  for(int elapsed = 0; g_running && (!duration || elapsed < duration); elapsed ++) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    auto now = platform::Clock::instance().now();
+    double seconds = (now - last) / 1e9;
+    observer.report(seconds);
+    last = now;
+
+    if(compression) {
+      platform::WSCompressionStats stats;
+      for(auto &adapter : adapters) {
+        auto connection = adapter->getCompressionStats();
+        stats.messages += connection.messages;
+        stats.compressedBytes += connection.compressedBytes;
+        stats.inflatedBytes += connection.inflatedBytes;
+        stats.inflateNanos += connection.inflateNanos;
+      }
+      unsigned long messages = stats.messages - lastStats.messages;
+      std::cout << "compressed messages: " << (unsigned long)(messages / seconds) << "/s"
+                << ", wire: " << (stats.compressedBytes - lastStats.compressedBytes) / seconds / 1e6 << " MB/s"
+                << ", inflated: " << (stats.inflatedBytes - lastStats.inflatedBytes) / seconds / 1e6 << " MB/s"
+                << ", ratio: " << stats.getRatio()
+                << ", inflate us/msg: " << (messages ? (stats.inflateNanos - lastStats.inflateNanos) / 1000.0 / messages : 0)
+                << std::endl;
+      lastStats = stats;
+    }
+
+    if(legs > 1) {
+      std::vector<platform::FeedArbiter::LegStats> total(legs);
+      for(auto &adapter : adapters) {
+        auto stats = adapter->getLegStats(true);
+        for(size_t leg = 0; leg < stats.size() && leg < total.size(); leg ++) {
+          total[leg].messages += stats[leg].messages;
+          total[leg].wins += stats[leg].wins;
+          total[leg].lagCount += stats[leg].lagCount;
+          total[leg].lagSum += stats[leg].lagSum;
+          total[leg].lagMax = std::max(total[leg].lagMax, stats[leg].lagMax);
+        }
+      }
+      for(int leg = 0; leg < legs; leg ++) {
+        std::cout << "  leg " << leg << ": messages: " << total[leg].messages
+                  << ", win rate: " << total[leg].getWinRate() * 100 << "%"
+                  << ", lag behind winner us avg: " << total[leg].getAverageLag() / 1000.0
+                  << " max: " << total[leg].lagMax / 1000.0 << std::endl;
+      }
+    }
+  }
+
+  for(auto &adapter : adapters) {
+    adapter->stop();
+  }
+  adapters.clear();
+  logger.stop();
+  return 0;
+}
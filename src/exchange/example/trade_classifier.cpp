@@ -0,0 +1,137 @@
+#include <string.h>
+#include "trade_classifier.h"
+
+namespace connector {
+namespace example {
+
+namespace {
+
+template<size_t N>
+inline bool tokenIs(const char *token, size_t size, const char (&literal)[N]) {
+  return size == N - 1 && !memcmp(token, literal, N - 1);
+}
+
+template<size_t N>
+inline bool tokenEndsWith(const char *token, size_t size, const char (&literal)[N]) {
+  return size >= N - 1 && !memcmp(token + size - (N - 1), literal, N - 1);
+}
+
+// Value of the string member whose key ends at p (just past the closing quote of the key)
+bool memberValue(const char *p, const char *end, const char *&token, size_t &size) {
+  while(p < end && (*p == ' ' || *p == ':' || *p == '\t' || *p == '\n' || *p == '\r')) {
+    p ++;
+  }
+  if(p >= end || *p != '"') {
+    return false;
+  }
+  token = ++ p;
+  const char *close = (const char*)memchr(p, '"', end - p);
+  if(!close) {
+    return false;
+  }
+  size = close - token;
+  return true;
+}
+
+}
+
+/**
+ * Finds the "channel" member, or the first "event" member if there is none, and classifies its value
+ * @param msg message text, need not be NUL terminated
+ * @param size message size
+ */
+TradeClassifier::Kind TradeClassifier::classify(const char *msg, size_t size)
+{
+  static const char channel[] = "channel\"";
+  static const char event[] = "event\"";
+  const char *end = msg + size;
+  const char *eventToken = nullptr;
+  size_t eventSize = 0;
+
+  // Jumps from quote to quote; a string value spelled like a key is not followed by a string and is passed over
+  for(const char *p = msg; (p = (const char*)memchr(p, '"', end - p)); ) {
+    p ++;
+    const size_t left = end - p;
+    const char *token;
+    size_t tokenSize;
+    if(left >= sizeof(channel) - 1 && !memcmp(p, channel, sizeof(channel) - 1)) {
+      if(memberValue(p + sizeof(channel) - 1, end, token, tokenSize)) {
+        return classifyToken(token, tokenSize);
+      }
+    } else if(!eventToken && left >= sizeof(event) - 1 && !memcmp(p, event, sizeof(event) - 1)) {
+      if(memberValue(p + sizeof(event) - 1, end, token, tokenSize)) {
+        eventToken = token;
+        eventSize = tokenSize;
+      }
+    }
+  }
+
+  if(eventToken) {
+    return classifyToken(eventToken, eventSize);
+  }
+  return Kind::None;
+}
+
+/**
+ * Matches a channel or event name, the first characters select the candidates
+ * @param token name, need not be NUL terminated
+ * @param size name length
+ */
+TradeClassifier::Kind TradeClassifier::classifyToken(const char *token, size_t size)
+{
+  static const char spot[] = "ok_spot_";
+  static const char subSpot[] = "ok_sub_spot_";
+  const size_t spotSize = sizeof(spot) - 1, subSpotSize = sizeof(subSpot) - 1;
+
+  if(!size) {
+    return Kind::Unknown;
+  }
+
+  switch(token[0]) {
+  case 'l':
+    return tokenIs(token, size, "login") ? Kind::Login : Kind::Unknown;
+
+  case 'p':
+    if(tokenIs(token, size, "pong")) {
+      return Kind::Pong;
+    }
+    return tokenIs(token, size, "ping") ? Kind::Ping : Kind::Unknown;
+
+  case 'o':
+    if(size > spotSize && !memcmp(token, spot, spotSize)) {
+      const char *name = token + spotSize;
+      const size_t nameSize = size - spotSize;
+      switch(name[0]) {
+      case 'o':
+        if(tokenIs(name, nameSize, "order")) {
+          return Kind::OrderPlaced;
+        }
+        return tokenIs(name, nameSize, "orderinfo") ? Kind::OrderInfo : Kind::Unknown;
+      case 'c':
+        return tokenIs(name, nameSize, "cancel_order") ? Kind::OrderCancelled : Kind::Unknown;
+      case 'u':
+        return tokenIs(name, nameSize, "userinfo") ? Kind::UserInfo : Kind::Unknown;
+      default:
+        return Kind::Unknown;
+      }
+    }
+    // ok_sub_spot_<symbol>_order, ok_sub_spot_<symbol>_balance
+    if(size > subSpotSize && !memcmp(token, subSpot, subSpotSize)) {
+      switch(token[size - 1]) {
+      case 'r':
+        return tokenEndsWith(token, size, "_order") ? Kind::Trades : Kind::Unknown;
+      case 'e':
+        return tokenEndsWith(token, size, "_balance") ? Kind::Balance : Kind::Unknown;
+      default:
+        return Kind::Unknown;
+      }
+    }
+    return Kind::Unknown;
+
+  default:
+    return Kind::Unknown;
+  }
+}
+
+}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace connector {
+namespace example {
+
+/**
+ * Classifies trade WebSocket messages by their "channel" value, or "event" value if there is no channel,
+ * in one pass over the message: the key is found by jumping between quotes, then the value is matched by a switch
+ * on its characters, so classification is linear in the message prefix and the token, whatever the number of kinds.
+ * Channels: login, ok_spot_order, ok_spot_orderinfo, ok_spot_cancel_order, ok_spot_userinfo,
+ * ok_sub_spot_<symbol>_order (trades), ok_sub_spot_<symbol>_balance; events: ping, pong.
+ */
+class TradeClassifier {
+public:
+  enum class Kind {
+    None = 0,       //!< Neither "channel" nor "event" in the message
+    Unknown,        //!< Channel or event not handled
+    Login,
+    OrderPlaced,
+    OrderCancelled,
+    OrderInfo,
+    UserInfo,
+    Trades,
+    Balance,
+    Ping,
+    Pong
+  };
+
+  static Kind classify(const char *msg, size_t size); //!< Kind of a message
+  static Kind classifyToken(const char *token, size_t size); //!< Kind of a channel or event name
+};
+
+}
+}
@@ -0,0 +1,108 @@
+/***************************************************
+ * broadcast_observer.cpp
+ * Created on Sun, 18 Oct 2026 19:42:15 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <thread>
+#include "broadcast_observer.h"
+
+namespace fin {
+
+/**
+ * @param capacity ring size in events, power of 2. Consumers falling behind by more than that lose events.
+ * @param control observer for symbols, instruments, candlesticks and errors
+ */
+BroadcastObserver::BroadcastObserver(size_t capacity, interface::StockDataObserver *control)
+  : m_ring(capacity)
+  , m_lock(ATOMIC_FLAG_INIT)
+  , m_control(control)
+{ }
+
+inline void BroadcastObserver::lock() noexcept
+{
+  while(__builtin_expect(m_lock.test_and_set(std::memory_order_acquire), 0)) {
+    std::this_thread::yield();
+  }
+}
+
+inline void BroadcastObserver::unlock() noexcept
+{
+  m_lock.clear(std::memory_order_release);
+}
+
+void BroadcastObserver::invalidateData(InstrumentHandle instrument, ProfilingTag tag)
+{
+  lock();
+  m_ring.publish([instrument, &tag](MarketDataEvent &event) {
+                   event.type = MarketDataEvent::Type::Invalidate;
+                   event.index = 0;
+                   event.count = 0;
+                   event.tag = tag.timestamp;
+                   event.entry.instrument = instrument;
+                 });
+  unlock();
+}
+
+void BroadcastObserver::orderbookEntryAdded(OrderBookEntry entry, ProfilingTag tag)
+{
+  orderbookEntriesSpan(OrderBookSpan(&entry, 1), tag);
+}
+
+void BroadcastObserver::orderbookEntriesBulk(OrderBookList entries, ProfilingTag tag)
+{
+  orderbookEntriesSpan(entries, tag);
+}
+
+/**
+ * Publishes every entry as a separate event, index and count let consumers tell batch boundaries
+ */
+void BroadcastObserver::orderbookEntriesSpan(OrderBookSpan entries, ProfilingTag tag)
+{
+  const uint32_t count = entries.size;
+  lock();
+  for(uint32_t i = 0; i < count; i ++) {
+    const OrderBookEntry &entry = entries[i];
+    m_ring.publish([i, count, &tag, &entry](MarketDataEvent &event) {
+                     event.type = MarketDataEvent::Type::Entry;
+                     event.index = i;
+                     event.count = count;
+                     event.tag = tag.timestamp;
+                     event.entry = entry;
+                   });
+  }
+  unlock();
+}
+
+void BroadcastObserver::candleStickEntryAdded(CandleStickEntry entry, ProfilingTag tag)
+{
+  if(m_control) {
+    m_control->candleStickEntryAdded(std::move(entry), tag);
+  }
+}
+
+void BroadcastObserver::symbolAdded(SymbolHandle symbol, ProfilingTag tag)
+{
+  if(m_control) {
+    m_control->symbolAdded(symbol, tag);
+  }
+}
+
+void BroadcastObserver::instrumentAdded(InstrumentHandle instrument, ProfilingTag tag)
+{
+  if(m_control) {
+    m_control->instrumentAdded(instrument, tag);
+  }
+}
+
+void BroadcastObserver::dataConnectorError(std::exception_ptr error)
+{
+  if(m_control) {
+    m_control->dataConnectorError(error);
+  }
+}
+
+}
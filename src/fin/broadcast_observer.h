@@ -0,0 +1,67 @@
+/***************************************************
+ * broadcast_observer.h
+ * Created on Sun, 18 Oct 2026 19:42:15 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "platform/broadcast_ring.h"
+#include "market.h"
+
+namespace fin {
+
+//! Orderbook event as stored in the broadcast ring
+struct MarketDataEvent {
+  enum class Type : uint8_t {
+    Entry = 0, //!< Orderbook entry, part of a batch
+    Invalidate //!< Data of the instrument (or all data for NoInstrument) is invalid
+  };
+
+  Type type; //!< Event type
+  uint32_t index; //!< Position of the entry in its batch
+  uint32_t count; //!< Number of entries in the batch
+  unsigned long tag; //!< Profiling tag timestamp of the update
+  OrderBookEntry entry; //!< Entry, only instrument is set for Invalidate
+};
+
+typedef platform::BroadcastRing<MarketDataEvent> MarketDataRing;
+
+/**
+ * Observer publishing orderbook updates of one connector into a broadcast ring,
+ * so any number of consumers read the same events without copying them per consumer.
+ * Non-orderbook callbacks are passed to the optional control observer.
+ * Callbacks may come from several connector threads, publishing is serialized by a spinlock
+ * held across a whole batch so its entries stay contiguous in the ring.
+ */
+class BroadcastObserver
+  : public interface::StockDataObserver
+{
+public:
+  BroadcastObserver(size_t capacity, interface::StockDataObserver *control = nullptr);
+
+  MarketDataRing &getRing() { return m_ring; } //!< Ring to subscribe consumers to
+
+  virtual void invalidateData(InstrumentHandle, ProfilingTag) override;
+  virtual void orderbookEntryAdded(OrderBookEntry, ProfilingTag) override;
+  virtual void orderbookEntriesBulk(OrderBookList, ProfilingTag) override;
+  virtual void orderbookEntriesSpan(OrderBookSpan, ProfilingTag) override;
+  virtual void candleStickEntryAdded(CandleStickEntry, ProfilingTag) override;
+  virtual void symbolAdded(SymbolHandle, ProfilingTag) override;
+  virtual void instrumentAdded(InstrumentHandle, ProfilingTag) override;
+  virtual void dataConnectorError(std::exception_ptr) override;
+
+private:
+  inline void lock() noexcept;
+  inline void unlock() noexcept;
+
+  MarketDataRing m_ring;
+  std::atomic_flag m_lock;
+  interface::StockDataObserver *m_control;
+};
+
+}
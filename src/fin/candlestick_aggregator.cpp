@@ -0,0 +1,267 @@
+/***************************************************
+ * candlestick_aggregator.cpp
+ * Created on Sun, 18 Oct 2026 17:48:21 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+#include "candlestick_aggregator.h"
+
+namespace fin {
+
+static const size_t MaxLevels = 64; // Per side; only the top of book is used, deeper levels may be stale
+
+CandleStickAggregator::CandleStickAggregator(CandleStickHandler handler)
+  : m_handler(handler)
+{ }
+
+/**
+ * Adds interval to track. Intervals should be configured before the data starts flowing.
+ * @param seconds candlestick interval in seconds
+ */
+void CandleStickAggregator::addInterval(long seconds)
+{
+  if(seconds <= 0) {
+    throw std::invalid_argument("Candlestick interval must be positive");
+  }
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  if(std::find(m_intervals.begin(), m_intervals.end(), seconds) == m_intervals.end()) {
+    m_intervals.push_back(seconds);
+  }
+}
+
+bool CandleStickAggregator::hasInterval(long seconds) const
+{
+  return std::find(m_intervals.begin(), m_intervals.end(), seconds) != m_intervals.end();
+}
+
+CandleStickAggregator::Bars &CandleStickAggregator::getBars(InstrumentHandle instrument)
+{
+  Bars &bars = m_bars[instrument];
+  if(__builtin_expect(bars.size() != m_intervals.size(), 0)) {
+    bars.resize(m_intervals.size());
+  }
+  return bars;
+}
+
+/**
+ * Closes the bar if the timestamp is past its interval and starts a new one when needed
+ */
+void CandleStickAggregator::roll(InstrumentHandle instrument, Bar &bar, long interval, long timestamp)
+{
+  const long length = interval * 1000;
+  if(!bar.empty() && timestamp >= bar.start + length) {
+    close(instrument, bar, interval);
+  }
+  if(bar.empty()) {
+    bar.start = timestamp - timestamp % length;
+  }
+}
+
+void CandleStickAggregator::close(InstrumentHandle instrument, Bar &bar, long interval)
+{
+  if(!bar.empty()) {
+    const OHLC &ohlc = bar.hasTrades ? bar.trades : bar.mid;
+    CandleStickEntry entry;
+    entry.instrument = instrument;
+    entry.timestamp = bar.start;
+    entry.interval = interval;
+    entry.open.assign(ohlc.open);
+    entry.high.assign(ohlc.high);
+    entry.low.assign(ohlc.low);
+    entry.close.assign(ohlc.close);
+    entry.volume.assign(bar.volume);
+    m_closed.emplace_back(std::move(entry));
+  }
+  bar = Bar();
+}
+
+/**
+ * Passes closed bars to the handler outside of the data lock,
+ * so the handler may call back into the aggregator
+ */
+void CandleStickAggregator::emit()
+{
+  std::lock_guard<std::mutex> emitLock(m_emitLock);
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    if(m_closed.empty()) {
+      return;
+    }
+    m_closed.swap(m_emitting);
+  }
+
+  for(auto &entry : m_emitting) {
+    m_handler(std::move(entry));
+  }
+  m_emitting.clear();
+}
+
+/**
+ * Accounts a trade in all tracked intervals of the instrument
+ * @param instrument traded instrument
+ * @param price trade price
+ * @param amount trade amount, added to the bar volume
+ * @param timestamp trade time in milliseconds
+ */
+void CandleStickAggregator::onTrade(InstrumentHandle instrument, double price, double amount, long timestamp)
+{
+  if(instrument == NoInstrument) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    Bars &bars = getBars(instrument);
+    for(size_t i = 0; i < bars.size(); i ++) {
+      Bar &bar = bars[i];
+      roll(instrument, bar, m_intervals[i], timestamp);
+      if(bar.hasTrades) {
+        bar.trades.update(price);
+      } else {
+        bar.trades.start(price);
+        bar.hasTrades = true;
+      }
+      bar.volume += amount;
+    }
+  }
+  emit();
+}
+
+/**
+ * Accounts best bid and ask. Mid price is used for bars without trades.
+ * @param instrument instrument of the orderbook
+ * @param bid best bid price
+ * @param ask best ask price
+ * @param timestamp update time in milliseconds
+ */
+void CandleStickAggregator::onTopOfBook(InstrumentHandle instrument, double bid, double ask, long timestamp)
+{
+  if(instrument == NoInstrument || bid <= 0 || ask <= 0) {
+    return;
+  }
+
+  const double mid = (bid + ask) / 2;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    Bars &bars = getBars(instrument);
+    for(size_t i = 0; i < bars.size(); i ++) {
+      Bar &bar = bars[i];
+      roll(instrument, bar, m_intervals[i], timestamp);
+      if(bar.hasMid) {
+        bar.mid.update(mid);
+      } else {
+        bar.mid.start(mid);
+        bar.hasMid = true;
+      }
+    }
+  }
+  emit();
+}
+
+/**
+ * Applies depth entries to the levels of the instrument and accounts the resulting best bid and ask.
+ * Entries carry absolute amounts, zero removes the level. A level removes the opposite levels it crosses,
+ * which a missed delta left behind. A one-sided book is not accounted.
+ * @param entries orderbook entries of a single instrument
+ * @param snapshot true if the entries are the full book, false for a delta
+ * @param timestamp update time in milliseconds
+ */
+void CandleStickAggregator::onOrderbook(OrderBookSpan entries, bool snapshot, long timestamp)
+{
+  if(entries.empty()) {
+    return;
+  }
+
+  double bid = 0;
+  double ask = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    Levels &book = m_books[entries[0].instrument];
+    if(snapshot) {
+      book.bids.clear();
+      book.asks.clear();
+    }
+    for(const auto &entry : entries) {
+      const bool isBid = entry.direction == OrderDir::Bid;
+      setLevel(isBid ? book.bids : book.asks, isBid ? book.asks : book.bids, isBid, entry.price.toDouble(), entry.amount.toDouble());
+    }
+    if(book.bids.empty() || book.asks.empty()) {
+      return;
+    }
+    bid = book.bids.front().first;
+    ask = book.asks.front().first;
+  }
+
+  onTopOfBook(entries[0].instrument, bid, ask, timestamp);
+}
+
+/**
+ * Sets or removes one level, keeping the side sorted best first and at most MaxLevels deep
+ * @param side levels of the entry direction
+ * @param opposite levels of the other direction, those crossed by a new level are removed
+ * @param amount absolute amount at the price, 0 removes the level
+ */
+void CandleStickAggregator::setLevel(Side &side, Side &opposite, bool bid, double price, double amount)
+{
+  auto found = std::lower_bound(side.begin(), side.end(), price, [bid](const std::pair<double, double> &level, double price) {
+    return bid ? level.first > price : level.first < price;
+  });
+  const bool exists = found != side.end() && found->first == price;
+  if(amount <= 0) {
+    if(exists) {
+      side.erase(found);
+    }
+    return;
+  }
+
+  if(exists) {
+    found->second = amount;
+  } else if(found - side.begin() < (ptrdiff_t)MaxLevels) {
+    side.insert(found, std::make_pair(price, amount));
+    if(side.size() > MaxLevels) {
+      side.pop_back();
+    }
+  }
+
+  auto crossed = opposite.begin();
+  while(crossed != opposite.end() && (bid ? crossed->first <= price : crossed->first >= price)) {
+    ++ crossed;
+  }
+  opposite.erase(opposite.begin(), crossed);
+}
+
+void CandleStickAggregator::resetBooks()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_books.clear();
+}
+
+/**
+ * Emits all bars which ended before the timestamp. Call it periodically,
+ * so bars close on time even when the instrument has no updates.
+ * @param timestamp current time in milliseconds
+ */
+void CandleStickAggregator::closeExpired(long timestamp)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for(auto &instrumentBars : m_bars) {
+      Bars &bars = instrumentBars.second;
+      for(size_t i = 0; i < bars.size(); i ++) {
+        Bar &bar = bars[i];
+        if(!bar.empty() && timestamp >= bar.start + m_intervals[i] * 1000) {
+          close(instrumentBars.first, bar, m_intervals[i]);
+        }
+      }
+    }
+  }
+  emit();
+}
+
+}
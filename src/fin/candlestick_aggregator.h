@@ -0,0 +1,101 @@
+/***************************************************
+ * candlestick_aggregator.h
+ * Created on Sun, 18 Oct 2026 17:48:21 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "orderbook.h"
+
+namespace fin {
+
+/**
+ * Builds candlesticks locally from the trade and top-of-book streams.
+ * Every instrument keeps one open bar per configured interval, so each event costs
+ * O(number of intervals). Bars are built from trades; a bar without trades falls back
+ * to the mid price of the top of book and has zero volume. The top of book comes either
+ * from onTopOfBook() or from the levels onOrderbook() keeps per instrument. Intervals with no data at all
+ * produce no bar.
+ * Closed bars are emitted through the handler as soon as an event or closeExpired()
+ * observes the interval end. Timestamps are milliseconds, intervals are seconds.
+ */
+class CandleStickAggregator {
+public:
+  typedef std::function<void(CandleStickEntry)> CandleStickHandler;
+
+  CandleStickAggregator(CandleStickHandler handler);
+
+  void addInterval(long seconds); //!< Track bars of given interval for all instruments
+  const std::vector<long> &getIntervals() const { return m_intervals; } //!< Tracked intervals in seconds
+  bool hasInterval(long seconds) const; //!< True when the interval is tracked
+
+  void onTrade(InstrumentHandle instrument, double price, double amount, long timestamp); //!< Account a trade
+  void onTopOfBook(InstrumentHandle instrument, double bid, double ask, long timestamp); //!< Account best bid/ask change
+  void onOrderbook(OrderBookSpan entries, bool snapshot, long timestamp); //!< Apply depth snapshot or delta, account the top of book
+  void resetBooks(); //!< Forget the levels, e.g. when the depth stream disconnected
+  void closeExpired(long timestamp); //!< Emit bars whose interval ended before the timestamp
+
+private:
+  struct OHLC {
+    double open;
+    double high;
+    double low;
+    double close;
+
+    void start(double price) { open = high = low = close = price; }
+    void update(double price) {
+      high = price > high ? price : high;
+      low = price < low ? price : low;
+      close = price;
+    }
+  };
+
+  struct Bar {
+    long start = 0;
+    OHLC trades;
+    OHLC mid;
+    double volume = 0;
+    bool hasTrades = false;
+    bool hasMid = false;
+
+    bool empty() const { return !hasTrades && !hasMid; }
+  };
+
+  typedef std::vector<Bar> Bars; // One bar per tracked interval
+
+  // Price levels built from depth snapshots and deltas, sorted best first and cut to MaxLevels.
+  // Books are a few dozen levels deep, vectors keep updates free of allocations.
+  typedef std::vector<std::pair<double, double>> Side; // Price, amount
+  struct Levels {
+    Side bids;
+    Side asks;
+  };
+
+  static void setLevel(Side &side, Side &opposite, bool bid, double price, double amount);
+
+  Bars &getBars(InstrumentHandle instrument);
+  void roll(InstrumentHandle instrument, Bar &bar, long interval, long timestamp);
+  void close(InstrumentHandle instrument, Bar &bar, long interval);
+  void emit();
+
+  CandleStickAggregator(const CandleStickAggregator &) = delete;
+  void operator =(const CandleStickAggregator &) = delete;
+
+  CandleStickHandler m_handler;
+  std::vector<long> m_intervals;
+  std::unordered_map<InstrumentHandle, Bars> m_bars;
+  std::unordered_map<InstrumentHandle, Levels> m_books;
+  std::vector<CandleStickEntry> m_closed; // Bars closed under the lock, emitted after it is released
+  std::vector<CandleStickEntry> m_emitting;
+  std::mutex m_lock;
+  std::mutex m_emitLock;
+};
+
+}
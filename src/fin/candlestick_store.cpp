@@ -0,0 +1,311 @@
+/***************************************************
+ * candlestick_store.cpp
+ * Created on Sun, 18 Oct 2026 18:21:07 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+#include "platform/log.h"
+#include "candlestick_store.h"
+
+namespace fin {
+
+enum CandleStickColumn {
+  TimestampColumn = 0,
+  OpenColumn,
+  HighColumn,
+  LowColumn,
+  CloseColumn,
+  VolumeColumn,
+  ColumnCount
+};
+
+static const size_t HeaderSize = 4096;
+static const size_t ReserveRows = 1024; // Rows of disk blocks reserved at once, 48 KiB per series
+
+static inline int64_t toFixed(const FixedNumber &value) {
+  return llround(value.toDouble() * CANDLESTICK_STORE_SCALE);
+}
+
+// Goes through the decimal string, so stored values come back exactly
+static inline void fromFixed(FixedNumber &number, int64_t value) {
+  char buffer[32];
+  uint64_t magnitude = value < 0 ? -(uint64_t)value : value;
+  snprintf(buffer, sizeof(buffer), "%s%llu.%08llu", value < 0 ? "-" : "",
+           (unsigned long long)(magnitude / CANDLESTICK_STORE_SCALE), (unsigned long long)(magnitude % CANDLESTICK_STORE_SCALE));
+  number.assign(buffer);
+}
+
+CandleStickEntry CandleStickColumns::entry(size_t row, InstrumentHandle instrument, long interval) const
+{
+  CandleStickEntry result;
+  result.instrument = instrument;
+  result.interval = interval;
+  result.timestamp = timestamp[row];
+  fromFixed(result.open, open[row]);
+  fromFixed(result.high, high[row]);
+  fromFixed(result.low, low[row]);
+  fromFixed(result.close, close[row]);
+  fromFixed(result.volume, volume[row]);
+  return result;
+}
+
+/**
+ * Opens existing series file or creates a new one
+ * @param fileName path to the series file
+ * @param interval candlestick interval in seconds, must match the existing file
+ * @param capacity rows to reserve in a new file
+ */
+CandleStickSeries::CandleStickSeries(const std::string &fileName, long interval, size_t capacity)
+  : m_fileName(fileName)
+  , m_interval(interval)
+  , m_capacity(capacity)
+  , m_reserved(0)
+  , m_full(false)
+  , m_fd(-1)
+  , m_map(NULL)
+  , m_mapSize(0)
+  , m_header(NULL)
+  , m_columns(NULL)
+{
+  m_fd = open(fileName.c_str(), O_CREAT | O_RDWR, 0644);
+  if(m_fd < 0) {
+    throw std::runtime_error("Can not open candlestick series " + fileName + ": " + strerror(errno));
+  }
+
+  struct stat st;
+  if(fstat(m_fd, &st) < 0) {
+    close(m_fd);
+    throw std::runtime_error("Can not stat candlestick series " + fileName + ": " + strerror(errno));
+  }
+
+  // A file left by a crash before its header was written is initialized again
+  static const char noMagic[sizeof(CandleStickSeriesHeader::magic)] = { };
+  CandleStickSeriesHeader header;
+  bool created = st.st_size == 0 ||
+                 (pread(m_fd, &header, sizeof(header), 0) == sizeof(header) && !memcmp(header.magic, noMagic, sizeof(noMagic)));
+  size_t rows = 0;
+  if(!created) {
+    if(pread(m_fd, &header, sizeof(header), 0) != sizeof(header) ||
+       memcmp(header.magic, CANDLESTICK_STORE_MAGIC, sizeof(header.magic)) || header.version != 1 ||
+       header.interval != interval) {
+      close(m_fd);
+      throw std::runtime_error("Invalid candlestick series " + fileName);
+    }
+    m_capacity = header.capacity;
+    rows = header.size.load(std::memory_order_relaxed);
+  }
+
+  m_mapSize = HeaderSize + ColumnCount * m_capacity * sizeof(int64_t);
+  if(created) {
+    // Sparse, the header and the rows get their blocks from reserve()
+    if(ftruncate(m_fd, m_mapSize) < 0) {
+      close(m_fd);
+      throw std::runtime_error("Can not allocate candlestick series " + fileName + ": " + strerror(errno));
+    }
+  } else if((size_t)st.st_size != m_mapSize) {
+    close(m_fd);
+    throw std::runtime_error("Truncated candlestick series " + fileName);
+  }
+
+  // Stored rows are reserved too, files written by earlier versions may be sparse
+  int error = reserve(rows);
+  if(error) {
+    close(m_fd);
+    throw std::runtime_error("Can not allocate candlestick series " + fileName + ": " + strerror(error));
+  }
+
+  void *map = mmap(NULL, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if(map == MAP_FAILED) {
+    close(m_fd);
+    throw std::runtime_error("Can not map candlestick series " + fileName + ": " + strerror(errno));
+  }
+
+  m_map = (char*)map;
+  m_header = reinterpret_cast<CandleStickSeriesHeader*>(m_map);
+  m_columns = reinterpret_cast<int64_t*>(m_map + HeaderSize);
+
+  if(created) {
+    m_header->version = 1;
+    m_header->headerSize = HeaderSize;
+    m_header->interval = interval;
+    m_header->capacity = m_capacity;
+    m_header->size.store(0, std::memory_order_release);
+    memcpy(m_header->magic, CANDLESTICK_STORE_MAGIC, sizeof(m_header->magic));
+  }
+}
+
+/**
+ * Reserves disk blocks of the header and of the first rows of every column, in chunks of ReserveRows.
+ * Writing a hole of the sparse mapping raises SIGBUS when the disk is full, reserved blocks are safe.
+ * @return 0 or the errno of posix_fallocate
+ */
+int CandleStickSeries::reserve(size_t rows)
+{
+  rows = std::min(m_capacity, (rows / ReserveRows + 1) * ReserveRows);
+  if(!m_reserved) {
+    int error = posix_fallocate(m_fd, 0, HeaderSize);
+    if(error) {
+      return error;
+    }
+  }
+  if(rows <= m_reserved) {
+    return 0;
+  }
+  for(int n = 0; n < ColumnCount; n ++) {
+    const size_t offset = HeaderSize + (n * m_capacity + m_reserved) * sizeof(int64_t);
+    int error = posix_fallocate(m_fd, offset, (rows - m_reserved) * sizeof(int64_t));
+    if(error) {
+      return error;
+    }
+  }
+  m_reserved = rows;
+  return 0;
+}
+
+CandleStickSeries::~CandleStickSeries()
+{
+  munmap(m_map, m_mapSize);
+  close(m_fd);
+}
+
+/**
+ * Appends the bar to the tail. A bar with the same timestamp as the last one replaces it
+ * (the last bar may still be open), older bars are ignored.
+ * The file is mapped at its capacity, so a full series stops recording; this is logged once.
+ * A bar is not stored either when its disk blocks can not be reserved, e.g. on ENOSPC.
+ * @return false if the bar was not stored
+ */
+bool CandleStickSeries::append(const CandleStickEntry &entry)
+{
+  std::lock_guard<std::mutex> lock(m_writeLock);
+  size_t size = m_header->size.load(std::memory_order_relaxed);
+  size_t row = size;
+
+  if(size) {
+    int64_t last = column(TimestampColumn)[size - 1];
+    if(entry.timestamp < last) {
+      return false;
+    }
+    if(entry.timestamp == last) {
+      row = size - 1;
+    }
+  }
+
+  if(row >= m_capacity) {
+    if(!m_full) {
+      m_full = true;
+      platform::LogError() << "Candlestick series " << m_fileName << " is full at " << m_capacity << " rows, new bars are not stored";
+    }
+    return false;
+  }
+
+  if(row >= m_reserved) {
+    int error = reserve(row);
+    if(error) {
+      platform::LogError() << "Can not allocate candlestick series " << m_fileName << ": " << strerror(error);
+      return false;
+    }
+  }
+
+  column(TimestampColumn)[row] = entry.timestamp;
+  column(OpenColumn)[row] = toFixed(entry.open);
+  column(HighColumn)[row] = toFixed(entry.high);
+  column(LowColumn)[row] = toFixed(entry.low);
+  column(CloseColumn)[row] = toFixed(entry.close);
+  column(VolumeColumn)[row] = toFixed(entry.volume);
+
+  if(row == size) {
+    m_header->size.store(size + 1, std::memory_order_release);
+  }
+  return true;
+}
+
+CandleStickColumns CandleStickSeries::columns(size_t first, size_t count) const
+{
+  CandleStickColumns result;
+  result.timestamp = column(TimestampColumn) + first;
+  result.open = column(OpenColumn) + first;
+  result.high = column(HighColumn) + first;
+  result.low = column(LowColumn) + first;
+  result.close = column(CloseColumn) + first;
+  result.volume = column(VolumeColumn) + first;
+  result.size = count;
+  return result;
+}
+
+/**
+ * Returns view of the rows in the timestamp range. Rows are sorted by timestamp,
+ * so the range is found with binary search over the timestamp column.
+ * @param from first timestamp (inclusive)
+ * @param to last timestamp (exclusive)
+ */
+CandleStickColumns CandleStickSeries::range(long from, long to) const
+{
+  const int64_t *timestamps = column(TimestampColumn);
+  const int64_t *end = timestamps + size();
+  const int64_t *first = std::lower_bound(timestamps, end, (int64_t)from);
+  const int64_t *last = std::lower_bound(first, end, (int64_t)to);
+  return columns(first - timestamps, last - first);
+}
+
+size_t CandleStickSeries::size() const
+{
+  return m_header->size.load(std::memory_order_acquire);
+}
+
+long CandleStickSeries::lastTimestamp() const
+{
+  size_t rows = size();
+  return rows ? column(TimestampColumn)[rows - 1] : 0;
+}
+
+
+/**
+ * @param directory directory to keep series files in, must exist
+ * @param capacity rows to reserve in newly created series
+ */
+CandleStickStore::CandleStickStore(const std::string &directory, size_t capacity)
+  : m_directory(directory)
+  , m_capacity(capacity)
+{
+  struct stat st;
+  if(stat(m_directory.c_str(), &st) < 0 || !S_ISDIR(st.st_mode)) {
+    throw std::invalid_argument("Candlestick store directory does not exist: " + directory);
+  }
+}
+
+CandleStickSeries &CandleStickStore::series(InstrumentHandle instrument, long interval)
+{
+  if(instrument == NoInstrument) {
+    throw std::invalid_argument("Candlestick series requires an instrument");
+  }
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  auto &series = m_series[std::make_pair(instrument, interval)];
+  if(!series) {
+    std::string fileName = m_directory + "/" + instrument->first->symbol + "_" + instrument->second->symbol + "-" +
+                           boost::lexical_cast<std::string>(interval) + ".candles";
+    series.reset(new CandleStickSeries(fileName, interval, m_capacity));
+  }
+  return *series;
+}
+
+bool CandleStickStore::append(const CandleStickEntry &entry)
+{
+  return series(entry.instrument, entry.interval).append(entry);
+}
+
+}
@@ -0,0 +1,111 @@
+/***************************************************
+ * candlestick_store.h
+ * Created on Sun, 18 Oct 2026 18:21:07 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <climits>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "orderbook.h"
+
+#define CANDLESTICK_STORE_MAGIC "CSTORE1"
+#define CANDLESTICK_STORE_SCALE 100000000LL
+
+namespace fin {
+
+// On-disk series header, followed by the columns, each spanning capacity rows.
+// The magic is written last, a file whose magic is zero was never initialized.
+struct CandleStickSeriesHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  int64_t interval;          // Seconds
+  uint64_t capacity;         // Rows per column
+  std::atomic<uint64_t> size; // Committed rows
+};
+
+//! Zero-copy view of a row range. Prices and volume are fixed point scaled by CANDLESTICK_STORE_SCALE.
+struct CandleStickColumns {
+  const int64_t *timestamp = nullptr; //!< Bar start timestamps
+  const int64_t *open = nullptr; //!< Open prices
+  const int64_t *high = nullptr; //!< Highest prices
+  const int64_t *low = nullptr; //!< Lowest prices
+  const int64_t *close = nullptr; //!< Close prices
+  const int64_t *volume = nullptr; //!< Volumes
+  size_t size = 0; //!< Number of rows in the view
+
+  bool empty() const { return !size; } //!< True when view has no rows
+  CandleStickEntry entry(size_t row, InstrumentHandle instrument, long interval) const; //!< Materialize the row
+};
+
+/**
+ * Append-only series of candlesticks of one instrument and interval in a memory mapped file.
+ * Each of timestamp, open, high, low, close and volume is a contiguous int64 column.
+ * The file is mapped at its full capacity once, so views returned by range() stay valid
+ * for the lifetime of the series; disk blocks are reserved in chunks as rows are appended.
+ * One writer, any number of readers.
+ * Rows before the last one never change. The last row is rewritten in place while its bar is open,
+ * so a reader concurrent with the writer may see it torn and must not rely on it.
+ */
+class CandleStickSeries {
+public:
+  CandleStickSeries(const std::string &fileName, long interval, size_t capacity);
+  ~CandleStickSeries();
+
+  bool append(const CandleStickEntry &entry); //!< Append a bar or replace the last one with the same timestamp
+  CandleStickColumns range(long from, long to = LONG_MAX) const; //!< Rows with from <= timestamp < to
+  size_t size() const; //!< Number of stored rows
+  long lastTimestamp() const; //!< Timestamp of the last row, 0 when empty
+  long getInterval() const { return m_interval; }
+
+private:
+  CandleStickSeries(const CandleStickSeries &) = delete;
+  void operator =(const CandleStickSeries &) = delete;
+
+  CandleStickColumns columns(size_t first, size_t count) const;
+  int64_t *column(int n) const { return m_columns + n * m_capacity; }
+  int reserve(size_t rows);
+
+  std::string m_fileName;
+  long m_interval;
+  size_t m_capacity;
+  size_t m_reserved; // Rows with disk blocks reserved in every column
+  bool m_full; // Reported that appends are dropped
+  int m_fd;
+  char *m_map;
+  size_t m_mapSize;
+  CandleStickSeriesHeader *m_header;
+  int64_t *m_columns;
+  std::mutex m_writeLock;
+};
+
+/**
+ * Directory of candlestick series, one file per instrument and interval
+ */
+class CandleStickStore {
+public:
+  CandleStickStore(const std::string &directory, size_t capacity = 1 << 20); //!< Capacity in rows of new series
+
+  CandleStickSeries &series(InstrumentHandle instrument, long interval); //!< Open or create the series
+  bool append(const CandleStickEntry &entry); //!< Append to the series of the entry instrument and interval
+
+private:
+  CandleStickStore(const CandleStickStore &) = delete;
+  void operator =(const CandleStickStore &) = delete;
+
+  std::string m_directory;
+  size_t m_capacity;
+  std::mutex m_lock;
+  std::map<std::pair<InstrumentHandle, long>, std::unique_ptr<CandleStickSeries>> m_series;
+};
+
+}
@@ -0,0 +1,192 @@
+/***************************************************
+ * channel_router.cpp
+ * Created on Mon, 19 Oct 2026 09:41:15 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include "channel_router.h"
+
+namespace fin {
+
+static const uint32_t MaxSeeds = 1 << 16; // Seeds tried per bucket before the table is doubled
+static const size_t MaxSlots = 1 << 24;
+
+ChannelRouter::ChannelRouter()
+  : m_table(nullptr)
+{
+  m_tables.emplace_back(build(std::vector<Slot>()));
+  m_table.store(m_tables.back().get(), std::memory_order_release);
+}
+
+// Eight bytes per step, channel names are 20 to 40 characters
+uint64_t ChannelRouter::hash(const char *str, size_t size)
+{
+  uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size;
+  uint64_t word;
+  for(; size >= sizeof(word); str += sizeof(word), size -= sizeof(word)) {
+    memcpy(&word, str, sizeof(word));
+    hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 29;
+  }
+  if(size) {
+    word = 0;
+    memcpy(&word, str, size);
+    hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+  }
+  hash ^= hash >> 32;
+  return hash * 0x94D049BB133111EBULL;
+}
+
+// Slot of a hash under the bucket seed
+inline size_t ChannelRouter::place(uint64_t hash, uint32_t seed, size_t mask)
+{
+  uint64_t x = (hash ^ (seed * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+  return (x ^ (x >> 31)) & mask;
+}
+
+/**
+ * Builds a collision free table, buckets with the most routes are placed first
+ * @param routes slots with name, size and route set
+ * @throw std::runtime_error if two channels have the same 64 bit hash
+ */
+ChannelRouter::Table *ChannelRouter::build(std::vector<Slot> routes) const
+{
+  for(auto &route : routes) {
+    route.hash = hash(route.name, route.size);
+  }
+
+  // About four routes per bucket, slots at most half full
+  size_t slots = 8;
+  while(slots < 2 * routes.size()) {
+    slots <<= 1;
+  }
+
+  for(; slots <= MaxSlots; slots <<= 1) {
+    std::unique_ptr<Table> table(new Table());
+    table->mask = slots - 1;
+    table->bucketMask = slots / 8 - 1;
+    table->count = routes.size();
+    table->seeds.assign(table->bucketMask + 1, 0);
+    table->slots.assign(slots, Slot{ 0, nullptr, 0, Route{ NoInstrument, Kind::None } });
+
+    std::vector<std::vector<const Slot*>> buckets(table->bucketMask + 1);
+    for(const auto &route : routes) {
+      buckets[route.hash & table->bucketMask].push_back(&route);
+    }
+    std::vector<size_t> order(buckets.size());
+    for(size_t i = 0; i < order.size(); i ++) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+    bool placed = true;
+    std::vector<size_t> indexes;
+    for(size_t b : order) {
+      const auto &bucket = buckets[b];
+      if(bucket.empty()) {
+        break;
+      }
+
+      uint32_t seed = 0;
+      for(; seed < MaxSeeds; seed ++) {
+        indexes.clear();
+        bool free = true;
+        for(const Slot *route : bucket) {
+          size_t index = place(route->hash, seed, table->mask);
+          if(table->slots[index].name || std::find(indexes.begin(), indexes.end(), index) != indexes.end()) {
+            free = false;
+            break;
+          }
+          indexes.push_back(index);
+        }
+        if(free) {
+          break;
+        }
+      }
+      if(seed == MaxSeeds) {
+        placed = false;
+        break;
+      }
+
+      table->seeds[b] = seed;
+      for(size_t i = 0; i < bucket.size(); i ++) {
+        table->slots[indexes[i]] = *bucket[i];
+      }
+    }
+    if(placed) {
+      return table.release();
+    }
+  }
+  throw std::runtime_error("channel names could not be placed in the routing table");
+}
+
+void ChannelRouter::add(const std::string &channel, InstrumentHandle instrument, Kind kind)
+{
+  add(std::vector<std::pair<std::string, Route>>{ std::make_pair(channel, Route{ instrument, kind }) });
+}
+
+/**
+ * Adds routes and publishes the new table, channels already routed get the new route
+ * @param routes channel names with their routes
+ */
+void ChannelRouter::add(const std::vector<std::pair<std::string, Route>> &routes)
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+
+  const Table *current = m_table.load(std::memory_order_acquire);
+  std::vector<Slot> slots;
+  std::map<std::string, size_t> index;
+  for(const auto &slot : current->slots) {
+    if(slot.name) {
+      index[std::string(slot.name, slot.size)] = slots.size();
+      slots.push_back(slot);
+    }
+  }
+
+  for(const auto &route : routes) {
+    if(route.first.empty()) {
+      throw std::invalid_argument("empty channel name");
+    }
+    auto found = index.find(route.first);
+    if(found != index.end()) {
+      slots[found->second].route = route.second;
+      continue;
+    }
+    m_names.push_back(route.first);
+    index[route.first] = slots.size();
+    slots.push_back(Slot{ 0, m_names.back().c_str(), (uint32_t)route.first.size(), route.second });
+  }
+
+  m_tables.emplace_back(build(slots));
+  m_table.store(m_tables.back().get(), std::memory_order_release);
+}
+
+/**
+ * Looks the channel up, safe from any thread
+ * @param channel channel name, need not be NUL terminated
+ * @param size channel name length
+ */
+const ChannelRouter::Route *ChannelRouter::find(const char *channel, size_t size) const
+{
+  const Table *table = m_table.load(std::memory_order_acquire);
+  uint64_t h = hash(channel, size);
+  const Slot &slot = table->slots[place(h, table->seeds[h & table->bucketMask], table->mask)];
+  if(slot.hash == h && slot.size == size && slot.name && !memcmp(slot.name, channel, size)) {
+    return &slot.route;
+  }
+  return nullptr;
+}
+
+size_t ChannelRouter::size() const
+{
+  return m_table.load(std::memory_order_acquire)->count;
+}
+
+}
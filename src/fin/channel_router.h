@@ -0,0 +1,82 @@
+/***************************************************
+ * channel_router.h
+ * Created on Mon, 19 Oct 2026 09:41:15 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <string.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "instrument.h"
+
+namespace fin {
+
+/**
+ * Maps full WebSocket channel names, e.g. "ok_sub_spot_eth_btc_depth", to the instrument and the kind of messages.
+ * Routes are added at subscribe time; the table is rebuilt and published with an atomic pointer, so lookups
+ * from any thread take no lock. The table is a perfect hash (hash and displace): the channel hash picks a bucket,
+ * the bucket's seed picks the slot, and seeds are chosen at build time so that every route gets its own slot.
+ * A lookup is one hash and one compare. Published tables are kept until the router is destroyed,
+ * as lookups may still use them.
+ */
+class ChannelRouter {
+public:
+  enum class Kind : uint8_t {
+    None = 0,
+    Depth,  //!< Orderbook updates
+    Trades, //!< Deals
+    Ticker  //!< Best prices and volume
+  };
+
+  struct Route {
+    InstrumentHandle instrument;
+    Kind kind;
+  };
+
+  ChannelRouter();
+
+  void add(const std::string &channel, InstrumentHandle instrument, Kind kind); //!< Adds or replaces one route
+  void add(const std::vector<std::pair<std::string, Route>> &routes); //!< Adds or replaces routes, publishing once
+
+  const Route *find(const char *channel, size_t size) const; //!< Route of the channel, nullptr if unknown
+  const Route *find(const char *channel) const { return find(channel, strlen(channel)); }
+  size_t size() const; //!< Number of routes
+
+private:
+  struct Slot {
+    uint64_t hash;
+    const char *name; // nullptr for empty slots
+    uint32_t size;
+    Route route;
+  };
+
+  struct Table {
+    size_t mask;       // Slots - 1
+    size_t bucketMask; // Buckets - 1
+    size_t count;
+    std::vector<uint32_t> seeds; // Per bucket
+    std::vector<Slot> slots;
+  };
+
+  static uint64_t hash(const char *str, size_t size);
+  static size_t place(uint64_t hash, uint32_t seed, size_t mask);
+  Table *build(std::vector<Slot> routes) const;
+
+  ChannelRouter(const ChannelRouter &) = delete;
+  void operator =(const ChannelRouter &) = delete;
+
+  std::mutex m_lock; // Writers only
+  std::atomic<Table*> m_table;
+  std::vector<std::unique_ptr<Table>> m_tables; // Current and retired tables
+  std::list<std::string> m_names; // Channel names the slots point to
+};
+
+}
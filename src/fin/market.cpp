@@ -13,6 +13,14 @@ namespace fin {
 
 using namespace interface;
 
+/** Default implementation copies the borrowed entries and passes them to orderbookEntriesBulk.
+ * Override it to consume the entries in place and avoid the allocation per message.
+ */
+void StockDataObserver::orderbookEntriesSpan(OrderBookSpan entries, ProfilingTag tag)
+{
+  orderbookEntriesBulk(OrderBookList(entries.begin(), entries.end()), tag);
+}
+
 BaseStockDataConnector::BaseStockDataConnector(StockDataObserver *observer)
   : m_observer(observer)
 { }
@@ -37,6 +45,12 @@ void BaseStockDataConnector::addOrderbookBulk(OrderBookList bulk, ProfilingTag t
   }
 }
 
+void BaseStockDataConnector::addOrderbookSpan(OrderBookSpan bulk, ProfilingTag tag) {
+  if(m_observer) {
+    m_observer->orderbookEntriesSpan(bulk, tag);
+  }
+}
+
 void BaseStockDataConnector::addCandleStickEntry(CandleStickEntry entry, ProfilingTag tag)
 {
   if(m_observer) {
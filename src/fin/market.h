@@ -23,6 +23,7 @@ public:
   virtual void invalidateData(InstrumentHandle, ProfilingTag) = 0; //!< Called when market data needs to be invalidated
   virtual void orderbookEntryAdded(OrderBookEntry, ProfilingTag) = 0; //!< Called when orderbook entry added
   virtual void orderbookEntriesBulk(OrderBookList, ProfilingTag) = 0; //!< Called when multiple orderbook updates are added at once
+  virtual void orderbookEntriesSpan(OrderBookSpan, ProfilingTag); //!< Called with a borrowed view of multiple orderbook updates (valid during the call only)
   virtual void candleStickEntryAdded(CandleStickEntry, ProfilingTag) = 0; //!< Called when a candlestick is added
   virtual void symbolAdded(SymbolHandle, ProfilingTag) = 0; //!< Trade exchange announced new trade symbol
   virtual void instrumentAdded(InstrumentHandle, ProfilingTag) = 0; //!< Trade exchange announced new trade instrument
@@ -62,6 +63,7 @@ protected:
   void invalidateData(InstrumentHandle instr = NoInstrument, ProfilingTag = ProfilingTag());
   void addOrderbookEntry(OrderBookEntry, ProfilingTag = ProfilingTag());
   void addOrderbookBulk(OrderBookList, ProfilingTag = ProfilingTag());
+  void addOrderbookSpan(OrderBookSpan, ProfilingTag = ProfilingTag());
   void addCandleStickEntry(CandleStickEntry, ProfilingTag = ProfilingTag());
   void addSymbol(SymbolHandle, ProfilingTag = ProfilingTag());
   void addInstrument(InstrumentHandle, ProfilingTag = ProfilingTag());
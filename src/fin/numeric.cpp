@@ -52,7 +52,7 @@ FixedNumber::FixedNumber(double number, int accuracy)
  */
 FixedNumber::FixedNumber(const std::string &number)
 {
-  initFromString(number.c_str());
+  assign(number.data(), number.size());
 }
 
 /**
@@ -61,7 +61,7 @@ FixedNumber::FixedNumber(const std::string &number)
  */
 FixedNumber::FixedNumber(const char *number)
 {
-  initFromString(number);
+  assign(number, strlen(number));
 }
 
 /**
@@ -89,12 +89,52 @@ FixedNumber &FixedNumber::assign(double val, int accuracy)
 }
 
 /**
- * Assigns FixedNumber object from a string
+ * Assigns FixedNumber object from a string, plain decimals skip the sscanf based parser
  * @param val The string to construct from
  */
 FixedNumber &FixedNumber::assign(const char *val)
 {
-  initFromString(val);
+  return assign(val, strlen(val));
+}
+
+/**
+ * Assigns FixedNumber object from a decimal string without copying or scanning for the terminator
+ * @param val The string to construct from, e.g. a number inside a JSON message
+ * @param size The string length
+ */
+FixedNumber &FixedNumber::assign(const char *val, size_t size)
+{
+  const char *p = val, *end = val + size;
+  bool negative = p < end && *p == '-';
+  if(negative || (p < end && *p == '+')) {
+    p ++;
+  }
+
+  long integer = 0, base = 0, exp = -1;
+  const char *digits = p;
+  for(; p < end && *p >= '0' && *p <= '9'; p ++) {
+    integer = integer * 10 + (*p - '0');
+  }
+  long intDigits = p - digits;
+  if(p < end && *p == '.') {
+    digits = ++ p;
+    for(; p < end && *p >= '0' && *p <= '9'; p ++) {
+      base = base * 10 + (*p - '0');
+    }
+    exp = p - digits;
+  }
+
+  // Exponents and numbers longer than a long go through the generic parser
+  if(__builtin_expect(p != end || intDigits > 18 || exp > 18, 0)) {
+    std::string copy(val, size);
+    initFromString(copy.c_str());
+    return *this;
+  }
+
+  m_int = negative ? -integer : integer;
+  m_base = negative ? -base : base;
+  m_exp = exp;
+  m_doubleValue = exp >= 0 ? (double)m_int + (double)m_base / (double)power10.get(exp) : (double)m_int;
   return *this;
 }
 
@@ -104,8 +144,7 @@ FixedNumber &FixedNumber::assign(const char *val)
  */
 FixedNumber &FixedNumber::assign(const std::string &val)
 {
-  initFromString(val.c_str());
-  return *this;
+  return assign(val.data(), val.size());
 }
 
 /**
@@ -149,7 +188,8 @@ void FixedNumber::initFromString(const char *str) {
 
   if(m_exp >= 0) {
     sscanf(num, "%ld.%ld", &m_int, &m_base);
-    if(m_int < 0) {
+    // The sign of "-0.5" is only in the text, the integer part is 0
+    if(*num == '-') {
       m_base = -m_base;
     }
     m_doubleValue = ((double)m_int) + ((double)m_base) / ((double)power10.get(m_exp));
@@ -205,7 +245,8 @@ std::string FixedNumber::toString() const
 {
   char buffer[64];
   if(m_exp >= 0) {
-    sprintf(buffer, "%ld.%0*ld", m_int, (int)m_exp, (m_base < 0 ? -m_base : m_base));
+    // Between -1 and 0 the sign is only carried by the fraction
+    sprintf(buffer, "%s%ld.%0*ld", (!m_int && m_base < 0 ? "-" : ""), m_int, (int)m_exp, (m_base < 0 ? -m_base : m_base));
   } else {
     sprintf(buffer, "%ld", m_int);
   }
@@ -48,6 +48,7 @@ public:
   FixedNumber &assign(double, int accuracy = DEFAULT_ACCURACY); //!< Assign from double with specified accuracy
   FixedNumber &assign(const std::string &); //!< Assign from string
   FixedNumber &assign(const char *); //!< Assign from string
+  FixedNumber &assign(const char *, size_t); //!< Assign from string of given length, need not be NUL terminated
   FixedNumber &assign(const FixedNumber &); //!< Copy from other fixed number
 
   void swap(FixedNumber &); //!< Swap two values
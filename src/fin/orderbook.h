@@ -40,8 +40,27 @@ struct OrderBookEntry {
   OrderBookEntry() = default; //!< Default constructor
   OrderBookEntry(OrderBookEntry &&) = default; //!< Move constructor
   OrderBookEntry(const OrderBookEntry &) = default; //!< Copy constructor
+  OrderBookEntry &operator =(const OrderBookEntry &) = default; //!< Assignment operator
 };
 
 typedef std::vector<OrderBookEntry> OrderBookList;
 
+/** Borrowed view over a contiguous range of orderbook entries.
+ * The view does not own the entries, the storage belongs to the connector and is
+ * reused for the next message, so the view is only valid during the callback it is passed to.
+ */
+struct OrderBookSpan {
+  const OrderBookEntry *data; //!< First entry of the range
+  size_t size; //!< Number of entries in the range
+
+  OrderBookSpan() : data(nullptr), size(0) { } //!< Empty view
+  OrderBookSpan(const OrderBookEntry *d, size_t s) : data(d), size(s) { } //!< View over pointer and length
+  OrderBookSpan(const OrderBookList &list) : data(list.data()), size(list.size()) { } //!< View over the list contents
+
+  const OrderBookEntry *begin() const { return data; } //!< Iterator to the first entry
+  const OrderBookEntry *end() const { return data + size; } //!< Iterator past the last entry
+  bool empty() const { return !size; } //!< True when view has no entries
+  const OrderBookEntry &operator[](size_t i) const { return data[i]; } //!< Access entry by index
+};
+
 }
@@ -0,0 +1,349 @@
+/***************************************************
+ * orderbook_sync.cpp
+ * Created on Sun, 18 Oct 2026 22:37:40 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+#include "orderbook_sync.h"
+
+namespace fin {
+
+// Snapshots older than the deltas already delivered are re-requested this many times, then accepted
+static const int MaxStaleAttempts = 3;
+// Failed snapshot requests are retried after 1 s, doubling up to 32 s
+static const unsigned MaxRetryShift = 5;
+
+/**
+ * @param request issues the snapshot request of an instrument, the response is passed to onSnapshot() or onSnapshotFailed()
+ * @param output receives snapshots and deltas in the order they must be applied
+ * @param maxConcurrent snapshot requests in progress at once
+ * @param maxBuffered deltas buffered per instrument while its snapshot is requested, the oldest are dropped beyond that
+ */
+OrderBookSync::OrderBookSync(SnapshotRequest request, Output output, size_t maxConcurrent, size_t maxBuffered)
+  : m_request(request)
+  , m_output(output)
+  , m_maxConcurrent(maxConcurrent)
+  , m_maxBuffered(maxBuffered)
+  , m_inFlight(0)
+  , m_generation(0)
+  , m_snapshots(0)
+  , m_staleSnapshots(0)
+  , m_replayed(0)
+  , m_discarded(0)
+  , m_gaps(0)
+  , m_failures(0)
+{
+  if(!request || !output || !maxConcurrent || !maxBuffered) {
+    throw std::invalid_argument("OrderBookSync requires callbacks, concurrency and buffer size");
+  }
+}
+
+OrderBookSync::Book &OrderBookSync::getBook(InstrumentHandle instrument)
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  std::unique_ptr<Book> &book = m_books[instrument];
+  if(!book) {
+    book.reset(new Book());
+  }
+  return *book;
+}
+
+OrderBookSync::Book *OrderBookSync::findBook(InstrumentHandle instrument)
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  auto found = m_books.find(instrument);
+  return found == m_books.end() ? nullptr : found->second.get();
+}
+
+/**
+ * Starts synchronization of the instrument, does nothing while a snapshot is already pending
+ */
+void OrderBookSync::sync(InstrumentHandle instrument)
+{
+  Book &book = getBook(instrument);
+  {
+    std::lock_guard<std::mutex> lock(book.lock);
+    if(book.state == State::Queued || book.state == State::Requested) {
+      return;
+    }
+    book.state = State::Queued;
+    book.buffer.clear();
+    book.gapVersion = 0;
+    book.attempts = 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_queue.push_back(instrument);
+  }
+  pump();
+}
+
+/**
+ * Issues queued snapshot requests while request slots are free.
+ * Requests are sent outside of the locks, the response may arrive before the request callback returns.
+ */
+void OrderBookSync::pump()
+{
+  std::vector<InstrumentHandle> requests;
+  do {
+    requests.clear();
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      while(m_inFlight < m_maxConcurrent && !m_queue.empty()) {
+        InstrumentHandle instrument = m_queue.front();
+        m_queue.pop_front();
+
+        Book &book = *m_books[instrument];
+        std::lock_guard<std::mutex> bookLock(book.lock);
+        if(book.state != State::Queued) {
+          continue;
+        }
+        book.state = State::Requested;
+        m_inFlight ++;
+        requests.push_back(instrument);
+      }
+    }
+
+    // A request that can not be sent gives its slot to the next instrument in the queue
+    size_t sent = 0;
+    for(auto instrument : requests) {
+      if(m_request(instrument)) {
+        sent ++;
+      } else {
+        giveUp(instrument);
+      }
+    }
+    if(sent == requests.size()) {
+      break;
+    }
+  } while(true);
+}
+
+/**
+ * Leaves the instrument unsynchronized: buffered deltas are delivered as they are and the slot is released
+ */
+void OrderBookSync::giveUp(InstrumentHandle instrument)
+{
+  m_failures.fetch_add(1, std::memory_order_relaxed);
+  Book *book = findBook(instrument);
+  {
+    std::lock_guard<std::mutex> lock(book->lock);
+    if(book->state != State::Requested) {
+      return;
+    }
+    for(const auto &delta : book->buffer) {
+      m_output(instrument, delta.entries, false, delta.tag);
+      book->lastVersion = std::max(book->lastVersion, delta.version);
+    }
+    book->buffer.clear();
+    book->state = State::Idle;
+  }
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_inFlight --;
+}
+
+/**
+ * @param version version of the last change contained in the entries
+ */
+void OrderBookSync::onDelta(InstrumentHandle instrument, long version, OrderBookSpan entries, ProfilingTag tag)
+{
+  Book *book = findBook(instrument);
+  if(!book) {
+    m_output(instrument, entries, false, tag);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(book->lock);
+  if(book->state == State::Queued || book->state == State::Requested) {
+    book->buffer.push_back(Delta{ version, tag, OrderBookList(entries.begin(), entries.end()) });
+    if(book->buffer.size() > m_maxBuffered) {
+      book->gapVersion = std::max(book->gapVersion, book->buffer.front().version);
+      book->buffer.pop_front();
+    }
+  } else {
+    m_output(instrument, entries, false, tag);
+    book->lastVersion = std::max(book->lastVersion, version);
+  }
+}
+
+// Called with the book locked
+void OrderBookSync::apply(InstrumentHandle instrument, Book &book, long version, OrderBookSpan entries, ProfilingTag tag)
+{
+  m_output(instrument, entries, true, tag);
+  m_snapshots.fetch_add(1, std::memory_order_relaxed);
+  book.lastVersion = version;
+
+  for(const auto &delta : book.buffer) {
+    if(delta.version >= version) {
+      m_output(instrument, delta.entries, false, delta.tag);
+      book.lastVersion = std::max(book.lastVersion, delta.version);
+      m_replayed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      m_discarded.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  book.buffer.clear();
+  book.gapVersion = 0;
+  book.attempts = 0;
+  book.failures = 0;
+}
+
+/**
+ * Applies the snapshot and replays the buffered deltas. A snapshot older than the deltas dropped
+ * from the full buffer, or older than the deltas delivered before the sync started, is re-requested.
+ * @param generation getGeneration() when the request was issued
+ * @param version version of the last change contained in the snapshot
+ */
+void OrderBookSync::onSnapshot(InstrumentHandle instrument, uint64_t generation, long version, OrderBookSpan entries, ProfilingTag tag)
+{
+  Book *book = findBook(instrument);
+  if(!book) {
+    return;
+  }
+
+  bool retry = false;
+  {
+    std::lock_guard<std::mutex> lock(book->lock);
+    // Response to a request dropped by reset(), or not waited for: the book is not touched
+    if(book->state != State::Requested || generation != getGeneration()) {
+      m_staleSnapshots.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    if(version < book->gapVersion) {
+      m_gaps.fetch_add(1, std::memory_order_relaxed);
+      retry = true;
+    } else if(version < book->lastVersion && book->attempts < MaxStaleAttempts) {
+      m_staleSnapshots.fetch_add(1, std::memory_order_relaxed);
+      book->attempts ++;
+      retry = true;
+    } else {
+      apply(instrument, *book, version, entries, tag);
+      book->state = State::Live;
+    }
+  }
+
+  // The slot stays taken by a retried instrument
+  if(retry) {
+    if(!m_request(instrument)) {
+      giveUp(instrument);
+      pump();
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_inFlight --;
+  }
+  pump();
+}
+
+/**
+ * The instrument keeps buffering, releases its slot and is queued again behind the others waiting
+ * once its backoff expired, so a rate limited or failing endpoint is not polled in a tight loop
+ * @param generation getGeneration() when the request was issued, failures of older generations are ignored
+ */
+void OrderBookSync::onSnapshotFailed(InstrumentHandle instrument, uint64_t generation)
+{
+  Book *book = findBook(instrument);
+  if(!book) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(book->lock);
+    if(book->state != State::Requested || generation != getGeneration()) {
+      return;
+    }
+    book->state = State::Queued;
+    book->retryPending = true;
+    if(!book->retryTimer) {
+      book->retryTimer.reset(platform::TimerService::instance().createTimer([this, instrument](platform::Timer*){ this->retry(instrument); }));
+    }
+    book->retryTimer->start(std::chrono::seconds(1 << std::min(book->failures, MaxRetryShift)));
+    book->failures ++;
+  }
+  m_failures.fetch_add(1, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_inFlight --;
+  }
+  pump();
+}
+
+// Backoff of a failed request expired, timer thread
+void OrderBookSync::retry(InstrumentHandle instrument)
+{
+  Book *book = findBook(instrument);
+  {
+    std::lock_guard<std::mutex> lock(book->lock);
+    // reset() in the meantime
+    if(book->state != State::Queued || !book->retryPending) {
+      return;
+    }
+    book->retryPending = false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_queue.push_back(instrument);
+  }
+  pump();
+}
+
+/**
+ * Drops buffers and pending requests, responses still arriving for them are ignored
+ */
+void OrderBookSync::reset()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_generation.fetch_add(1, std::memory_order_acq_rel);
+  for(auto &entry : m_books) {
+    std::lock_guard<std::mutex> bookLock(entry.second->lock);
+    entry.second->state = State::Idle;
+    entry.second->lastVersion = 0;
+    entry.second->retryPending = false;
+    entry.second->buffer.clear();
+  }
+  m_queue.clear();
+  m_inFlight = 0;
+}
+
+OrderBookSync::State OrderBookSync::getState(InstrumentHandle instrument)
+{
+  Book *book = findBook(instrument);
+  if(!book) {
+    return State::Idle;
+  }
+  std::lock_guard<std::mutex> lock(book->lock);
+  return book->state;
+}
+
+OrderBookSync::Stats OrderBookSync::getStats()
+{
+  Stats stats;
+  stats.snapshots = m_snapshots.load(std::memory_order_relaxed);
+  stats.staleSnapshots = m_staleSnapshots.load(std::memory_order_relaxed);
+  stats.replayed = m_replayed.load(std::memory_order_relaxed);
+  stats.discarded = m_discarded.load(std::memory_order_relaxed);
+  stats.gaps = m_gaps.load(std::memory_order_relaxed);
+  stats.failures = m_failures.load(std::memory_order_relaxed);
+  return stats;
+}
+
+size_t OrderBookSync::getInFlight()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_inFlight;
+}
+
+}
@@ -0,0 +1,120 @@
+/***************************************************
+ * orderbook_sync.h
+ * Created on Sun, 18 Oct 2026 22:37:40 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "orderbook.h"
+#include "profiling.h"
+#include "platform/timer.h"
+
+namespace fin {
+
+/**
+ * Synchronizes orderbooks built from a snapshot source (REST depth) and a delta stream (WebSocket).
+ * Per instrument: deltas are buffered while the snapshot is requested, the snapshot is applied,
+ * buffered deltas not older than the snapshot are replayed and the instrument goes live.
+ * A snapshot older than the deltas already delivered is dropped instead of overwriting them.
+ * Snapshot requests run in parallel up to the concurrency limit, the rest wait in FIFO order.
+ * A failed request is queued again after a per-instrument backoff, which needs a platform::TimerService.
+ * reset() starts a new generation; a snapshot response carries the generation its request was issued in
+ * and responses of an older generation are dropped.
+ *
+ * Versions order snapshots and deltas; both sources must use the same clock, e.g. local receive time of deltas
+ * and local request time of snapshots. A delta between the snapshot request and its response may or may not be
+ * in the snapshot, it is replayed either way.
+ * Level deltas carry absolute amounts, so replaying a delta already contained in the snapshot is harmless.
+ * Deltas of one instrument must not be passed concurrently, different instruments may be.
+ */
+class OrderBookSync {
+public:
+  enum class State {
+    Idle = 0,  //!< Not synchronized, deltas pass through
+    Queued,    //!< Buffering deltas, waiting for a free snapshot request slot
+    Requested, //!< Buffering deltas, snapshot requested
+    Live       //!< Snapshot applied, deltas pass through
+  };
+
+  //! Counters over all instruments
+  struct Stats {
+    uint64_t snapshots = 0; //!< Snapshots applied
+    uint64_t staleSnapshots = 0; //!< Snapshots dropped because deltas were newer, or their request was dropped
+    uint64_t replayed = 0; //!< Buffered deltas replayed after a snapshot
+    uint64_t discarded = 0; //!< Buffered deltas older than the snapshot
+    uint64_t gaps = 0; //!< Snapshots re-requested because the buffer overflowed past them
+    uint64_t failures = 0; //!< Snapshot requests that failed
+  };
+
+  typedef std::function<bool(InstrumentHandle)> SnapshotRequest; //!< Issue snapshot request, false if it could not be sent
+  typedef std::function<void(InstrumentHandle, OrderBookSpan, bool snapshot, ProfilingTag)> Output; //!< Deliver entries, snapshot replaces the book
+
+  OrderBookSync(SnapshotRequest request, Output output, size_t maxConcurrent = 4, size_t maxBuffered = 1024);
+
+  void sync(InstrumentHandle instrument); //!< Start buffering and request a snapshot
+  void onDelta(InstrumentHandle instrument, long version, OrderBookSpan entries, ProfilingTag tag); //!< Delta from the stream
+  void onSnapshot(InstrumentHandle instrument, uint64_t generation, long version, OrderBookSpan entries, ProfilingTag tag); //!< Snapshot response
+  void onSnapshotFailed(InstrumentHandle instrument, uint64_t generation); //!< Snapshot request failed, it is retried after a backoff
+  void reset(); //!< All instruments back to Idle, e.g. after the stream disconnected
+  uint64_t getGeneration() const { return m_generation.load(std::memory_order_acquire); } //!< To be stored with each snapshot request
+
+  State getState(InstrumentHandle instrument);
+  Stats getStats();
+  size_t getInFlight(); //!< Snapshot requests in progress
+
+private:
+  struct Delta {
+    long version;
+    ProfilingTag tag;
+    OrderBookList entries;
+  };
+
+  struct Book {
+    std::mutex lock;
+    State state = State::Idle;
+    long lastVersion = 0;   // Newest version delivered
+    long gapVersion = 0;    // Newest version dropped from the full buffer
+    int attempts = 0;       // Snapshots rejected as too old during this sync
+    unsigned failures = 0;  // Failed requests since the last applied snapshot, scales the retry backoff
+    bool retryPending = false; // Queued state, but waiting for retryTimer instead of m_queue
+    std::unique_ptr<platform::Timer> retryTimer; // Created on the first failure
+    std::deque<Delta> buffer;
+  };
+
+  Book &getBook(InstrumentHandle instrument);
+  Book *findBook(InstrumentHandle instrument);
+  void apply(InstrumentHandle instrument, Book &book, long version, OrderBookSpan entries, ProfilingTag tag);
+  void giveUp(InstrumentHandle instrument);
+  void retry(InstrumentHandle instrument);
+  void pump();
+
+  SnapshotRequest m_request;
+  Output m_output;
+  size_t m_maxConcurrent;
+  size_t m_maxBuffered;
+
+  std::mutex m_lock; // Guards the books map, the queue and m_inFlight, never taken while a book is locked
+  std::unordered_map<InstrumentHandle, std::unique_ptr<Book>> m_books;
+  std::deque<InstrumentHandle> m_queue;
+  size_t m_inFlight;
+  std::atomic<uint64_t> m_generation; // Bumped by reset()
+
+  std::atomic<uint64_t> m_snapshots;
+  std::atomic<uint64_t> m_staleSnapshots;
+  std::atomic<uint64_t> m_replayed;
+  std::atomic<uint64_t> m_discarded;
+  std::atomic<uint64_t> m_gaps;
+  std::atomic<uint64_t> m_failures;
+};
+
+}
@@ -0,0 +1,364 @@
+/***************************************************
+ * shm_publisher.cpp
+ * Created on Sun, 18 Oct 2026 20:58:14 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdexcept>
+#include <thread>
+#include "platform/log.h"
+#include "shm_publisher.h"
+
+namespace fin {
+
+static const size_t HeaderSize = 4096;
+
+static inline int64_t toFixed(const FixedNumber &value) {
+  return llround(value.toDouble() * SHM_MARKET_DATA_SCALE);
+}
+
+static inline size_t pageAlign(size_t size) {
+  return (size + HeaderSize - 1) & ~(HeaderSize - 1);
+}
+
+/**
+ * Checks whether a segment with the name exists and belongs to a running publisher.
+ * A segment without a valid header (partially created or foreign) or of a dead process is stale.
+ */
+static bool isSegmentOwned(const std::string &name)
+{
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if(fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if(fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(platform::ShmMarketDataHeader)) {
+    close(fd);
+    return false;
+  }
+
+  void *map = mmap(NULL, sizeof(platform::ShmMarketDataHeader), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    return false;
+  }
+
+  const platform::ShmMarketDataHeader *header = static_cast<const platform::ShmMarketDataHeader*>(map);
+  bool owned = !memcmp(header->magic, SHM_MARKET_DATA_MAGIC, sizeof(header->magic)) &&
+               header->publisherPid > 0 &&
+               (kill(header->publisherPid, 0) == 0 || errno == EPERM);
+  munmap(map, sizeof(platform::ShmMarketDataHeader));
+  return owned;
+}
+
+/**
+ * Creates the segment, a stale segment with the same name left by a crashed publisher is replaced.
+ * Throws when the segment belongs to a running publisher, its readers would silently lose the feed.
+ * @param name POSIX shared memory object name, e.g. "/cryptoadapter-md"
+ * @param capacity ring size in deltas, power of 2. Readers falling behind by more than that lose deltas.
+ * @param maxInstruments size of the top of book table
+ * @param control observer for symbols, instruments, candlesticks and errors
+ */
+ShmPublisher::ShmPublisher(const std::string &name, size_t capacity, uint32_t maxInstruments,
+                           interface::StockDataObserver *control)
+  : m_name(name)
+  , m_map(NULL)
+  , m_mapSize(0)
+  , m_header(NULL)
+  , m_instruments(NULL)
+  , m_lock(ATOMIC_FLAG_INIT)
+  , m_books(maxInstruments)
+  , m_dropped(0)
+  , m_control(control)
+{
+  if(!capacity || (capacity & (capacity - 1))) {
+    throw std::invalid_argument("Market data ring capacity must be a power of 2");
+  }
+
+  size_t instrumentsOffset = HeaderSize;
+  size_t ringOffset = pageAlign(instrumentsOffset + maxInstruments * sizeof(platform::ShmInstrumentSlot));
+  m_mapSize = ringOffset + capacity * sizeof(platform::ShmDeltaSlot);
+
+  if(isSegmentOwned(name)) {
+    throw std::runtime_error("Market data segment " + name + " is used by a running publisher");
+  }
+
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if(fd < 0) {
+    throw std::runtime_error("Can not create market data segment " + name + ": " + strerror(errno));
+  }
+
+  // New segment is zero filled, so all stamps and seqlocks start at 0
+  if(ftruncate(fd, m_mapSize) < 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error("Can not allocate market data segment " + name + ": " + strerror(errno));
+  }
+
+  m_map = mmap(NULL, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(m_map == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    throw std::runtime_error("Can not map market data segment " + name + ": " + strerror(errno));
+  }
+
+  char *base = static_cast<char*>(m_map);
+  m_header = reinterpret_cast<platform::ShmMarketDataHeader*>(base);
+  m_instruments = reinterpret_cast<platform::ShmInstrumentSlot*>(base + instrumentsOffset);
+  m_ring = platform::ShmDeltaRing(reinterpret_cast<platform::ShmDeltaSlot*>(base + ringOffset), capacity, &m_header->published);
+
+  m_header->version = SHM_MARKET_DATA_VERSION;
+  m_header->headerSize = HeaderSize;
+  m_header->segmentSize = m_mapSize;
+  m_header->instrumentsOffset = instrumentsOffset;
+  m_header->ringOffset = ringOffset;
+  m_header->ringCapacity = capacity;
+  m_header->maxInstruments = maxInstruments;
+  m_header->publisherPid = getpid();
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(m_header->magic, SHM_MARKET_DATA_MAGIC, sizeof(m_header->magic));
+}
+
+/**
+ * The name is removed, processes still attached keep reading the last published state
+ */
+ShmPublisher::~ShmPublisher()
+{
+  munmap(m_map, m_mapSize);
+  shm_unlink(m_name.c_str());
+}
+
+uint64_t ShmPublisher::getPublished() const
+{
+  return m_ring.getPublished();
+}
+
+inline void ShmPublisher::lock() noexcept
+{
+  while(__builtin_expect(m_lock.test_and_set(std::memory_order_acquire), 0)) {
+    std::this_thread::yield();
+  }
+}
+
+inline void ShmPublisher::unlock() noexcept
+{
+  m_lock.clear(std::memory_order_release);
+}
+
+/**
+ * Returns table slot of the instrument, the first update of an instrument publishes its name
+ * @return -1 when the table is full or the entry has no instrument
+ */
+int ShmPublisher::findSlot(InstrumentHandle instrument)
+{
+  if(instrument == NoInstrument) {
+    return -1;
+  }
+
+  auto found = m_slotIndex.find(instrument);
+  if(found != m_slotIndex.end()) {
+    return found->second;
+  }
+
+  uint32_t count = m_header->instrumentCount.load(std::memory_order_relaxed);
+  if(count >= m_header->maxInstruments) {
+    if(!m_dropped.load(std::memory_order_relaxed)) {
+      platform::LogError() << "Market data segment " << m_name << " is full, instrument "
+                           << instrument->first->symbol << "/" << instrument->second->symbol << " is not published";
+    }
+    return -1;
+  }
+
+  snprintf(m_instruments[count].name, SHM_MARKET_DATA_NAME_SIZE, "%s/%s",
+           instrument->first->symbol.c_str(), instrument->second->symbol.c_str());
+  m_header->instrumentCount.store(count + 1, std::memory_order_release);
+  m_slotIndex[instrument] = count;
+  return count;
+}
+
+void ShmPublisher::applyLevel(uint32_t slot, const platform::ShmDelta &delta)
+{
+  Book &book = m_books[slot];
+  if(delta.side == platform::ShmDelta::Bid) {
+    if(delta.amount) {
+      book.bids[delta.price] = delta.amount;
+    } else {
+      book.bids.erase(delta.price);
+    }
+  } else {
+    if(delta.amount) {
+      book.asks[delta.price] = delta.amount;
+    } else {
+      book.asks.erase(delta.price);
+    }
+  }
+
+  book.timestamp = delta.timestamp;
+  book.tag = delta.tag;
+  if(!book.dirty) {
+    book.dirty = true;
+    m_touched.push_back(slot);
+  }
+}
+
+void ShmPublisher::clearBook(uint32_t slot, uint64_t tag)
+{
+  Book &book = m_books[slot];
+  book.bids.clear();
+  book.asks.clear();
+  book.tag = tag;
+  book.dirty = true;
+  updateTopOfBook(slot);
+}
+
+// Seqlock write: odd sequence while the top of book is inconsistent
+void ShmPublisher::updateTopOfBook(uint32_t slot)
+{
+  Book &book = m_books[slot];
+  platform::ShmInstrumentSlot &entry = m_instruments[slot];
+  platform::ShmTopOfBook top;
+
+  top.bidPrice = book.bids.empty() ? 0 : book.bids.begin()->first;
+  top.bidAmount = book.bids.empty() ? 0 : book.bids.begin()->second;
+  top.askPrice = book.asks.empty() ? 0 : book.asks.begin()->first;
+  top.askAmount = book.asks.empty() ? 0 : book.asks.begin()->second;
+  top.timestamp = book.timestamp;
+  top.tag = book.tag;
+  top.updates = entry.book.updates + 1;
+  book.dirty = false;
+
+  const uint64_t sequence = entry.sequence.load(std::memory_order_relaxed);
+  entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&entry.book, &top, sizeof(platform::ShmTopOfBook));
+  entry.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void ShmPublisher::invalidateData(InstrumentHandle instrument, ProfilingTag tag)
+{
+  platform::ShmDelta delta;
+  memset(&delta, 0, sizeof(delta));
+  delta.type = platform::ShmDelta::Clear;
+  delta.flags = platform::ShmDelta::BatchBegin | platform::ShmDelta::BatchEnd;
+  delta.tag = tag.timestamp;
+
+  lock();
+  if(instrument == NoInstrument) {
+    delta.instrument = SHM_MARKET_DATA_ALL_INSTRUMENTS;
+    m_ring.publish(delta);
+    uint32_t count = m_header->instrumentCount.load(std::memory_order_relaxed);
+    for(uint32_t slot = 0; slot < count; slot ++) {
+      clearBook(slot, tag.timestamp);
+    }
+  } else {
+    int slot = findSlot(instrument);
+    if(slot >= 0) {
+      delta.instrument = slot;
+      m_ring.publish(delta);
+      clearBook(slot, tag.timestamp);
+    }
+  }
+  unlock();
+}
+
+void ShmPublisher::orderbookEntryAdded(OrderBookEntry entry, ProfilingTag tag)
+{
+  orderbookEntriesSpan(OrderBookSpan(&entry, 1), tag);
+}
+
+void ShmPublisher::orderbookEntriesBulk(OrderBookList entries, ProfilingTag tag)
+{
+  orderbookEntriesSpan(entries, tag);
+}
+
+/**
+ * Publishes the entries as one batch of Level deltas, then updates top of book of every instrument touched.
+ * The last delta is held back until the end of the batch, so BatchEnd is set even when trailing entries are dropped.
+ */
+void ShmPublisher::orderbookEntriesSpan(OrderBookSpan entries, ProfilingTag tag)
+{
+  platform::ShmDelta pending;
+  bool hasPending = false;
+  uint16_t flags = platform::ShmDelta::BatchBegin;
+
+  lock();
+  for(const auto &entry : entries) {
+    int slot = findSlot(entry.instrument);
+    if(slot < 0) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    if(hasPending) {
+      m_ring.publish(pending);
+    }
+
+    pending.instrument = slot;
+    pending.type = platform::ShmDelta::Level;
+    pending.side = entry.direction == OrderDir::Bid ? platform::ShmDelta::Bid : platform::ShmDelta::Ask;
+    pending.flags = flags;
+    pending.price = toFixed(entry.price);
+    pending.amount = toFixed(entry.amount);
+    pending.timestamp = entry.timestamp;
+    pending.tag = tag.timestamp;
+    applyLevel(slot, pending);
+
+    hasPending = true;
+    flags = 0;
+  }
+
+  if(hasPending) {
+    pending.flags |= platform::ShmDelta::BatchEnd;
+    m_ring.publish(pending);
+  }
+
+  for(auto slot : m_touched) {
+    updateTopOfBook(slot);
+  }
+  m_touched.clear();
+  unlock();
+}
+
+void ShmPublisher::candleStickEntryAdded(CandleStickEntry entry, ProfilingTag tag)
+{
+  if(m_control) {
+    m_control->candleStickEntryAdded(std::move(entry), tag);
+  }
+}
+
+void ShmPublisher::symbolAdded(SymbolHandle symbol, ProfilingTag tag)
+{
+  if(m_control) {
+    m_control->symbolAdded(symbol, tag);
+  }
+}
+
+void ShmPublisher::instrumentAdded(InstrumentHandle instrument, ProfilingTag tag)
+{
+  if(m_control) {
+    m_control->instrumentAdded(instrument, tag);
+  }
+}
+
+void ShmPublisher::dataConnectorError(std::exception_ptr error)
+{
+  if(m_control) {
+    m_control->dataConnectorError(error);
+  }
+}
+
+}
@@ -0,0 +1,89 @@
+/***************************************************
+ * shm_publisher.h
+ * Created on Sun, 18 Oct 2026 20:58:14 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "platform/shm_market_data.h"
+#include "market.h"
+
+namespace fin {
+
+/**
+ * Observer publishing orderbook updates into a POSIX shared memory segment, so other local
+ * processes read the books of this process instead of running their own connectors.
+ * Every entry becomes a normalized delta in the ring, invalidation becomes a Clear delta,
+ * and the top of book of each instrument is kept in a seqlocked table for random access.
+ * Readers use platform::ShmMarketDataSubscriber.
+ * Updates may come from several threads (parse workers), publishing is serialized internally.
+ * Non-orderbook callbacks are passed to the optional control observer.
+ */
+class ShmPublisher
+  : public interface::StockDataObserver
+{
+public:
+  ShmPublisher(const std::string &name, size_t capacity, uint32_t maxInstruments = 256,
+               interface::StockDataObserver *control = nullptr);
+  ~ShmPublisher();
+
+  const std::string &getName() const { return m_name; } //!< Shared memory object name
+  uint64_t getPublished() const; //!< Number of published deltas
+  uint64_t getDropped() const { return m_dropped.load(std::memory_order_relaxed); } //!< Entries of instruments that did not fit the table
+
+  virtual void invalidateData(InstrumentHandle, ProfilingTag) override;
+  virtual void orderbookEntryAdded(OrderBookEntry, ProfilingTag) override;
+  virtual void orderbookEntriesBulk(OrderBookList, ProfilingTag) override;
+  virtual void orderbookEntriesSpan(OrderBookSpan, ProfilingTag) override;
+  virtual void candleStickEntryAdded(CandleStickEntry, ProfilingTag) override;
+  virtual void symbolAdded(SymbolHandle, ProfilingTag) override;
+  virtual void instrumentAdded(InstrumentHandle, ProfilingTag) override;
+  virtual void dataConnectorError(std::exception_ptr) override;
+
+private:
+  // Levels of one instrument, needed to find the next best price when the best level is removed
+  struct Book {
+    std::map<int64_t, int64_t, std::greater<int64_t>> bids;
+    std::map<int64_t, int64_t> asks;
+    bool dirty = false;
+    int64_t timestamp = 0;
+    uint64_t tag = 0;
+  };
+
+  int findSlot(InstrumentHandle instrument);
+  void applyLevel(uint32_t slot, const platform::ShmDelta &delta);
+  void clearBook(uint32_t slot, uint64_t tag);
+  void updateTopOfBook(uint32_t slot);
+
+  inline void lock() noexcept;
+  inline void unlock() noexcept;
+
+  ShmPublisher(const ShmPublisher &) = delete;
+  void operator =(const ShmPublisher &) = delete;
+
+  std::string m_name;
+  void *m_map;
+  size_t m_mapSize;
+  platform::ShmMarketDataHeader *m_header;
+  platform::ShmInstrumentSlot *m_instruments;
+  platform::ShmDeltaRing m_ring;
+
+  std::atomic_flag m_lock;
+  std::unordered_map<InstrumentHandle, uint32_t> m_slotIndex;
+  std::vector<Book> m_books;
+  std::vector<uint32_t> m_touched;
+  std::atomic<uint64_t> m_dropped;
+  interface::StockDataObserver *m_control;
+};
+
+}
@@ -0,0 +1,237 @@
+/***************************************************
+ * broadcast_ring.h
+ * Created on Sun, 18 Oct 2026 19:20:46 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+namespace platform {
+
+enum class BroadcastReadResult {
+  Ok = 0,
+  Empty,  // Nothing new published yet
+  Overrun // Reader was lapped by the producer, cursor moved to the oldest available event
+};
+
+// Ring slot, stamped with sequence + 1 of the event it holds (0 while written)
+template<typename T>
+struct alignas(64) BroadcastSlot {
+  std::atomic<uint64_t> sequence;
+  T value;
+};
+
+// Consumer position in a broadcast ring
+class BroadcastCursor {
+public:
+  BroadcastCursor() : m_next(0), m_lost(0) { }
+  uint64_t getNext() const { return m_next; } //!< Sequence of the next event to read
+  uint64_t getLost() const { return m_lost; } //!< Events skipped because of overruns
+
+private:
+  uint64_t m_next;
+  uint64_t m_lost;
+  template<typename T> friend class BroadcastRingView;
+};
+
+/**
+ * Broadcast ring protocol over slots and a published counter owned by the caller,
+ * e.g. placed in a shared memory segment. Memory must start zero filled.
+ * Each slot is stamped with the sequence of the event it holds, so a reader validates
+ * the stamp before and after reading and detects when a slot was overwritten.
+ * Only one producer may publish, readers never write, so a view over read-only memory may read.
+ */
+template<typename T>
+class BroadcastRingView {
+  static_assert(std::is_trivially_copyable<T>::value, "BroadcastRing requires trivially copyable events");
+
+public:
+  typedef BroadcastSlot<T> Slot;
+  typedef BroadcastCursor Cursor;
+
+  BroadcastRingView() : m_slots(nullptr), m_capacity(0), m_mask(0), m_published(nullptr) { }
+  BroadcastRingView(Slot *slots, size_t capacity, std::atomic<uint64_t> *published)
+    : m_slots(slots)
+    , m_capacity(capacity)
+    , m_mask(capacity - 1)
+    , m_published(published)
+  {
+    if(!isValidCapacity(capacity)) {
+      throw std::invalid_argument("BroadcastRing capacity must be a power of 2");
+    }
+  }
+
+  static bool isValidCapacity(size_t capacity) { return capacity && !(capacity & (capacity - 1)); } //!< Power of 2
+
+  //! Producer: construct the next event in place and publish it
+  template<typename Writer>
+  inline void publish(Writer writer) noexcept {
+    const uint64_t sequence = m_published->load(std::memory_order_relaxed);
+    Slot &slot = m_slots[sequence & m_mask];
+
+    // Invalidate the stamp first, readers of the old event see the change
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    writer(slot.value);
+    slot.sequence.store(sequence + 1, std::memory_order_release);
+    m_published->store(sequence + 1, std::memory_order_release);
+  }
+
+  //! Producer: copy the event into the next slot and publish it
+  inline void publish(const T &value) noexcept {
+    publish([&value](T &slot) { memcpy(&slot, &value, sizeof(T)); });
+  }
+
+  //! Cursor positioned at the next event to be published
+  Cursor subscribe() const {
+    Cursor cursor;
+    cursor.m_next = getPublished();
+    return cursor;
+  }
+
+  /**
+   * Read the event at the cursor in place. The reader is called with the slot contents and
+   * the result is validated after it returns; on Overrun whatever the reader saw must be discarded.
+   */
+  template<typename Reader>
+  inline BroadcastReadResult read(Cursor &cursor, Reader reader) const noexcept {
+    const uint64_t sequence = cursor.m_next;
+    const Slot &slot = m_slots[sequence & m_mask];
+
+    uint64_t stamp = slot.sequence.load(std::memory_order_acquire);
+    if(stamp != sequence + 1) {
+      if(getPublished() <= sequence) {
+        return BroadcastReadResult::Empty;
+      }
+      resync(cursor);
+      return BroadcastReadResult::Overrun;
+    }
+
+    reader(slot.value);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot.sequence.load(std::memory_order_relaxed) != stamp) {
+      resync(cursor);
+      return BroadcastReadResult::Overrun;
+    }
+
+    cursor.m_next ++;
+    return BroadcastReadResult::Ok;
+  }
+
+  //! Copy the event at the cursor
+  inline BroadcastReadResult read(Cursor &cursor, T &value) const noexcept {
+    return read(cursor, [&value](const T &slot) { memcpy(&value, &slot, sizeof(T)); });
+  }
+
+  //! Read up to max available events, stops at the first overrun. Returns number of events read.
+  template<typename Reader>
+  size_t poll(Cursor &cursor, Reader reader, size_t max = SIZE_MAX) const {
+    size_t count = 0;
+    T value;
+    while(count < max && read(cursor, value) == BroadcastReadResult::Ok) {
+      reader(value);
+      count ++;
+    }
+    return count;
+  }
+
+  uint64_t getPublished() const { return m_published->load(std::memory_order_acquire); } //!< Number of published events
+  size_t getCapacity() const { return m_capacity; } //!< Ring capacity
+  //! Events waiting for the cursor. A slot is stamped before the counter moves, so a reader may be one ahead.
+  uint64_t getLag(const Cursor &cursor) const {
+    uint64_t published = getPublished();
+    return published > cursor.m_next ? published - cursor.m_next : 0;
+  }
+
+private:
+  // Move the lapped cursor to the oldest event that is still in the ring
+  void resync(Cursor &cursor) const noexcept {
+    uint64_t published = getPublished();
+    uint64_t oldest = published > m_capacity ? published - m_capacity + 1 : 0;
+    if(oldest > cursor.m_next) {
+      cursor.m_lost += oldest - cursor.m_next;
+      cursor.m_next = oldest;
+    }
+  }
+
+  Slot *m_slots;
+  uint64_t m_capacity;
+  uint64_t m_mask;
+  std::atomic<uint64_t> *m_published;
+};
+
+/**
+ * Single producer, multiple consumer broadcast ring.
+ * Every consumer owns a cursor and reads all events at its own pace, the producer never waits
+ * for consumers. The ring owns its slots, the protocol is implemented by BroadcastRingView.
+ * T must be trivially copyable, readers may observe partially written values and drop them.
+ */
+template<typename T>
+class BroadcastRing {
+public:
+  typedef BroadcastCursor Cursor;
+
+  BroadcastRing(size_t capacity)
+    : m_slots(nullptr)
+    , m_published(0)
+  {
+    if(!BroadcastRingView<T>::isValidCapacity(capacity)) {
+      throw std::invalid_argument("BroadcastRing capacity must be a power of 2");
+    }
+    // Slots are over-aligned, operator new does not honour that before C++17
+    void *memory;
+    if(posix_memalign(&memory, alignof(BroadcastSlot<T>), capacity * sizeof(BroadcastSlot<T>))) {
+      throw std::bad_alloc();
+    }
+    memset(memory, 0, capacity * sizeof(BroadcastSlot<T>));
+    m_slots = static_cast<BroadcastSlot<T>*>(memory);
+    m_view = BroadcastRingView<T>(m_slots, capacity, &m_published);
+  }
+
+  ~BroadcastRing() {
+    free(m_slots);
+  }
+
+  //! Producer: construct the next event in place and publish it
+  template<typename Writer>
+  inline void publish(Writer writer) noexcept { m_view.publish(writer); }
+  //! Producer: copy the event into the next slot and publish it
+  inline void publish(const T &value) noexcept { m_view.publish(value); }
+
+  Cursor subscribe() const { return m_view.subscribe(); } //!< Cursor positioned at the next event to be published
+
+  //! Read the event at the cursor in place, see BroadcastRingView::read
+  template<typename Reader>
+  inline BroadcastReadResult read(Cursor &cursor, Reader reader) noexcept { return m_view.read(cursor, reader); }
+  //! Copy the event at the cursor
+  inline BroadcastReadResult read(Cursor &cursor, T &value) noexcept { return m_view.read(cursor, value); }
+
+  //! Read up to max available events, stops at the first overrun. Returns number of events read.
+  template<typename Reader>
+  size_t poll(Cursor &cursor, Reader reader, size_t max = SIZE_MAX) noexcept { return m_view.poll(cursor, reader, max); }
+
+  uint64_t getPublished() const { return m_view.getPublished(); } //!< Number of published events
+  size_t getCapacity() const { return m_view.getCapacity(); } //!< Ring capacity
+  uint64_t getLag(const Cursor &cursor) const { return m_view.getLag(cursor); } //!< Events waiting for the cursor
+
+private:
+  BroadcastRing(const BroadcastRing &) = delete;
+  void operator =(const BroadcastRing &) = delete;
+
+  BroadcastSlot<T> *m_slots;
+  alignas(64) std::atomic<uint64_t> m_published;
+  BroadcastRingView<T> m_view;
+};
+
+}
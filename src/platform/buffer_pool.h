@@ -0,0 +1,74 @@
+/***************************************************
+ * buffer_pool.h
+ * Created on Sun, 18 Oct 2026 18:52:33 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace platform {
+
+// Free list of byte buffers shared between producer and consumer threads.
+// Released buffers keep their capacity, so in steady state acquire() does not allocate.
+class BufferPool {
+public:
+  BufferPool(size_t reserve = 4096)
+    : m_lock(ATOMIC_FLAG_INIT)
+    , m_reserve(reserve)
+  { }
+
+  ~BufferPool() {
+    for(auto buffer : m_free) {
+      delete buffer;
+    }
+  }
+
+  std::string *acquire() {
+    std::string *buffer = nullptr;
+    lock();
+    if(!m_free.empty()) {
+      buffer = m_free.back();
+      m_free.pop_back();
+    }
+    unlock();
+
+    if(!buffer) {
+      buffer = new std::string;
+      buffer->reserve(m_reserve);
+    }
+    return buffer;
+  }
+
+  void release(std::string *buffer) {
+    lock();
+    m_free.push_back(buffer);
+    unlock();
+  }
+
+private:
+  inline void lock() noexcept {
+    while(__builtin_expect(m_lock.test_and_set(std::memory_order_acquire), 0)) {
+      std::this_thread::yield();
+    }
+  }
+
+  inline void unlock() noexcept {
+    m_lock.clear(std::memory_order_release);
+  }
+
+  BufferPool(const BufferPool &) = delete;
+  void operator =(const BufferPool &) = delete;
+
+  std::atomic_flag m_lock;
+  size_t m_reserve;
+  std::vector<std::string*> m_free;
+};
+
+}
@@ -0,0 +1,65 @@
+/***************************************************
+ * clock.cpp
+ * Created on Sun, 18 Oct 2026 11:10:48 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <time.h>
+#include <errno.h>
+#include "clock.h"
+
+namespace platform {
+
+static SystemClock s_systemClock;
+
+std::atomic<Clock*> Clock::s_instance(&s_systemClock);
+
+Clock &Clock::instance() {
+  return *s_instance.load(std::memory_order_acquire);
+}
+
+void Clock::setInstance(Clock *clock) {
+  s_instance.store(clock ? clock : &s_systemClock, std::memory_order_release);
+}
+
+unsigned long SystemClock::now() noexcept {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void SystemClock::sleepUntil(unsigned long timestamp) {
+  struct timespec until;
+  until.tv_sec = timestamp / 1000000000;
+  until.tv_nsec = timestamp % 1000000000;
+  while(clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &until, NULL) == EINTR)
+  { }
+}
+
+ManualClock::ManualClock(unsigned long start)
+  : m_now(start)
+{ }
+
+unsigned long ManualClock::now() noexcept {
+  return m_now.load(std::memory_order_acquire);
+}
+
+void ManualClock::sleepUntil(unsigned long timestamp) {
+  // Simulated time jumps forward instead of waiting
+  unsigned long current = m_now.load(std::memory_order_acquire);
+  while(current < timestamp && !m_now.compare_exchange_weak(current, timestamp))
+  { }
+}
+
+void ManualClock::set(unsigned long timestamp) {
+  m_now.store(timestamp, std::memory_order_release);
+}
+
+void ManualClock::advance(unsigned long duration) {
+  m_now.fetch_add(duration);
+}
+
+}
@@ -0,0 +1,54 @@
+/***************************************************
+ * clock.h
+ * Created on Sun, 18 Oct 2026 11:02:17 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <atomic>
+
+namespace platform {
+
+// Source of time for connector timers and replay pacing.
+// All values are nanoseconds since epoch (CLOCK_REALTIME scale).
+class Clock {
+public:
+  virtual ~Clock() { }
+  virtual unsigned long now() noexcept = 0;
+  virtual void sleepUntil(unsigned long timestamp) = 0;
+
+  static Clock &instance();
+  static void setInstance(Clock *clock); //!< Replace process clock, nullptr restores system clock
+
+private:
+  static std::atomic<Clock*> s_instance;
+};
+
+// Wall clock, the default
+class SystemClock
+  : public Clock {
+public:
+  virtual unsigned long now() noexcept override;
+  virtual void sleepUntil(unsigned long timestamp) override;
+};
+
+// Simulated clock, time moves only when it is set or when somebody sleeps on it
+class ManualClock
+  : public Clock {
+public:
+  ManualClock(unsigned long start = 0);
+
+  virtual unsigned long now() noexcept override;
+  virtual void sleepUntil(unsigned long timestamp) override;
+
+  void set(unsigned long timestamp);
+  void advance(unsigned long duration);
+
+private:
+  std::atomic<unsigned long> m_now;
+};
+
+}
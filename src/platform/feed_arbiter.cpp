@@ -0,0 +1,92 @@
+/***************************************************
+ * feed_arbiter.cpp
+ * Created on Sun, 18 Oct 2026 21:44:05 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <stdexcept>
+#include "feed_arbiter.h"
+
+namespace platform {
+
+static inline uint64_t payloadHash(const char *data, size_t size) {
+  uint64_t hash = 14695981039346656037ULL;
+  for(size_t i = 0; i < size; i ++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * @param legs number of redundant feeds
+ * @param window number of recent messages remembered, must cover the largest skew between the legs
+ */
+FeedArbiter::FeedArbiter(size_t legs, size_t window)
+  : m_stats(legs)
+  , m_window(window, Arrival{ 0, 0, 0 })
+  , m_next(0)
+{
+  if(!legs || legs > 32 || !window) {
+    throw std::invalid_argument("FeedArbiter requires 1 to 32 legs and a non-empty window");
+  }
+  m_index.reserve(window * 2);
+}
+
+/**
+ * Accounts the message received on the leg
+ * @param leg index of the leg the message came from
+ * @param data message payload
+ * @param size payload size
+ * @param timestamp receive time, nanoseconds
+ * @return true if the message arrived first and must be processed, false for a duplicate
+ */
+bool FeedArbiter::accept(size_t leg, const char *data, size_t size, unsigned long timestamp)
+{
+  LegStats &stats = m_stats[leg];
+  stats.messages ++;
+
+  const uint32_t bit = 1U << leg;
+  uint64_t hash = payloadHash(data, size);
+  auto found = m_index.find(hash);
+  if(found != m_index.end() && !(m_window[found->second].legs & bit)) {
+    Arrival &first = m_window[found->second];
+    first.legs |= bit;
+    uint64_t lag = timestamp > first.timestamp ? timestamp - first.timestamp : 0;
+    stats.lagCount ++;
+    stats.lagSum += lag;
+    if(lag > stats.lagMax) {
+      stats.lagMax = lag;
+    }
+    return false;
+  }
+
+  // Forget the oldest arrival to make room
+  Arrival &slot = m_window[m_next];
+  if(slot.timestamp) {
+    auto old = m_index.find(slot.hash);
+    if(old != m_index.end() && old->second == m_next) {
+      m_index.erase(old);
+    }
+  }
+  slot.hash = hash;
+  slot.timestamp = timestamp;
+  slot.legs = bit;
+  m_index[hash] = m_next;
+  m_next = (m_next + 1) % m_window.size();
+
+  stats.wins ++;
+  return true;
+}
+
+void FeedArbiter::resetStats()
+{
+  for(auto &stats : m_stats) {
+    stats = LegStats();
+  }
+}
+
+}
@@ -0,0 +1,58 @@
+/***************************************************
+ * feed_arbiter.h
+ * Created on Sun, 18 Oct 2026 21:44:05 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace platform {
+
+/**
+ * First-arrival arbitration of redundant feeds carrying identical messages.
+ * Every message is identified by the hash of its payload; the first leg delivering it wins and
+ * the copies arriving on the other legs within the window are reported as duplicates.
+ * A message repeated on the leg that already delivered it is a new message, not a copy.
+ * Not thread safe, the caller serializes accept() and the statistics getters.
+ */
+class FeedArbiter {
+public:
+  //! Counters of one leg
+  struct LegStats {
+    uint64_t messages = 0; //!< Messages received on the leg
+    uint64_t wins = 0; //!< Messages the leg delivered first
+    uint64_t lagCount = 0; //!< Duplicates with a known first arrival
+    uint64_t lagSum = 0; //!< Total delay behind the winning leg, nanoseconds
+    uint64_t lagMax = 0; //!< Largest delay behind the winning leg, nanoseconds
+
+    double getWinRate() const { return messages ? (double)wins / messages : 0; } //!< Fraction of messages won
+    double getAverageLag() const { return lagCount ? (double)lagSum / lagCount : 0; } //!< Mean delay behind the winner, nanoseconds
+  };
+
+  FeedArbiter(size_t legs, size_t window = 4096);
+
+  bool accept(size_t leg, const char *data, size_t size, unsigned long timestamp); //!< True for the first arrival of the message
+  const LegStats &getStats(size_t leg) const { return m_stats[leg]; } //!< Counters of the leg
+  size_t getLegs() const { return m_stats.size(); } //!< Number of legs
+  void resetStats(); //!< Zero all counters
+
+private:
+  struct Arrival {
+    uint64_t hash;
+    unsigned long timestamp;
+    uint32_t legs; // Legs that delivered the message
+  };
+
+  std::vector<LegStats> m_stats;
+  std::vector<Arrival> m_window;  // Recent first arrivals, oldest is overwritten
+  size_t m_next;
+  std::unordered_map<uint64_t, size_t> m_index; // Hash to position in the window
+};
+
+}
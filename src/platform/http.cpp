@@ -11,6 +11,7 @@
 #include <iostream>
 #include <stdexcept>
 #include "http.h"
+#include "thread_topology.h"
 
 namespace platform {
 
@@ -189,8 +190,11 @@ HttpClient::HttpClient() {
 }
 
 HttpClient::~HttpClient() {
-  for(auto request : m_boundRequests) {
-    request->m_client = NULL;
+  {
+    std::lock_guard<std::mutex> lock(m_handlesSync);
+    for(auto request : m_boundRequests) {
+      request->m_client = NULL;
+    }
   }
   s_instances.erase(this);
   m_running = false;
@@ -216,12 +220,14 @@ HttpClient &HttpClient::instance() {
 
 HttpRequest *HttpClient::createRequest(std::string url) {
   HttpRequest *r = new HttpRequest(url, this);
+  std::lock_guard<std::mutex> lock(m_handlesSync);
   m_boundRequests.insert(r);
   return r;
 }
 
 HttpRequest *HttpClient::createRequest(HttpMethod method, std::string url) {
   HttpRequest *r = new HttpRequest(method, url, this);
+  std::lock_guard<std::mutex> lock(m_handlesSync);
   m_boundRequests.insert(r);
   return r;
 }
@@ -250,6 +256,7 @@ void HttpClient::detach(HttpRequest *request) {
 }
 
 void HttpClient::run() {
+  ThreadTopology::Scope scope("http");
   m_multiHandle = curl_multi_init();
 
   while (m_running) {
@@ -270,6 +277,7 @@ void HttpClient::run() {
         curl_easy_getinfo(m_removeHandles.front(), CURLINFO_PRIVATE, &req);
         if(req) {
           req->m_handle = NULL;
+          m_boundRequests.erase(req);
           delete req;
         }
 
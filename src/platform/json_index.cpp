@@ -0,0 +1,684 @@
+/***************************************************
+ * json_index.cpp
+ * Created on Mon, 19 Oct 2026 00:12:47 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "json_index.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_INDEX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace platform {
+
+static const uint32_t MaxDepth = 1024;
+static const uint32_t RootNode = 1;
+
+namespace {
+
+// Bitmasks of one 64 byte block, bit i stands for byte i
+struct BlockMasks {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t op; // { } [ ] : ,
+  uint64_t space; // Space, tab, CR, LF
+};
+
+typedef void (*ClassifyBlock)(const uint8_t *block, BlockMasks &masks);
+
+// SWAR helpers, a 64 bit word holds 8 bytes
+const uint64_t Ones = 0x0101010101010101ULL;
+const uint64_t Low7 = 0x7F7F7F7F7F7F7F7FULL;
+
+// High bit of every byte of x equal to c, exact (no false positives from borrows)
+inline uint64_t bytesEqual(uint64_t x, uint8_t c)
+{
+  const uint64_t t = x ^ (Ones * c);
+  return ~(((t & Low7) + Low7) | t | Low7);
+}
+
+// High bits of the 8 bytes packed into the low 8 bits
+inline uint64_t packBytes(uint64_t highBits)
+{
+  return ((highBits >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+void classifyScalar(const uint8_t *block, BlockMasks &masks)
+{
+  masks.quote = masks.backslash = masks.op = masks.space = 0;
+  for(int i = 0; i < 8; i ++) {
+    uint64_t x;
+    memcpy(&x, block + 8 * i, sizeof(x));
+    // '[' and ']' differ from '{' and '}' by 0x20 only
+    const uint64_t brace = x | (Ones * 0x20);
+    const uint64_t op = bytesEqual(brace, '{') | bytesEqual(brace, '}') | bytesEqual(x, ':') | bytesEqual(x, ',');
+    const uint64_t space = bytesEqual(x, ' ') | bytesEqual(x, '\t') | bytesEqual(x, '\n') | bytesEqual(x, '\r');
+    masks.quote |= packBytes(bytesEqual(x, '"')) << (8 * i);
+    masks.backslash |= packBytes(bytesEqual(x, '\\')) << (8 * i);
+    masks.op |= packBytes(op) << (8 * i);
+    masks.space |= packBytes(space) << (8 * i);
+  }
+}
+
+#ifdef JSON_INDEX_X86
+__attribute__((target("sse2")))
+void classifySSE2(const uint8_t *block, BlockMasks &masks)
+{
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i lower = _mm_set1_epi8(0x20);
+  const __m128i blank = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i cr = _mm_set1_epi8('\r');
+
+  masks.quote = masks.backslash = masks.op = masks.space = 0;
+  for(int i = 0; i < 4; i ++) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+    const __m128i brace = _mm_or_si128(v, lower);
+    const __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(brace, open), _mm_cmpeq_epi8(brace, close)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+    masks.quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << (16 * i);
+    masks.backslash |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << (16 * i);
+    const __m128i space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, blank), _mm_cmpeq_epi8(v, tab)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+    masks.op |= (uint64_t)(uint32_t)_mm_movemask_epi8(op) << (16 * i);
+    masks.space |= (uint64_t)(uint32_t)_mm_movemask_epi8(space) << (16 * i);
+  }
+}
+
+__attribute__((target("avx2")))
+void classifyAVX2(const uint8_t *block, BlockMasks &masks)
+{
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i open = _mm256_set1_epi8('{');
+  const __m256i close = _mm256_set1_epi8('}');
+  const __m256i colon = _mm256_set1_epi8(':');
+  const __m256i comma = _mm256_set1_epi8(',');
+  const __m256i lower = _mm256_set1_epi8(0x20);
+  const __m256i blank = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i cr = _mm256_set1_epi8('\r');
+
+  masks.quote = masks.backslash = masks.op = masks.space = 0;
+  for(int i = 0; i < 2; i ++) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+    const __m256i brace = _mm256_or_si256(v, lower);
+    const __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(brace, open), _mm256_cmpeq_epi8(brace, close)),
+                                       _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+    masks.quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << (32 * i);
+    masks.backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)) << (32 * i);
+    const __m256i space = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, blank), _mm256_cmpeq_epi8(v, tab)),
+                                          _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+    masks.op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << (32 * i);
+    masks.space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(space) << (32 * i);
+  }
+}
+#endif
+
+ClassifyBlock getKernel(JsonIndex::Backend backend)
+{
+  switch(backend) {
+#ifdef JSON_INDEX_X86
+  case JsonIndex::Backend::AVX2:
+    return classifyAVX2;
+  case JsonIndex::Backend::SSE2:
+    return classifySSE2;
+#endif
+  default:
+    return classifyScalar;
+  }
+}
+
+// Characters escaped by a backslash; backslashes are rare in market data, so they are walked one by one
+inline uint64_t findEscaped(uint64_t backslash, bool &carry)
+{
+  if(!backslash && !carry) {
+    return 0;
+  }
+  uint64_t escaped = carry ? 1 : 0;
+  carry = false;
+  while(backslash) {
+    const int i = __builtin_ctzll(backslash);
+    backslash &= backslash - 1;
+    if(escaped & (1ULL << i)) {
+      continue; // Escaped backslash escapes nothing
+    }
+    if(i == 63) {
+      carry = true;
+    } else {
+      escaped |= 1ULL << (i + 1);
+    }
+  }
+  return escaped;
+}
+
+// Bit i set when an odd number of quotes is at or before i
+inline uint64_t prefixXor(uint64_t x)
+{
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+inline bool isSpace(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline int hexDigit(char c)
+{
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+inline bool parseHex4(const char *p, uint32_t &value)
+{
+  value = 0;
+  for(int i = 0; i < 4; i ++) {
+    int digit = hexDigit(p[i]);
+    if(digit < 0) {
+      return false;
+    }
+    value = (value << 4) | digit;
+  }
+  return true;
+}
+
+// Unescapes the string in place, returns the new length or -1 on a bad escape
+long unescape(char *str, size_t size)
+{
+  const char *src = str, *end = str + size;
+  char *dst = str;
+  while(src < end) {
+    if(*src != '\\') {
+      *dst ++ = *src ++;
+      continue;
+    }
+    if(++ src >= end) {
+      return -1;
+    }
+    switch(*src ++) {
+    case '"': *dst ++ = '"'; break;
+    case '\\': *dst ++ = '\\'; break;
+    case '/': *dst ++ = '/'; break;
+    case 'b': *dst ++ = '\b'; break;
+    case 'f': *dst ++ = '\f'; break;
+    case 'n': *dst ++ = '\n'; break;
+    case 'r': *dst ++ = '\r'; break;
+    case 't': *dst ++ = '\t'; break;
+    case 'u': {
+      uint32_t code;
+      if(end - src < 4 || !parseHex4(src, code)) {
+        return -1;
+      }
+      src += 4;
+      // Surrogate pair
+      if(code >= 0xD800 && code < 0xDC00) {
+        uint32_t low;
+        if(end - src < 6 || src[0] != '\\' || src[1] != 'u' || !parseHex4(src + 2, low) || low < 0xDC00 || low > 0xDFFF) {
+          return -1;
+        }
+        src += 6;
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+      }
+      // UTF-8 is never longer than the escape it replaces
+      if(code < 0x80) {
+        *dst ++ = code;
+      } else if(code < 0x800) {
+        *dst ++ = 0xC0 | (code >> 6);
+        *dst ++ = 0x80 | (code & 0x3F);
+      } else if(code < 0x10000) {
+        *dst ++ = 0xE0 | (code >> 12);
+        *dst ++ = 0x80 | ((code >> 6) & 0x3F);
+        *dst ++ = 0x80 | (code & 0x3F);
+      } else {
+        *dst ++ = 0xF0 | (code >> 18);
+        *dst ++ = 0x80 | ((code >> 12) & 0x3F);
+        *dst ++ = 0x80 | ((code >> 6) & 0x3F);
+        *dst ++ = 0x80 | (code & 0x3F);
+      }
+      break;
+    }
+    default:
+      return -1;
+    }
+  }
+  return dst - str;
+}
+
+}
+
+/**
+ * @param backend stage 1 kernel, one the CPU does not support is replaced by the best supported one
+ */
+JsonIndex::JsonIndex(Backend backend)
+  : JsonValue(this, RootNode)
+  , m_backend(backend)
+  , m_text(nullptr)
+  , m_size(0)
+  , m_errorOffset(0)
+  , m_count(0)
+  , m_escapes(false)
+  , m_nodeCount(0)
+  , m_childCount(0)
+  , m_stackSize(0)
+{
+  Backend best = detectBackend();
+  if(m_backend == Backend::Auto || m_backend > best) {
+    m_backend = best;
+  }
+  clear();
+}
+
+JsonIndex::Backend JsonIndex::detectBackend()
+{
+#ifdef JSON_INDEX_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) {
+    return Backend::AVX2;
+  }
+  if(__builtin_cpu_supports("sse2")) {
+    return Backend::SSE2;
+  }
+#endif
+  return Backend::Scalar;
+}
+
+const char *JsonIndex::getBackendName(Backend backend)
+{
+  switch(backend) {
+  case Backend::Scalar: return "scalar";
+  case Backend::SSE2: return "sse2";
+  case Backend::AVX2: return "avx2";
+  default: return "auto";
+  }
+}
+
+// Root is null until a parse succeeds
+void JsonIndex::clear()
+{
+  if(m_nodes.size() < 2) {
+    m_nodes.resize(2);
+  }
+  m_nodes[0].type = Null;
+  m_nodes[0].size = 0;
+  m_nodes[1] = m_nodes[0];
+  m_nodeCount = 2;
+  m_childCount = 0;
+  m_stackSize = 0;
+}
+
+bool JsonIndex::fail(const char *p)
+{
+  m_errorOffset = p - m_text;
+  clear();
+  return false;
+}
+
+bool JsonIndex::deserialize_in_place(char *str)
+{
+  return deserialize_in_place(str, strlen(str));
+}
+
+/**
+ * Parses the text, the values then point into it
+ * @param str text, modified by the parser
+ * @param size text length, str[size] must be NUL
+ * @return false on malformed JSON, the document is null then
+ */
+bool JsonIndex::deserialize_in_place(char *str, size_t size)
+{
+  m_text = str;
+  m_size = size;
+  m_errorOffset = 0;
+  m_nodeCount = 1;
+  m_childCount = 0;
+  m_stackSize = 0;
+
+  if(size >= UINT32_MAX || !index(str, size)) {
+    return fail(str + size);
+  }
+
+  // Every value takes at least one token, so the buffers are sized once and written without checks
+  const size_t capacity = m_count + 2;
+  if(m_nodes.size() < capacity) {
+    m_nodes.resize(capacity);
+    m_children.resize(capacity);
+    m_stack.resize(capacity);
+  }
+  if(m_frames.size() < MaxDepth) {
+    m_frames.resize(MaxDepth);
+  }
+  return parse();
+}
+
+/**
+ * Stage 1: positions of tokens, that is structural characters outside of strings, unescaped quotes
+ * and the first characters of literals and numbers. Whitespace is never a token, so stage 2 does not
+ * look at the bytes between positions. A sentinel position pointing at the terminating NUL is appended.
+ */
+bool JsonIndex::index(const char *str, size_t size)
+{
+  ClassifyBlock classify = getKernel(m_backend);
+  // Flattening writes positions four at a time, so up to three past the last one
+  if(m_structurals.size() < size + 4) {
+    m_structurals.resize(size + 4);
+  }
+  uint32_t *out = m_structurals.data();
+  bool escapeCarry = false;
+  uint64_t inStringCarry = 0;
+  uint64_t scalarCarry = 0;
+  uint64_t backslashes = 0;
+
+  for(size_t offset = 0; offset < size; offset += 64) {
+    BlockMasks masks;
+    if(size - offset >= 64) {
+      classify(reinterpret_cast<const uint8_t*>(str + offset), masks);
+    } else {
+      uint8_t tail[64];
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, str + offset, size - offset);
+      classify(tail, masks);
+    }
+
+    backslashes |= masks.backslash;
+    const uint64_t quote = masks.quote & ~findEscaped(masks.backslash, escapeCarry);
+    const uint64_t inString = prefixXor(quote) ^ inStringCarry;
+    inStringCarry = (uint64_t)((int64_t)inString >> 63);
+    // Scalar bytes are neither whitespace, structural nor part of a string, tokens start where a run begins
+    const uint64_t scalar = ~(masks.op | masks.space | quote | inString);
+    const uint64_t scalarStart = scalar & ~((scalar << 1) | scalarCarry);
+    scalarCarry = scalar >> 63;
+    uint64_t structural = (masks.op & ~inString) | quote | scalarStart;
+
+    // Depth frames have a token every two or three bytes, an unrolled loop keeps the branch predictable
+    uint32_t *next = out + __builtin_popcountll(structural);
+    while(structural) {
+      out[0] = offset + __builtin_ctzll(structural);
+      structural &= structural - 1;
+      out[1] = offset + __builtin_ctzll(structural | (1ULL << 63));
+      structural &= structural - 1;
+      out[2] = offset + __builtin_ctzll(structural | (1ULL << 63));
+      structural &= structural - 1;
+      out[3] = offset + __builtin_ctzll(structural | (1ULL << 63));
+      structural &= structural - 1;
+      out += 4;
+    }
+    out = next;
+  }
+
+  // Unterminated string
+  if(inStringCarry) {
+    return false;
+  }
+  *out ++ = size;
+  m_count = out - m_structurals.data();
+  m_escapes = backslashes != 0;
+  return true;
+}
+
+/**
+ * Stage 2: walks the tokens with an explicit stack of open containers. Every value gets a node,
+ * whose index is pushed to m_stack; a closed container takes the indexes above its base as children.
+ */
+bool JsonIndex::parse()
+{
+  enum State { Value, Key, Next };
+
+  const uint32_t *tokens = m_structurals.data();
+  const size_t last = m_count - 1; // Sentinel
+  Frame *frames = m_frames.data();
+  size_t depth = 0;
+  size_t k = 0;
+  State state = Value;
+
+  for(;;) {
+    switch(state) {
+    case Value: {
+      if(k >= last) {
+        return fail(m_text + tokens[k]); // The input ended
+      }
+      const char c = m_text[tokens[k]];
+      const uint32_t node = m_nodeCount ++;
+      m_stack[m_stackSize ++] = node;
+
+      if(c == '"') {
+        if(!parseString(k, m_nodes[node])) {
+          return false;
+        }
+        k += 2;
+        state = Next;
+      } else if(c == '{' || c == '[') {
+        if(depth >= MaxDepth) {
+          return fail(m_text + tokens[k]);
+        }
+        Frame &frame = frames[depth ++];
+        frame.node = node;
+        frame.base = m_stackSize;
+        frame.close = c + 2; // '}' and ']' follow their openings two code points later
+        m_nodes[node].type = c == '{' ? Object : Array;
+        k ++;
+        state = c == '{' ? Key : Value;
+        if(m_text[tokens[k]] == frame.close) {
+          state = Next; // Empty, the closing token is handled below
+        }
+      } else {
+        if(!parseScalar(k, m_nodes[node])) {
+          return false;
+        }
+        k ++;
+        state = Next;
+      }
+      break;
+    }
+
+    case Key: {
+      if(m_text[tokens[k]] != '"') {
+        return fail(m_text + tokens[k]);
+      }
+      const uint32_t node = m_nodeCount ++;
+      m_stack[m_stackSize ++] = node;
+      if(!parseString(k, m_nodes[node])) {
+        return false;
+      }
+      k += 2;
+      if(m_text[tokens[k]] != ':') {
+        return fail(m_text + tokens[k]);
+      }
+      k ++;
+      state = Value;
+      break;
+    }
+
+    case Next: {
+      // Only whitespace may follow the root value, anything else would be a token before the sentinel
+      if(!depth) {
+        return k == last ? true : fail(m_text + tokens[k]);
+      }
+      Frame &frame = frames[depth - 1];
+      const char c = m_text[tokens[k]];
+      if(c == ',') {
+        k ++;
+        state = frame.close == '}' ? Key : Value;
+        break;
+      }
+      if(c != frame.close) {
+        return fail(m_text + tokens[k]);
+      }
+      k ++;
+
+      Node &container = m_nodes[frame.node];
+      const size_t count = m_stackSize - frame.base;
+      container.size = frame.close == '}' ? count / 2 : count;
+      container.first = m_childCount;
+      memcpy(&m_children[m_childCount], &m_stack[frame.base], count * sizeof(uint32_t));
+      m_childCount += count;
+      m_stackSize = frame.base;
+      depth --;
+      break;
+    }
+    }
+  }
+}
+
+// Literal or number starting at token k, running up to the next token minus the whitespace in between
+bool JsonIndex::parseScalar(size_t k, Node &value)
+{
+  const char *p = m_text + m_structurals[k];
+  const char *end = m_text + m_structurals[k + 1];
+  while(isSpace(end[-1])) {
+    end --;
+  }
+  const size_t size = end - p;
+
+  value.size = 0;
+  value.text = p;
+  if(size == 4 && !memcmp(p, "true", 4)) {
+    value.type = True;
+  } else if(size == 5 && !memcmp(p, "false", 5)) {
+    value.type = False;
+  } else if(size == 4 && !memcmp(p, "null", 4)) {
+    value.type = Null;
+  } else if(*p == '-' || (*p >= '0' && *p <= '9')) {
+    for(const char *c = p; c < end; c ++) {
+      if(!((*c >= '0' && *c <= '9') || *c == '-' || *c == '+' || *c == '.' || *c == 'e' || *c == 'E')) {
+        return fail(c);
+      }
+    }
+    value.type = Number;
+    value.size = size;
+  } else {
+    return fail(p);
+  }
+  return true;
+}
+
+// Opening quote at token k, the closing one is the next token
+bool JsonIndex::parseString(size_t k, Node &value)
+{
+  const uint32_t open = m_structurals[k], close = m_structurals[k + 1];
+  if(m_text[close] != '"') {
+    return fail(m_text + open);
+  }
+
+  char *str = m_text + open + 1;
+  long size = close - open - 1;
+  if(m_escapes && memchr(str, '\\', size)) {
+    size = unescape(str, size);
+    if(size < 0) {
+      return fail(str);
+    }
+  }
+  str[size] = '\0';
+
+  value.type = String;
+  value.size = size;
+  value.text = str;
+  return true;
+}
+
+JsonValue JsonValue::operator [](const char *key) const
+{
+  int index = find_key(key);
+  if(index < 0) {
+    return JsonValue(m_doc, 0);
+  }
+  return JsonValue(m_doc, m_doc->m_children[m_doc->m_nodes[m_node].first + 2 * index + 1]);
+}
+
+int JsonValue::find_key(const char *key) const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  if(node.type != JsonIndex::Object) {
+    return -1;
+  }
+  const uint32_t *members = m_doc->m_children.data() + node.first;
+  for(uint32_t i = 0; i < node.size; i ++) {
+    if(!strcmp(m_doc->m_nodes[members[2 * i]].text, key)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool JsonValue::has_key(const char *key) const
+{
+  return find_key(key) >= 0;
+}
+
+const char *JsonValue::get_key(size_t index) const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  if(node.type != JsonIndex::Object || index >= node.size) {
+    return "";
+  }
+  return m_doc->m_nodes[m_doc->m_children[node.first + 2 * index]].text;
+}
+
+const char *JsonValue::as_string_ptr(const char *key, const char *def) const
+{
+  JsonValue value = (*this)[key];
+  return value.is_string() || value.is_numeric() ? value.as_string_ptr() : def;
+}
+
+// Number text is followed by a separator, whitespace or NUL, where strtoll and strtod stop
+int64_t JsonValue::as_int64(int64_t def) const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  if(node.type == JsonIndex::Number) {
+    if(memchr(node.text, '.', node.size) || memchr(node.text, 'e', node.size) || memchr(node.text, 'E', node.size)) {
+      return (int64_t)strtod(node.text, nullptr);
+    }
+    return strtoll(node.text, nullptr, 10);
+  }
+  if(node.type == JsonIndex::True || node.type == JsonIndex::False) {
+    return node.type == JsonIndex::True;
+  }
+  return def;
+}
+
+double JsonValue::as_double(double def) const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  if(node.type == JsonIndex::Number) {
+    return strtod(node.text, nullptr);
+  }
+  if(node.type == JsonIndex::True || node.type == JsonIndex::False) {
+    return node.type == JsonIndex::True;
+  }
+  return def;
+}
+
+bool JsonValue::as_bool(bool def) const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  if(node.type == JsonIndex::True || node.type == JsonIndex::False) {
+    return node.type == JsonIndex::True;
+  }
+  if(node.type == JsonIndex::Number) {
+    return as_double() != 0;
+  }
+  return def;
+}
+
+}
@@ -0,0 +1,185 @@
+/***************************************************
+ * json_index.h
+ * Created on Mon, 19 Oct 2026 00:12:47 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace platform {
+
+class JsonIndex;
+
+/**
+ * Value of a JsonIndex document. Navigation mirrors pjson::value_variant (same method names),
+ * so parsing code templated on the value type works with both parsers.
+ * Missing keys and out of range indexes yield a null value instead of asserting.
+ * Valid while the document is not parsed again.
+ */
+class JsonValue {
+public:
+  JsonValue(const JsonIndex *doc, uint32_t node) : m_doc(doc), m_node(node) { }
+
+  bool is_null() const;
+  bool is_bool() const;
+  bool is_numeric() const;
+  bool is_string() const;
+  bool is_array() const;
+  bool is_object() const;
+
+  uint32_t size() const; //!< Number of elements or members, 0 for scalars
+  JsonValue operator [](size_t index) const; //!< Array element
+  JsonValue operator [](const char *key) const; //!< Object member
+  JsonValue operator [](int index) const { return (*this)[(size_t)index]; } //!< Array element
+  JsonValue operator [](unsigned int index) const { return (*this)[(size_t)index]; } //!< Array element
+  bool has_key(const char *key) const; //!< True if the object has the member
+  int find_key(const char *key) const; //!< Member index, -1 if missing
+  const char *get_key(size_t index) const; //!< Name of the member at the index
+
+  const char *as_string_ptr() const; //!< NUL terminated string or number text, "" for other types
+  const char *as_string_ptr(const char *key, const char *def = "") const; //!< String or number member, def if missing or another type
+  size_t get_string_size() const; //!< String length, number text length for numbers
+  int64_t as_int64(int64_t def = 0) const; //!< Integer value of a number
+  int32_t as_int32(int32_t def = 0) const { return (int32_t)as_int64(def); } //!< Integer value of a number
+  double as_double(double def = 0) const; //!< Value of a number
+  bool as_bool(bool def = false) const; //!< Value of a boolean
+
+protected:
+  const JsonIndex *m_doc;
+  uint32_t m_node;
+};
+
+/**
+ * JSON parser building a structural index with SIMD kernels, then a flat tape of values.
+ * Stage 1 classifies 64 byte blocks into bitmasks of quotes, backslashes, whitespace and structural characters,
+ * masks out everything inside strings and flattens the token starts into positions. Stage 2 walks the positions
+ * only, so whitespace and string contents are never visited byte by byte.
+ * Parses in place like pjson: strings are unescaped and NUL terminated inside the input, which must be NUL terminated.
+ * Buffers keep their capacity across parses. Not thread safe, one document per parsing thread.
+ */
+class JsonIndex
+  : public JsonValue {
+public:
+  //! Stage 1 kernel
+  enum class Backend {
+    Auto = 0, //!< Best one the CPU supports
+    Scalar,   //!< Portable 64 bit code
+    SSE2,     //!< 16 byte vectors
+    AVX2      //!< 32 byte vectors
+  };
+
+  JsonIndex(Backend backend = Backend::Auto);
+
+  bool deserialize_in_place(char *str); //!< Parses NUL terminated text, false on malformed JSON
+  bool deserialize_in_place(char *str, size_t size); //!< Parses text of the size, str[size] must be NUL
+
+  Backend getBackend() const { return m_backend; } //!< Kernel in use
+  size_t getErrorOffset() const { return m_errorOffset; } //!< Input offset of the parse error
+  size_t getStructurals() const { return m_count; } //!< Structural positions of the last parse
+  size_t getNodes() const { return m_nodeCount; } //!< Values of the last parse
+
+  static Backend detectBackend(); //!< Best kernel of this CPU
+  static const char *getBackendName(Backend backend);
+
+private:
+  friend class JsonValue;
+
+  enum Type : uint8_t {
+    Null = 0,
+    False,
+    True,
+    Number,
+    String,
+    Array,
+    Object
+  };
+
+  // Container being parsed
+  struct Frame {
+    uint32_t node;
+    uint32_t base; // m_stack size when the container opened
+    char close;    // Closing bracket
+  };
+
+  struct Node {
+    Type type;
+    uint32_t size;      // String or number text length, container element count
+    union {
+      const char *text; // Strings and numbers
+      uint32_t first;   // Containers, position of the first child in m_children
+    };
+  };
+
+  bool index(const char *str, size_t size);
+  bool parse();
+  bool parseScalar(size_t k, Node &value);
+  bool parseString(size_t k, Node &value);
+  bool fail(const char *p);
+  void clear();
+
+  JsonIndex(const JsonIndex &) = delete;
+  void operator =(const JsonIndex &) = delete;
+
+  Backend m_backend;
+  char *m_text;
+  size_t m_size;
+  size_t m_errorOffset;
+  size_t m_count;                      // Structural positions of the last parse
+  bool m_escapes;                      // Backslashes in the text, strings need unescaping
+  std::vector<uint32_t> m_structurals; // Token positions, then a sentinel; never shrinks
+  size_t m_nodeCount;
+  size_t m_childCount;
+  size_t m_stackSize;
+  std::vector<Node> m_nodes;           // Node 0 is the null value returned for missing members; never shrinks
+  std::vector<uint32_t> m_children;    // Children of each container, key and value node pairs for objects
+  std::vector<uint32_t> m_stack;       // Children of the containers being parsed
+  std::vector<Frame> m_frames;         // Open containers, MaxDepth entries
+};
+
+// Accessors used per price level are inline, like pjson's
+inline bool JsonValue::is_null() const { return m_doc->m_nodes[m_node].type == JsonIndex::Null; }
+inline bool JsonValue::is_bool() const { return m_doc->m_nodes[m_node].type == JsonIndex::True || m_doc->m_nodes[m_node].type == JsonIndex::False; }
+inline bool JsonValue::is_numeric() const { return m_doc->m_nodes[m_node].type == JsonIndex::Number; }
+inline bool JsonValue::is_string() const { return m_doc->m_nodes[m_node].type == JsonIndex::String; }
+inline bool JsonValue::is_array() const { return m_doc->m_nodes[m_node].type == JsonIndex::Array; }
+inline bool JsonValue::is_object() const { return m_doc->m_nodes[m_node].type == JsonIndex::Object; }
+
+inline uint32_t JsonValue::size() const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  return node.type == JsonIndex::Array || node.type == JsonIndex::Object ? node.size : 0;
+}
+
+inline JsonValue JsonValue::operator [](size_t index) const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  if(node.type != JsonIndex::Array || index >= node.size) {
+    return JsonValue(m_doc, 0);
+  }
+  return JsonValue(m_doc, m_doc->m_children[node.first + index]);
+}
+
+// Number text is terminated on access like pjson's get_parsed_string_ptr(), its separator is not needed after stage 2
+inline const char *JsonValue::as_string_ptr() const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  if(node.type == JsonIndex::Number) {
+    m_doc->m_text[node.text - m_doc->m_text + node.size] = '\0';
+    return node.text;
+  }
+  return node.type == JsonIndex::String ? node.text : "";
+}
+
+inline size_t JsonValue::get_string_size() const
+{
+  const JsonIndex::Node &node = m_doc->m_nodes[m_node];
+  return node.type == JsonIndex::String || node.type == JsonIndex::Number ? node.size : 0;
+}
+
+}
@@ -0,0 +1,161 @@
+/***************************************************
+ * json_pool.h
+ * Created on Sun, 18 Oct 2026 23:21:06 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <pjson.h>
+#include "json_index.h"
+
+namespace platform {
+
+// Free list of pjson documents shared by the threads parsing messages of one connector.
+// Documents keep their pool allocator chunks across messages (up to maxPreserved bytes each),
+// deserialize_in_place() resets the allocator, so steady state parsing does not allocate.
+// Every slot also carries a JsonIndex for connectors using the SIMD parser, its buffers are kept the same way.
+class JsonDocumentPool {
+  struct Slot {
+    Slot(size_t minChunkSize, size_t maxPreserved, JsonIndex::Backend backend)
+      : doc(0, minChunkSize)
+      , index(backend)
+      , allocated(0)
+    {
+      doc.get_allocator().set_max_bytes_to_preserve_across_resets(maxPreserved);
+    }
+    pjson::document doc;
+    JsonIndex index;
+    size_t allocated; // Chunk bytes owned after the previous use
+  };
+
+public:
+  //! Allocator counters for capacity tuning, see PJSON_DEFAULT_MIN_CHUNK_SIZE
+  struct Stats {
+    uint64_t parses = 0; //!< Documents returned to the pool
+    uint64_t grows = 0; //!< Parses that had to allocate new chunks
+    size_t documents = 0; //!< Documents created, the number of threads parsing at once
+    size_t allocated = 0; //!< Chunk bytes held by the idle documents
+    size_t maxUsed = 0; //!< Largest number of bytes a single parse used
+    size_t maxChunk = 0; //!< Largest chunk held by the idle documents
+  };
+
+  // Returns the document to the pool when going out of scope
+  class Lease {
+  public:
+    Lease(JsonDocumentPool *pool, Slot *slot) : m_pool(pool), m_slot(slot) { }
+    Lease(Lease &&other) : m_pool(other.m_pool), m_slot(other.m_slot) { other.m_slot = nullptr; }
+    ~Lease() {
+      if(m_slot) {
+        m_pool->release(m_slot);
+      }
+    }
+
+    pjson::document &operator *() { return m_slot->doc; }
+    pjson::document *operator ->() { return &m_slot->doc; }
+    JsonIndex &index() { return m_slot->index; }
+
+  private:
+    Lease(const Lease &) = delete;
+    void operator =(const Lease &) = delete;
+
+    JsonDocumentPool *m_pool;
+    Slot *m_slot;
+  };
+
+  JsonDocumentPool(size_t minChunkSize = PJSON_DEFAULT_MIN_CHUNK_SIZE, size_t maxPreserved = 1024 * 1024)
+    : m_lock(ATOMIC_FLAG_INIT)
+    , m_minChunkSize(minChunkSize)
+    , m_maxPreserved(maxPreserved)
+    , m_backend(JsonIndex::Backend::Auto)
+  { }
+
+  ~JsonDocumentPool() {
+    for(auto slot : m_free) {
+      delete slot;
+    }
+  }
+
+  Lease acquire() {
+    Slot *slot = nullptr;
+    lock();
+    if(!m_free.empty()) {
+      slot = m_free.back();
+      m_free.pop_back();
+    }
+    unlock();
+
+    if(!slot) {
+      slot = new Slot(m_minChunkSize, m_maxPreserved, m_backend);
+      lock();
+      m_stats.documents ++;
+      unlock();
+    }
+    return Lease(this, slot);
+  }
+
+  // Kernel of the JsonIndex documents created from now on
+  void setIndexBackend(JsonIndex::Backend backend) {
+    m_backend = backend;
+  }
+
+  // Chunk sizes of the idle documents, documents in use are not inspected
+  Stats getStats() {
+    lock();
+    Stats stats = m_stats;
+    for(auto slot : m_free) {
+      pjson::pool_allocator::stats_t allocator;
+      slot->doc.get_allocator().get_stats(allocator);
+      stats.allocated += allocator.m_total_allocated;
+      stats.maxChunk = std::max(stats.maxChunk, std::max(allocator.m_max_active_chunk_size, allocator.m_max_free_chunk_size));
+    }
+    unlock();
+    return stats;
+  }
+
+private:
+  // Chunks of the last parse are still active, so the allocator shows what it needed
+  void release(Slot *slot) {
+    pjson::pool_allocator::stats_t allocator;
+    slot->doc.get_allocator().get_stats(allocator);
+    bool grown = allocator.m_total_allocated > slot->allocated;
+    slot->allocated = allocator.m_total_allocated;
+
+    lock();
+    m_stats.parses ++;
+    if(grown) {
+      m_stats.grows ++;
+    }
+    m_stats.maxUsed = std::max(m_stats.maxUsed, allocator.m_num_active_bytes_allocated);
+    m_free.push_back(slot);
+    unlock();
+  }
+
+  inline void lock() noexcept {
+    while(__builtin_expect(m_lock.test_and_set(std::memory_order_acquire), 0)) {
+      std::this_thread::yield();
+    }
+  }
+
+  inline void unlock() noexcept {
+    m_lock.clear(std::memory_order_release);
+  }
+
+  JsonDocumentPool(const JsonDocumentPool &) = delete;
+  void operator =(const JsonDocumentPool &) = delete;
+
+  std::atomic_flag m_lock;
+  size_t m_minChunkSize;
+  size_t m_maxPreserved;
+  JsonIndex::Backend m_backend;
+  std::vector<Slot*> m_free;
+  Stats m_stats;
+};
+
+}
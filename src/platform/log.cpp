@@ -14,6 +14,7 @@
 #include <iomanip>
 #include <chrono>
 #include "log.h"
+#include "thread_topology.h"
 
 namespace platform {
 
@@ -52,6 +53,7 @@ void Logger::flushQueue() {
 }
 
 void Logger::run() {
+  ThreadTopology::Scope scope("log");
   m_running = true;
 
   while(m_running) {
@@ -0,0 +1,138 @@
+/***************************************************
+ * shm_market_data.cpp
+ * Created on Sun, 18 Oct 2026 20:31:52 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdexcept>
+#include <thread>
+#include "shm_market_data.h"
+
+namespace platform {
+
+// getTopOfBook() retries this many times before checking that the publisher is still alive
+static const unsigned TopOfBookSpins = 1024;
+
+/**
+ * Attaches to an existing segment read-only
+ * @param name POSIX shared memory object name, e.g. "/cryptoadapter-md"
+ */
+ShmMarketDataSubscriber::ShmMarketDataSubscriber(const std::string &name)
+  : m_name(name)
+  , m_map(NULL)
+  , m_mapSize(0)
+  , m_header(NULL)
+  , m_instruments(NULL)
+{
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if(fd < 0) {
+    throw std::runtime_error("Can not open market data segment " + name + ": " + strerror(errno));
+  }
+
+  struct stat st;
+  if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ShmMarketDataHeader)) {
+    close(fd);
+    throw std::runtime_error("Market data segment " + name + " is not initialized");
+  }
+
+  m_mapSize = st.st_size;
+  m_map = mmap(NULL, m_mapSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(m_map == MAP_FAILED) {
+    throw std::runtime_error("Can not map market data segment " + name + ": " + strerror(errno));
+  }
+
+  m_header = reinterpret_cast<const ShmMarketDataHeader*>(m_map);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(memcmp(m_header->magic, SHM_MARKET_DATA_MAGIC, sizeof(m_header->magic)) ||
+     m_header->version != SHM_MARKET_DATA_VERSION || m_header->segmentSize != m_mapSize) {
+    munmap(m_map, m_mapSize);
+    throw std::runtime_error("Invalid market data segment " + name);
+  }
+
+  const char *base = static_cast<const char*>(m_map);
+  m_instruments = reinterpret_cast<const ShmInstrumentSlot*>(base + m_header->instrumentsOffset);
+  // The view takes writable pointers for the producer side, the subscriber never publishes
+  ShmMarketDataHeader *header = const_cast<ShmMarketDataHeader*>(m_header);
+  try {
+    m_ring = ShmDeltaRing(reinterpret_cast<ShmDeltaSlot*>(const_cast<char*>(base) + m_header->ringOffset),
+                          m_header->ringCapacity, &header->published);
+  } catch(const std::invalid_argument &) {
+    munmap(m_map, m_mapSize);
+    throw std::runtime_error("Invalid market data segment " + name);
+  }
+}
+
+ShmMarketDataSubscriber::~ShmMarketDataSubscriber()
+{
+  munmap(m_map, m_mapSize);
+}
+
+/**
+ * Seqlock read, retries while the publisher is updating the slot. A publisher killed in the middle
+ * of an update leaves the sequence odd for good, so its liveness is checked every TopOfBookSpins retries.
+ * @return false if the instrument slot is not published, or the publisher died during an update
+ */
+bool ShmMarketDataSubscriber::getTopOfBook(uint32_t instrument, ShmTopOfBook &book) const
+{
+  if(instrument >= getInstrumentCount()) {
+    return false;
+  }
+
+  const ShmInstrumentSlot &slot = m_instruments[instrument];
+  uint64_t before, after;
+  for(unsigned spins = 1; ; spins ++) {
+    before = slot.sequence.load(std::memory_order_acquire);
+    if(!(before & 1)) {
+      memcpy(&book, &slot.book, sizeof(ShmTopOfBook));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = slot.sequence.load(std::memory_order_relaxed);
+      if(before == after) {
+        return true;
+      }
+    }
+    if(spins % TopOfBookSpins == 0) {
+      if(!isPublisherAlive()) {
+        return false;
+      }
+      std::this_thread::yield(); // The publisher was preempted in the middle of the update
+    }
+  }
+}
+
+int ShmMarketDataSubscriber::findInstrument(const char *name) const
+{
+  uint32_t count = getInstrumentCount();
+  for(uint32_t i = 0; i < count; i ++) {
+    if(!strncmp(m_instruments[i].name, name, SHM_MARKET_DATA_NAME_SIZE)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const char *ShmMarketDataSubscriber::getInstrumentName(uint32_t instrument) const
+{
+  return instrument < getInstrumentCount() ? m_instruments[instrument].name : "";
+}
+
+uint32_t ShmMarketDataSubscriber::getInstrumentCount() const
+{
+  return m_header->instrumentCount.load(std::memory_order_acquire);
+}
+
+bool ShmMarketDataSubscriber::isPublisherAlive() const
+{
+  return kill(m_header->publisherPid, 0) == 0 || errno == EPERM;
+}
+
+}
@@ -0,0 +1,140 @@
+/***************************************************
+ * shm_market_data.h
+ * Created on Sun, 18 Oct 2026 20:31:52 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include "broadcast_ring.h"
+
+#define SHM_MARKET_DATA_MAGIC "MDSHM01"
+#define SHM_MARKET_DATA_VERSION 1
+#define SHM_MARKET_DATA_SCALE 100000000LL
+#define SHM_MARKET_DATA_NAME_SIZE 32
+#define SHM_MARKET_DATA_ALL_INSTRUMENTS 0xffffffffU
+
+namespace platform {
+
+/**
+ * Shared memory segment layout, all offsets are from the start of the segment:
+ * header page, instrument table of maxInstruments slots, then the delta ring of ringCapacity slots.
+ * The layout is fixed for the lifetime of the segment, readers map it once.
+ */
+struct ShmMarketDataHeader {
+  char magic[8];              // Written last, readers reject the segment until it is set
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t segmentSize;
+  uint64_t instrumentsOffset;
+  uint64_t ringOffset;
+  uint64_t ringCapacity;      // Events, power of 2
+  uint32_t maxInstruments;
+  int32_t publisherPid;
+  std::atomic<uint32_t> instrumentCount; // Published instrument slots, names are immutable once counted
+  alignas(64) std::atomic<uint64_t> published; // Number of published deltas
+};
+
+//! Normalized orderbook delta. Prices and amounts are fixed point scaled by SHM_MARKET_DATA_SCALE.
+struct ShmDelta {
+  enum Type : uint8_t {
+    Level = 0, //!< Price level changed, zero amount removes the level
+    Clear      //!< Book of the instrument (or all books for SHM_MARKET_DATA_ALL_INSTRUMENTS) is invalid
+  };
+
+  enum Side : uint8_t {
+    Bid = 0, //!< Bid side
+    Ask      //!< Ask side
+  };
+
+  enum Flags : uint16_t {
+    BatchBegin = 1, //!< First delta of an update
+    BatchEnd = 2    //!< Last delta of an update, the book is consistent after applying it
+  };
+
+  uint32_t instrument; //!< Instrument slot
+  uint8_t type; //!< Delta type
+  uint8_t side; //!< Book side of a Level delta
+  uint16_t flags; //!< Batch flags
+  int64_t price; //!< Level price
+  int64_t amount; //!< Level amount
+  int64_t timestamp; //!< Entry timestamp as set by the connector
+  uint64_t tag; //!< Receive timestamp of the update, nanoseconds
+};
+
+//! Best bid and offer of an instrument, zero amount means the side is empty
+struct ShmTopOfBook {
+  int64_t bidPrice; //!< Best bid price
+  int64_t bidAmount; //!< Best bid amount
+  int64_t askPrice; //!< Best ask price
+  int64_t askAmount; //!< Best ask amount
+  int64_t timestamp; //!< Entry timestamp of the last change
+  uint64_t tag; //!< Receive timestamp of the last change, nanoseconds
+  uint64_t updates; //!< Number of changes since the instrument was added
+};
+
+// Instrument table entry, top of book is guarded by a seqlock (odd while written)
+struct alignas(64) ShmInstrumentSlot {
+  char name[SHM_MARKET_DATA_NAME_SIZE]; // "BASE/QUOTE"
+  std::atomic<uint64_t> sequence;
+  ShmTopOfBook book;
+};
+
+// Ring slot, stamped with sequence + 1 of the delta it holds (0 while written)
+typedef BroadcastSlot<ShmDelta> ShmDeltaSlot;
+typedef BroadcastRingView<ShmDelta> ShmDeltaRing;
+
+/**
+ * Reader of a market data segment created by fin::ShmPublisher in another process.
+ * Deltas are read through a BroadcastRingView over the segment ring: a reader lapped
+ * by the publisher gets Overrun, the cursor is moved to the oldest delta and the loss is counted,
+ * the book must then be rebuilt from the next Clear or kept from the top of book table.
+ * Top of book of any instrument may be read at any time without a cursor.
+ * The subscriber never writes to the segment, any number of processes may attach.
+ */
+class ShmMarketDataSubscriber {
+public:
+  typedef ShmDeltaRing::Cursor Cursor;
+
+  ShmMarketDataSubscriber(const std::string &name);
+  ~ShmMarketDataSubscriber();
+
+  Cursor subscribe() const { return m_ring.subscribe(); } //!< Cursor positioned at the next delta to be published
+  //! Copy the delta at the cursor, a delta overwritten during the copy is reported as Overrun
+  BroadcastReadResult read(Cursor &cursor, ShmDelta &delta) const { return m_ring.read(cursor, delta); }
+
+  //! Read up to max available deltas, stops at the first overrun. Returns number of deltas read.
+  template<typename Reader>
+  size_t poll(Cursor &cursor, Reader reader, size_t max = SIZE_MAX) const { return m_ring.poll(cursor, reader, max); }
+
+  bool getTopOfBook(uint32_t instrument, ShmTopOfBook &book) const; //!< Consistent copy of the instrument top of book, false if the publisher died mid-update
+  int findInstrument(const char *name) const; //!< Instrument slot by "BASE/QUOTE" name, -1 if not published
+  const char *getInstrumentName(uint32_t instrument) const; //!< Name of the instrument slot
+  uint32_t getInstrumentCount() const; //!< Number of published instruments
+
+  uint64_t getPublished() const { return m_ring.getPublished(); } //!< Number of published deltas
+  uint64_t getLag(const Cursor &cursor) const { return m_ring.getLag(cursor); } //!< Deltas waiting for the cursor
+  size_t getCapacity() const { return m_ring.getCapacity(); } //!< Ring capacity
+  bool isPublisherAlive() const; //!< False when the publishing process is gone
+
+  static double toDouble(int64_t value) { return (double)value / SHM_MARKET_DATA_SCALE; } //!< Convert fixed point value
+
+private:
+  ShmMarketDataSubscriber(const ShmMarketDataSubscriber &) = delete;
+  void operator =(const ShmMarketDataSubscriber &) = delete;
+
+  std::string m_name;
+  void *m_map;
+  size_t m_mapSize;
+  const ShmMarketDataHeader *m_header;
+  const ShmInstrumentSlot *m_instruments;
+  ShmDeltaRing m_ring; // Over the read-only mapping, only reads through it
+};
+
+}
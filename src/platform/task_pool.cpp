@@ -0,0 +1,164 @@
+/***************************************************
+ * task_pool.cpp
+ * Created on Sun, 18 Oct 2026 19:20:24 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#include <stdlib.h>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "task_pool.h"
+
+namespace platform {
+
+static const size_t Classes = 4; // 64, 128, 256 and 512 bytes with the header
+static const size_t Unpooled = Classes;
+
+namespace {
+
+struct Cache;
+
+// Precedes every block, the payload follows; a free block links through its header
+struct Header {
+  Cache *owner;    // nullptr for unpooled blocks
+  size_t sizeClass;
+  Header *next;    // Free lists only
+  size_t unused;   // Keeps the payload 16 byte aligned
+};
+
+struct Cache {
+  Header *local[Classes];                // Owner thread only
+  std::atomic<Header*> remote[Classes];  // Freed by other threads
+  Cache *nextFree;                       // Orphaned caches
+};
+
+std::mutex g_cachesLock;
+Cache *g_orphans = nullptr;  // Caches of finished threads
+std::atomic<unsigned long> g_allocated(0);
+
+inline size_t sizeClass(size_t size) {
+  size_t total = size + sizeof(Header);
+  for(size_t c = 0, block = 64; c < Classes; c ++, block <<= 1) {
+    if(total <= block) {
+      return c;
+    }
+  }
+  return Unpooled;
+}
+
+// Owns the thread's cache, hands it over to the next thread when the thread finishes
+struct ThreadCache {
+  Cache *cache = nullptr;
+  bool finished = false; // Destroyed, tasks freed or allocated later by thread_local or static destructors bypass the cache
+
+  Cache *get() {
+    if(!cache && !finished) {
+      std::lock_guard<std::mutex> lock(g_cachesLock);
+      if(g_orphans) {
+        cache = g_orphans;
+        g_orphans = cache->nextFree;
+      } else {
+        cache = new Cache();
+        for(size_t c = 0; c < Classes; c ++) {
+          cache->local[c] = nullptr;
+          cache->remote[c].store(nullptr, std::memory_order_relaxed);
+        }
+      }
+    }
+    return cache;
+  }
+
+  ~ThreadCache() {
+    if(cache) {
+      std::lock_guard<std::mutex> lock(g_cachesLock);
+      cache->nextFree = g_orphans;
+      g_orphans = cache;
+      // Another thread may adopt it now, late frees on this thread take the remote list
+      cache = nullptr;
+    }
+    finished = true;
+  }
+};
+
+}
+
+static thread_local ThreadCache t_cache;
+
+/**
+ * Block of at least size bytes, from the calling thread's free list when one is available
+ * @param size payload size
+ * @throw std::bad_alloc
+ */
+void *TaskPool::allocate(size_t size)
+{
+  const size_t c = sizeClass(size);
+  Cache *cache = c == Unpooled ? nullptr : t_cache.get();
+  Header *block;
+  if(!cache) {
+    block = (Header*)malloc(size + sizeof(Header));
+    if(!block) {
+      throw std::bad_alloc();
+    }
+    block->owner = nullptr;
+    block->sizeClass = Unpooled;
+    return block + 1;
+  }
+
+  block = cache->local[c];
+  if(!block) {
+    block = cache->remote[c].exchange(nullptr, std::memory_order_acquire);
+  }
+  if(block) {
+    cache->local[c] = block->next;
+    return block + 1;
+  }
+
+  block = (Header*)malloc((size_t)64 << c);
+  if(!block) {
+    throw std::bad_alloc();
+  }
+  g_allocated ++;
+  block->owner = cache;
+  block->sizeClass = c;
+  return block + 1;
+}
+
+/**
+ * Returns a block to the free list of the thread which allocated it
+ * @param ptr block from allocate(), may be nullptr
+ */
+void TaskPool::release(void *ptr) noexcept
+{
+  if(!ptr) {
+    return;
+  }
+  Header *block = (Header*)ptr - 1;
+  Cache *owner = block->owner;
+  if(!owner) {
+    free(block);
+    return;
+  }
+
+  const size_t c = block->sizeClass;
+  if(owner == t_cache.cache) {
+    block->next = owner->local[c];
+    owner->local[c] = block;
+    return;
+  }
+
+  // Only the owner takes the remote list and it takes all of it, so pushing has no ABA problem
+  Header *head = owner->remote[c].load(std::memory_order_relaxed);
+  do {
+    block->next = head;
+  } while(!owner->remote[c].compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+unsigned long TaskPool::getAllocated()
+{
+  return g_allocated;
+}
+
+}
@@ -0,0 +1,33 @@
+/***************************************************
+ * task_pool.h
+ * Created on Sun, 18 Oct 2026 19:20:24 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace platform {
+
+/**
+ * Memory for tasks handed between threads. Every thread allocates from its own cache of free lists,
+ * one per size class; a block freed by another thread is pushed to the owner's remote list with
+ * a CAS and taken back in one exchange when the owner's local list runs out, so neither side locks
+ * and blocks never go back to malloc. Caches of finished threads are adopted by new threads.
+ * Blocks larger than the biggest class are plain malloc.
+ */
+class TaskPool {
+public:
+  static void *allocate(size_t size);
+  static void release(void *ptr) noexcept;
+
+  static const size_t MaxPooledSize = 512 - 32; //!< Larger blocks are not pooled
+  static unsigned long getAllocated(); //!< Blocks taken from malloc, the pools never shrink
+};
+
+}
@@ -7,35 +7,344 @@
  * $Date$
  ***************************************************/
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdexcept>
 #include "task_queue.h"
+#include "thread_topology.h"
 
 namespace platform {
 
+static const unsigned long YieldsBeforePark = 100;
+static const long ParkTimeout = 100000000; // Nanoseconds, onIdle still runs while nothing is pushed
+
+TaskRing::TaskRing(size_t capacity)
+  : m_slots(nullptr)
+  , m_mask(capacity - 1)
+  , m_head(0)
+  , m_tail(0)
+{
+  if(!capacity || (capacity & m_mask)) {
+    throw std::invalid_argument("TaskRing capacity must be a power of 2");
+  }
+  void *memory;
+  if(posix_memalign(&memory, alignof(Slot), capacity * sizeof(Slot))) {
+    throw std::bad_alloc();
+  }
+  m_slots = static_cast<Slot*>(memory);
+  for(size_t i = 0; i < capacity; i ++) {
+    new (&m_slots[i]) Slot;
+    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    m_slots[i].invoke = nullptr;
+  }
+}
+
+// Callables left in the ring are destroyed by the owning TaskQueue first
+TaskRing::~TaskRing()
+{
+  for(size_t i = 0; i <= m_mask; i ++) {
+    m_slots[i].~Slot();
+  }
+  free(m_slots);
+}
+
+void TaskRing::runTask(Task *task, TaskQueue *queue) noexcept {
+  if(queue) {
+    queue->processAndDelete(task);
+  } else {
+    delete task;
+  }
+}
+
 TaskQueue::TaskQueue()
-  : m_lock(ATOMIC_FLAG_INIT)
+  : m_policy(QueueFullPolicy::Grow)
+  , m_overflowing(false)
+  , m_dropped(0)
+  , m_overflowed(0)
+  , m_wait(QueueWait::Yield)
+  , m_spins(0)
+  , m_parked(0)
+  , m_wakeups(0)
+  , m_laneDrain(LaneDrain::Strict)
+  , m_pendingPos(0)
+  , m_lock(ATOMIC_FLAG_INIT)
   , m_hasData(false)
+  , m_name("queue")
   , m_running(false)
   , m_maxSize(0)
 {
   m_queue.reserve(200);
 }
 
+/**
+ * Queue backed by a bounded lock-free ring, push takes no lock unless the ring is full
+ * @param capacity ring size in tasks, rounded up to a power of 2; 0 for the spinlock queue
+ * @param policy what push does when the ring is full
+ */
+TaskQueue::TaskQueue(size_t capacity, QueueFullPolicy policy)
+  : TaskQueue()
+{
+  m_policy = policy;
+  if(capacity) {
+    size_t size = 2;
+    while(size < capacity) {
+      size <<= 1;
+    }
+    m_ring.reset(new TaskRing(size));
+  }
+}
+
 TaskQueue::~TaskQueue() {
   stop();
+  if(m_ring) {
+    while(m_ring->runNext(nullptr)) { }
+  }
   for(auto task : m_queue) {
     delete task;
   }
   m_queue.resize(0);
+  for(size_t i = m_pendingPos; i < m_pending.size(); i ++) {
+    delete m_pending[i];
+  }
 }
 
 void TaskQueue::stop() {
   m_running = false;
+  for(auto &lane : m_lanes) {
+    lane->queue->m_running = false;
+  }
+  wake();
+}
+
+TaskQueue::Lane::Lane(size_t capacity, QueueFullPolicy policy, unsigned weight)
+  : queue(new TaskQueue(capacity, policy))
+  , weight(weight ? weight : 1)
+  , pushed(0)
+  , tasks(0)
+  , maxDepth(0)
+  , waitTotal(0)
+  , maxWait(0)
+{ }
+
+/**
+ * Splits the queue into priority lanes, call before run(). Each lane is a queue of the same kind,
+ * push(task, lane) and post(function, lane) pick the lane, push(task) and post(function) use the lowest one.
+ * @param weights one per lane, lane 0 first; tasks run per round with LaneDrain::Weighted
+ * @param drain how lanes share the thread
+ */
+void TaskQueue::setLanes(const std::vector<unsigned> &weights, LaneDrain drain) {
+  m_lanes.clear();
+  for(unsigned weight : weights) {
+    m_lanes.emplace_back(new Lane(m_ring ? m_ring->capacity() : 0, m_policy, weight));
+  }
+  m_laneDrain = drain;
+}
+
+std::vector<TaskQueue::LaneStats> TaskQueue::getLaneStats() const {
+  std::vector<LaneStats> stats;
+  for(const auto &lane : m_lanes) {
+    const unsigned long tasks = lane->tasks;
+    stats.push_back(LaneStats{ lane->waiting(tasks), lane->maxDepth, tasks,
+                               tasks ? lane->waitTotal / tasks : 0, lane->maxWait });
+  }
+  return stats;
+}
+
+unsigned long TaskQueue::getDropped() const {
+  unsigned long dropped = m_dropped;
+  for(const auto &lane : m_lanes) {
+    dropped += lane->queue->m_dropped;
+  }
+  return dropped;
+}
+
+unsigned long TaskQueue::getOverflowed() const {
+  unsigned long overflowed = m_overflowed;
+  for(const auto &lane : m_lanes) {
+    overflowed += lane->queue->m_overflowed;
+  }
+  return overflowed;
+}
+
+/**
+ * Sets how run() waits while the queue is empty, call before run()
+ * @param wait busy spin, yield or park on a futex
+ * @param spins empty checks spun before yielding, Yield then parks after 100 more with Park
+ */
+void TaskQueue::setWait(QueueWait wait, unsigned long spins) {
+  m_wait = wait;
+  m_spins = spins;
+}
+
+// Called with the number of empty checks since the last task
+inline void TaskQueue::wait(unsigned long idle) noexcept {
+  if(m_wait == QueueWait::BusySpin || idle < m_spins) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+    return;
+  }
+  if(m_wait == QueueWait::Yield || idle < m_spins + YieldsBeforePark) {
+    sched_yield();
+    return;
+  }
+  park();
+}
+
+// Sleeps until a producer or stop() wakes the queue, or the timeout expires
+void TaskQueue::park() noexcept {
+  m_parked.store(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if(empty() && m_running) {
+    struct timespec timeout = { 0, ParkTimeout };
+    syscall(SYS_futex, &m_parked, FUTEX_WAIT_PRIVATE, 1, &timeout, nullptr, 0);
+  }
+  m_parked.store(0, std::memory_order_relaxed);
+}
+
+void TaskQueue::wake() noexcept {
+  if(m_parked.exchange(0)) {
+    m_wakeups ++;
+    syscall(SYS_futex, &m_parked, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+  }
 }
 
 //void TaskQueue::preProcess(Task *task) { }
 void TaskQueue::onIdle() { }
 
+// Ring is full, or tasks wait in the overflow list and must not be overtaken
+void TaskQueue::pushFull(Task *task) noexcept {
+  if(!m_overflowing.load(std::memory_order_acquire)) {
+    if(m_policy == QueueFullPolicy::Drop) {
+      m_dropped ++;
+      delete task;
+      return;
+    }
+    // The consumer cannot wait for itself, nor can anyone wait for a consumer which is not running
+    if(m_policy == QueueFullPolicy::Block && pthread_self() != m_runThread) {
+      while(m_running) {
+        if(m_ring->tryPush(task)) {
+          return;
+        }
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  SafeLock lock(*this);
+  m_queue.emplace_back(task);
+  m_overflowing.store(true, std::memory_order_release);
+  m_overflowed ++;
+}
+
+/**
+ * Runs the tasks of the ring, then the overflow list once the ring is empty
+ * @param localQueue buffer the overflow list is swapped with
+ * @return true if any task was run
+ */
+bool TaskQueue::drainRing(std::vector<Task*> &localQueue) noexcept {
+  bool ran = false;
+  while(m_ring->runNext(this)) {
+    ran = true;
+  }
+
+  // Tasks in the ring were pushed before the overflowed ones of the same producer
+  if(m_overflowing.load(std::memory_order_acquire) && m_ring->empty()) {
+    {
+    SafeLock lock(*this);
+    m_queue.swap(localQueue);
+    m_overflowing.store(false, std::memory_order_release);
+    }
+
+    for(auto task : localQueue) {
+      processAndDelete(task);
+    }
+    localQueue.resize(0);
+    ran = true;
+  }
+  return ran;
+}
+
+/**
+ * Runs the next task of a lane, in push order also across the ring and its overflow list
+ * @param queue passed to the task, the queue owning the lane
+ * @return false if the lane is empty
+ */
+bool TaskQueue::runOne(TaskQueue *queue) noexcept {
+  if(m_pendingPos == m_pending.size()) {
+    m_pending.resize(0);
+    m_pendingPos = 0;
+    if(m_ring) {
+      if(m_ring->runNext(queue)) {
+        return true;
+      }
+      if(!m_overflowing.load(std::memory_order_acquire) || !m_ring->empty()) {
+        return false;
+      }
+      SafeLock lock(*this);
+      m_queue.swap(m_pending);
+      m_overflowing.store(false, std::memory_order_release);
+    } else {
+      if(!m_hasData.exchange(false)) {
+        return false;
+      }
+      SafeLock lock(*this);
+      m_queue.swap(m_pending);
+    }
+    if(m_pending.empty()) {
+      return false;
+    }
+  }
+
+  Task *task = m_pending[m_pendingPos ++];
+  task->run(queue);
+  delete task;
+  return true;
+}
+
+// Runs tasks of the lanes until all are empty
+bool TaskQueue::drainLanes() noexcept {
+  bool ran = false;
+  if(m_laneDrain == LaneDrain::Strict) {
+    // Back to the highest lane after every task
+    for(size_t i = 0; i < m_lanes.size(); ) {
+      if(m_lanes[i]->queue->runOne(this)) {
+        ran = true;
+        i = 0;
+      } else {
+        i ++;
+      }
+    }
+    return ran;
+  }
+
+  bool progress;
+  do {
+    progress = false;
+    for(auto &lane : m_lanes) {
+      for(unsigned n = 0; n < lane->weight && lane->queue->runOne(this); n ++) {
+        progress = true;
+      }
+    }
+    ran |= progress;
+  } while(progress);
+  return ran;
+}
+
 void TaskQueue::flushQueue() noexcept {
+  if(!m_lanes.empty()) {
+    while(drainLanes()) { }
+  }
+
+  if(m_ring) {
+    std::vector<Task*> localQueue;
+    while(drainRing(localQueue)) { }
+    return;
+  }
+
   lock();
   for(auto task : m_queue) {
     processAndDelete(task);
@@ -45,14 +354,31 @@ void TaskQueue::flushQueue() noexcept {
 }
 
 void TaskQueue::run() noexcept {
+  ThreadTopology::Scope scope(m_name);
   m_runThread = pthread_self();
+  for(auto &lane : m_lanes) {
+    lane->queue->m_runThread = m_runThread;
+    lane->queue->m_running = true;
+  }
   m_running = true;
   std::vector<Task*> localQueue;
   localQueue.reserve(200);
+  unsigned long idle = 0;
 
   while(m_running) {
+    bool ran = false;
+    if(!m_lanes.empty()) {
+      ran = drainLanes();
+    }
+    if(m_ring) {
+      while(drainRing(localQueue)) {
+        ran = true;
+      }
+    }
+
     while(m_hasData.exchange(false)) {
       //m_hasData = false;
+      ran = true;
       {
       SafeLock lock(*this);
       m_queue.swap(localQueue);
@@ -65,8 +391,11 @@ void TaskQueue::run() noexcept {
     }
     onIdle();
     // Induce the context switch so it less likely happen when we process the queue
-    if(!m_hasData)
-      sched_yield();
+    if(ran || !empty()) {
+      idle = 0;
+    } else {
+      wait(idle ++);
+    }
   }
 }
 
@@ -9,9 +9,19 @@
 #pragma once
 
 #include <pthread.h>
+#include <stdint.h>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
 #include <thread>
 #include <queue>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "task_pool.h"
 
 #define WAIT_LOOP_DURATION  0xffffff
 
@@ -25,11 +35,160 @@ public:
   virtual void run(TaskQueue*) = 0;
 };
 
-// Implemented as spinlock queue
+// Task allocated from TaskPool: new and delete on different threads take no malloc lock
+class PooledTask
+  : public Task
+{
+public:
+  static void *operator new(size_t size) { return TaskPool::allocate(size); }
+  static void operator delete(void *ptr) noexcept { TaskPool::release(ptr); }
+};
+
+// Callable taking the TaskQueue* as a pooled task, for callables which do not fit a ring slot
+template<typename Function>
+class FunctionTask
+  : public PooledTask
+{
+public:
+  template<typename F>
+  FunctionTask(F &&function) : m_function(std::forward<F>(function)) { }
+  virtual void run(TaskQueue *queue) override { m_function(queue); }
+
+private:
+  Function m_function;
+};
+
+// What push does when the ring of a bounded queue is full
+enum class QueueFullPolicy {
+  Block, // Producer yields until the consumer makes room; tasks pushed by the consumer itself overflow
+  Drop,  // Task is deleted without running and counted by getDropped()
+  Grow   // Task is appended to the overflow list, which is drained once the ring is empty
+};
+
+// How TaskQueue::run waits for tasks when the queue is empty
+enum class QueueWait {
+  BusySpin, // Never gives the CPU up, lowest wake-up latency
+  Yield,    // Spins, then yields the CPU on every check
+  Park      // Spins, yields, then sleeps on a futex until a producer wakes it
+};
+
+// How TaskQueue::run shares its thread between priority lanes
+enum class LaneDrain {
+  Strict,  // A task of a lane runs only when all higher lanes are empty, lower lanes may starve
+  Weighted // Rounds over the lanes, highest first, running up to the lane's weight tasks from each
+};
+
+/**
+ * Bounded multiple producer, single consumer ring of tasks.
+ * Producers claim a position with a CAS on the head, each slot carries the sequence
+ * it expects next, so producers never wait for each other and the consumer takes no lock.
+ * Callables up to InlineSize bytes are constructed in the slot itself and run there,
+ * a Task* takes a slot as a callable holding the pointer.
+ * Slots are cache line aligned, head and tail are padded to their own cache lines.
+ */
+class TaskRing {
+public:
+  static const size_t InlineSize = 48; //!< Slots are 64 bytes
+
+  explicit TaskRing(size_t capacity);
+  ~TaskRing();
+
+  template<typename Callable>
+  static constexpr bool fits() {
+    return sizeof(Callable) <= InlineSize && alignof(Callable) <= alignof(void*);
+  }
+
+  //! Any thread, false if the ring is full; the task is untouched then
+  inline bool tryPush(Task *task) noexcept {
+    return tryEmplace([task](TaskQueue *queue) { runTask(task, queue); });
+  }
+
+  //! Any thread, constructs the callable in the next slot; false if the ring is full, the callable is untouched then
+  template<typename Function>
+  inline bool tryEmplace(Function &&function) noexcept {
+    typedef typename std::decay<Function>::type Callable;
+    static_assert(fits<Callable>(), "callable does not fit a ring slot");
+
+    size_t pos = m_head.load(std::memory_order_relaxed);
+    for(;;) {
+      Slot &slot = m_slots[pos & m_mask];
+      intptr_t diff = (intptr_t)slot.sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+      if(!diff) {
+        if(m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          new (slot.storage) Callable(std::forward<Function>(function));
+          slot.invoke = &invoke<Callable>;
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if(diff < 0) {
+        return false;
+      } else {
+        pos = m_head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  //! Consumer only, runs the next task in its slot and frees the slot; false if it is not published yet.
+  //! With a nullptr queue the task is destroyed without running.
+  inline bool runNext(TaskQueue *queue) noexcept {
+    const size_t pos = m_tail.load(std::memory_order_relaxed);
+    Slot &slot = m_slots[pos & m_mask];
+    if(slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+      return false;
+    }
+    slot.invoke(slot.storage, queue);
+    slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+    m_tail.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  //! True when every claimed slot has been consumed
+  inline bool empty() const noexcept {
+    return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return m_mask + 1; }
+
+private:
+  static const size_t CacheLine = 64;
+
+  // Aligned to a cache line, so producers filling adjacent slots and the consumer do not share lines
+  struct alignas(CacheLine) Slot {
+    std::atomic<size_t> sequence; // Position + 1 when published, position + capacity when free
+    void (*invoke)(void *storage, TaskQueue *queue); // Runs unless queue is nullptr, then destroys the callable
+    alignas(void*) unsigned char storage[InlineSize];
+  };
+
+  template<typename Callable>
+  static void invoke(void *storage, TaskQueue *queue) noexcept {
+    Callable &callable = *reinterpret_cast<Callable*>(storage);
+    if(queue) {
+      callable(queue);
+    }
+    callable.~Callable();
+  }
+
+  static void runTask(Task *task, TaskQueue *queue) noexcept;
+
+  TaskRing(const TaskRing &) = delete;
+  void operator =(const TaskRing &) = delete;
+
+  // Head and tail are padded rather than aligned, queues are allocated with plain new
+  Slot *m_slots; // posix_memalign, operator new does not honour the alignment before C++17
+  const size_t m_mask;
+  char m_padHead[CacheLine];
+  std::atomic<size_t> m_head; // Next position to claim, producers
+  char m_padTail[CacheLine - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_tail; // Next position to consume, consumer
+  char m_padEnd[CacheLine - sizeof(std::atomic<size_t>)];
+};
+
+// Implemented as spinlock queue, or as a lock-free ring when constructed with a capacity
 // May consume CPU a lot, but has low latency
 class TaskQueue {
 public:
   TaskQueue();
+  TaskQueue(size_t capacity, QueueFullPolicy policy); // Ring of capacity rounded up to a power of 2, 0 for the spinlock queue
   virtual ~TaskQueue();
 
   virtual void onIdle();
@@ -37,6 +196,9 @@ public:
   void run() noexcept;
   void stop();
   void flushQueue() noexcept;
+  void setWait(QueueWait wait, unsigned long spins = 0); //!< Before run(); empty checks spun before yielding
+  void setLanes(const std::vector<unsigned> &weights, LaneDrain drain = LaneDrain::Strict); //!< Before run(); lane 0 is the highest priority
+  void setName(const std::string &name) { m_name = name; } //!< Before run(); ThreadTopology name of the run() thread
 
   inline void processAndDelete(Task *task) noexcept {
     task->run(this);
@@ -46,16 +208,75 @@ public:
   inline void push(Task *task) noexcept {
     if(!task) return;
 
-    if(pthread_self() == m_runThread) {
-      m_queue.emplace_back(task);
+    if(__builtin_expect(!m_lanes.empty(), 0)) {
+      push(task, m_lanes.size() - 1);
+      return;
+    }
+
+    if(m_ring) {
+      if(__builtin_expect(m_overflowing.load(std::memory_order_relaxed) || !m_ring->tryPush(task), 0)) {
+        pushFull(task);
+      }
     } else {
-      SafeLock lock(*this);
-      m_queue.emplace_back(task);
+      if(pthread_self() == m_runThread) {
+        m_queue.emplace_back(task);
+      } else {
+        SafeLock lock(*this);
+        m_queue.emplace_back(task);
+      }
+      m_hasData = true;
+    }
+    notify();
+  }
+
+  /**
+   * Queues a callable taking the TaskQueue*. In the ring it is constructed in the slot when it fits
+   * TaskRing::InlineSize, otherwise, and in the spinlock queue, it is wrapped in a pooled FunctionTask;
+   * either way no malloc is involved once the pools are warm. With lanes it goes to the lowest lane.
+   */
+  template<typename Function>
+  inline void post(Function &&function) {
+    if(__builtin_expect(!m_lanes.empty(), 0)) {
+      post(std::forward<Function>(function), m_lanes.size() - 1);
+      return;
+    }
+    postQueue(std::forward<Function>(function));
+  }
+
+  //! Queues the task to a priority lane, the lowest one if the lane does not exist
+  inline void push(Task *task, size_t lane) {
+    if(task) {
+      post(OwnedTask(task), lane);
+    }
+  }
+
+  //! Queues the callable to a priority lane, the lowest one if the lane does not exist
+  template<typename Function>
+  inline void post(Function &&function, size_t lane) {
+    typedef typename std::decay<Function>::type Callable;
+    if(m_lanes.empty()) {
+      postQueue(std::forward<Function>(function));
+      return;
     }
-    m_hasData = true;
+    Lane &target = *m_lanes[std::min(lane, m_lanes.size() - 1)];
+    target.pushed.fetch_add(1, std::memory_order_relaxed);
+    target.queue->postQueue(LaneCall<Callable>{ std::forward<Function>(function), &target, Lane::now() });
+    notify();
   }
 
+  struct LaneStats {
+    unsigned long depth;    // Tasks pushed and neither run nor dropped yet
+    unsigned long maxDepth; // Largest depth seen when a task ran
+    unsigned long tasks;    // Tasks run
+    unsigned long meanWait; // Nanoseconds between push and run
+    unsigned long maxWait;
+  };
+  std::vector<LaneStats> getLaneStats() const;
+
   long getMaxSize() { return m_maxSize; }
+  unsigned long getDropped() const; //!< Tasks dropped by QueueFullPolicy::Drop, lanes included
+  unsigned long getOverflowed() const; //!< Tasks that went to the overflow list, lanes included
+  unsigned long getWakeups() { return m_wakeups; } //!< Times a producer woke the parked consumer
   inline void lock() noexcept {
     int waitCycle = 0;
     while(__builtin_expect(m_lock.test_and_set(std::memory_order_acquire), 0)) {
@@ -70,6 +291,16 @@ public:
   }
 
   inline bool empty() noexcept {
+    if(!m_lanes.empty()) {
+      for(const auto &lane : m_lanes) {
+        if(!lane->queue->empty()) {
+          return false;
+        }
+      }
+    }
+    if(m_ring) {
+      return m_ring->empty() && !m_overflowing.load(std::memory_order_acquire);
+    }
     return !m_hasData;
   }
 
@@ -94,9 +325,135 @@ private:
     }
   };
 
-  std::vector<Task*> m_queue;
+  // Lane of the queue: a queue of its own, never run but drained by the owning queue's thread
+  struct Lane {
+    Lane(size_t capacity, QueueFullPolicy policy, unsigned weight);
+
+    static long now() noexcept {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Consumer only
+    inline void ran(long pushedAt) noexcept {
+      const unsigned long wait = now() - pushedAt;
+      const unsigned long count = tasks.load(std::memory_order_relaxed) + 1;
+      tasks.store(count, std::memory_order_relaxed);
+      waitTotal.store(waitTotal.load(std::memory_order_relaxed) + wait, std::memory_order_relaxed);
+      if(wait > maxWait.load(std::memory_order_relaxed)) {
+        maxWait.store(wait, std::memory_order_relaxed);
+      }
+      const unsigned long depth = waiting(count - 1); // This task included
+      if(depth > maxDepth.load(std::memory_order_relaxed)) {
+        maxDepth.store(depth, std::memory_order_relaxed);
+      }
+    }
+
+    // Tasks pushed and neither run nor dropped by the lane queue; pushed is counted before the queue may drop
+    inline unsigned long waiting(unsigned long ran) const noexcept {
+      const unsigned long done = ran + queue->m_dropped.load(std::memory_order_relaxed);
+      const unsigned long count = pushed.load(std::memory_order_relaxed);
+      return count > done ? count - done : 0;
+    }
+
+    std::unique_ptr<TaskQueue> queue;
+    const unsigned weight;
+    std::atomic<unsigned long> pushed; // Producers
+    std::atomic<unsigned long> tasks;  // Consumer, as the rest
+    std::atomic<unsigned long> maxDepth;
+    std::atomic<unsigned long> waitTotal;
+    std::atomic<unsigned long> maxWait;
+  };
+
+  // Callable queued to a lane with its push time
+  template<typename Function>
+  struct LaneCall {
+    Function function;
+    Lane *lane;
+    long pushedAt;
+
+    void operator ()(TaskQueue *queue) {
+      lane->ran(pushedAt);
+      function(queue);
+    }
+  };
+
+  // Task pointer as a callable, deleted if it never runs
+  class OwnedTask {
+  public:
+    OwnedTask(Task *task) : m_task(task) { }
+    OwnedTask(OwnedTask &&other) : m_task(other.m_task) { other.m_task = nullptr; }
+    ~OwnedTask() { delete m_task; }
+
+    void operator ()(TaskQueue *queue) {
+      Task *task = m_task;
+      m_task = nullptr;
+      task->run(queue);
+      delete task;
+    }
+
+  private:
+    OwnedTask(const OwnedTask &) = delete;
+    void operator =(const OwnedTask &) = delete;
+
+    Task *m_task;
+  };
+
+  // post() to the ring or the spinlock queue, lanes aside
+  template<typename Function>
+  inline void postQueue(Function &&function) {
+    typedef typename std::decay<Function>::type Callable;
+    if(postInline(std::forward<Function>(function), std::integral_constant<bool, TaskRing::fits<Callable>()>())) {
+      notify();
+      return;
+    }
+    push(new FunctionTask<Callable>(std::forward<Function>(function)));
+  }
+
+  template<typename Function>
+  inline bool postInline(Function &&function, std::true_type) noexcept {
+    return m_ring && !m_overflowing.load(std::memory_order_relaxed) && m_ring->tryEmplace(std::forward<Function>(function));
+  }
+
+  template<typename Function>
+  inline bool postInline(Function &&, std::false_type) noexcept {
+    return false;
+  }
+
+  // The task is visible before the parked flag is read, the consumer sets the flag before its last check
+  inline void notify() noexcept {
+    if(m_wait == QueueWait::Park) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(__builtin_expect(m_parked.load(std::memory_order_relaxed), 0)) {
+        wake();
+      }
+    }
+  }
+
+  void pushFull(Task *task) noexcept;
+  bool drainRing(std::vector<Task*> &localQueue) noexcept;
+  bool runOne(TaskQueue *queue) noexcept;
+  bool drainLanes() noexcept;
+  void wait(unsigned long idle) noexcept;
+  void park() noexcept;
+  void wake() noexcept;
+
+  std::vector<Task*> m_queue; // Overflow list when the ring is used
+  std::unique_ptr<TaskRing> m_ring;
+  QueueFullPolicy m_policy;
+  std::atomic<bool> m_overflowing; // m_queue has tasks, producers append there to keep their order
+  std::atomic<unsigned long> m_dropped;
+  std::atomic<unsigned long> m_overflowed;
+  QueueWait m_wait;
+  unsigned long m_spins;
+  std::atomic<int> m_parked; // Futex word, 1 while the consumer sleeps or is about to
+  std::atomic<unsigned long> m_wakeups;
+  std::vector<std::unique_ptr<Lane>> m_lanes;
+  LaneDrain m_laneDrain;
+  std::vector<Task*> m_pending; // Lanes: tasks taken from the spinlock queue or overflow list, run one by one
+  size_t m_pendingPos;
   std::atomic_flag m_lock;
   std::atomic<bool> m_hasData;
+  std::string m_name;
   pthread_t m_runThread;
   std::atomic<bool> m_running;
   long m_maxSize;
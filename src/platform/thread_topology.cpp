@@ -0,0 +1,263 @@
+/***************************************************
+ * thread_topology.cpp
+ * Created on Sun, 18 Oct 2026 19:34:55 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <sstream>
+#include <stdexcept>
+#include <pjson.h>
+#include "log.h"
+#include "thread_topology.h"
+
+namespace platform {
+
+static const size_t MaxThreadName = 15; // Without the terminating NUL, pthread_setname_np limit
+
+ThreadTopology::ThreadTopology()
+  : m_memoryLocked(false)
+{ }
+
+ThreadTopology &ThreadTopology::instance()
+{
+  static ThreadTopology topology;
+  return topology;
+}
+
+/**
+ * Registers the calling thread, names it and applies the first matching rule
+ * @param name thread name, the OS name is cut to 15 characters
+ */
+ThreadTopology::Scope::Scope(const std::string &name)
+{
+  ThreadTopology &topology = instance();
+  std::lock_guard<std::mutex> lock(topology.m_lock);
+  topology.m_threads.push_back(Thread{ name, pthread_self(), (pid_t)syscall(SYS_gettid), std::string() });
+  pthread_setname_np(pthread_self(), name.substr(0, MaxThreadName).c_str());
+  topology.apply(topology.m_threads.back());
+}
+
+ThreadTopology::Scope::~Scope()
+{
+  ThreadTopology &topology = instance();
+  std::lock_guard<std::mutex> lock(topology.m_lock);
+  const pthread_t self = pthread_self();
+  for(auto i = topology.m_threads.begin(); i != topology.m_threads.end(); ++ i) {
+    if(pthread_equal(i->handle, self)) {
+      topology.m_threads.erase(i);
+      break;
+    }
+  }
+}
+
+/**
+ * Reads the rules and memory locking from a config document, unknown keys are ignored
+ * @param json {"threads": [{"name": "parse-*", "cpus": "2-3", "priority": 50}], "mlock": true}
+ * @throw std::invalid_argument if a CPU set cannot be parsed
+ */
+void ThreadTopology::configure(const std::string &json)
+{
+  using namespace pjson;
+  std::string copy(json);
+  document doc;
+  doc.deserialize_in_place(&copy[0]);
+
+  if(doc.has_key("threads")) {
+    const auto &threads = doc["threads"];
+    for(unsigned int i = 0; i < threads.size(); i ++) {
+      const auto &thread = threads[i];
+      addRule(thread["name"].as_string_ptr(),
+              thread.has_key("cpus") ? thread["cpus"].as_string_ptr() : "",
+              thread.has_key("priority") ? thread["priority"].as_int64() : 0);
+    }
+  }
+
+  if(doc.has_key("mlock") && doc["mlock"].as_bool()) {
+    lockMemory();
+  }
+}
+
+/**
+ * Adds a rule after the existing ones and applies the rules to the running threads
+ * @param pattern thread name, or prefix followed by '*'
+ * @param cpus CPU set as "0-3,6", empty to keep the affinity
+ * @param priority SCHED_FIFO priority, 0 for the default policy
+ * @throw std::invalid_argument if the CPU set cannot be parsed
+ */
+void ThreadTopology::addRule(const std::string &pattern, const std::string &cpus, int priority)
+{
+  Rule rule{ pattern, parseCpus(cpus), priority };
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_rules.push_back(rule);
+  for(auto &thread : m_threads) {
+    apply(thread);
+  }
+}
+
+void ThreadTopology::lockMemory()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  if(m_memoryLocked) {
+    return;
+  }
+  if(mlockall(MCL_CURRENT | MCL_FUTURE)) {
+    m_memoryError = std::string("mlockall: ") + strerror(errno);
+  } else {
+    m_memoryLocked = true;
+    m_memoryError.clear();
+  }
+}
+
+const ThreadTopology::Rule *ThreadTopology::findRule(const std::string &name) const
+{
+  for(const auto &rule : m_rules) {
+    const std::string &pattern = rule.pattern;
+    if(!pattern.empty() && pattern.back() == '*') {
+      if(!name.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1)) {
+        return &rule;
+      }
+    } else if(name == pattern) {
+      return &rule;
+    }
+  }
+  return nullptr;
+}
+
+// Called with m_lock held
+void ThreadTopology::apply(Thread &thread)
+{
+  const Rule *rule = findRule(thread.name);
+  if(!rule) {
+    return;
+  }
+
+  thread.error.clear();
+  if(!rule->cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int cpu : rule->cpus) {
+      if(cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &set);
+      }
+    }
+    int result = pthread_setaffinity_np(thread.handle, sizeof(set), &set);
+    if(result) {
+      thread.error = std::string("affinity ") + formatCpus(rule->cpus) + ": " + strerror(result);
+    }
+  }
+
+  if(rule->priority > 0) {
+    struct sched_param param;
+    param.sched_priority = rule->priority;
+    int result = pthread_setschedparam(thread.handle, SCHED_FIFO, &param);
+    if(result) {
+      thread.error += (thread.error.empty() ? "" : ", ") + std::string("SCHED_FIFO ") + std::to_string(rule->priority) + ": " + strerror(result);
+    }
+  }
+}
+
+std::vector<ThreadTopology::Placement> ThreadTopology::getPlacement()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  std::vector<Placement> placement;
+  for(const auto &thread : m_threads) {
+    Placement p{ thread.name, thread.tid, std::string(), SCHED_OTHER, 0, thread.error };
+
+    cpu_set_t set;
+    if(!pthread_getaffinity_np(thread.handle, sizeof(set), &set)) {
+      std::vector<int> cpus;
+      for(int cpu = 0; cpu < CPU_SETSIZE; cpu ++) {
+        if(CPU_ISSET(cpu, &set)) {
+          cpus.push_back(cpu);
+        }
+      }
+      p.cpus = formatCpus(cpus);
+    }
+
+    struct sched_param param;
+    if(!pthread_getschedparam(thread.handle, &p.policy, &param)) {
+      p.priority = param.sched_priority;
+    }
+    placement.push_back(p);
+  }
+  return placement;
+}
+
+void ThreadTopology::report()
+{
+  for(const auto &thread : getPlacement()) {
+    LogInfo() << "Thread " << thread.name << " (tid " << thread.tid << "): cpus " << thread.cpus
+              << ", " << (thread.policy == SCHED_FIFO ? "SCHED_FIFO " : thread.policy == SCHED_RR ? "SCHED_RR " : "SCHED_OTHER ")
+              << thread.priority;
+    if(!thread.error.empty()) {
+      LogWarning() << "Thread " << thread.name << " placement failed: " << thread.error;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  if(m_memoryLocked) {
+    LogInfo() << "Memory locked";
+  } else if(!m_memoryError.empty()) {
+    LogWarning() << "Memory not locked: " << m_memoryError;
+  }
+}
+
+/**
+ * Parses a CPU list
+ * @param cpus comma separated CPUs and ranges, e.g. "0-3,6"; empty for none
+ * @throw std::invalid_argument on anything else
+ */
+std::vector<int> ThreadTopology::parseCpus(const std::string &cpus)
+{
+  std::vector<int> result;
+  std::stringstream stream(cpus);
+  std::string item;
+  while(std::getline(stream, item, ',')) {
+    if(item.empty()) {
+      continue;
+    }
+    char *end;
+    long first = strtol(item.c_str(), &end, 10);
+    long last = first;
+    if(*end == '-') {
+      last = strtol(end + 1, &end, 10);
+    }
+    if(*end || end == item.c_str() || first < 0 || last < first || last >= CPU_SETSIZE) {
+      throw std::invalid_argument("invalid CPU set \"" + cpus + "\"");
+    }
+    for(long cpu = first; cpu <= last; cpu ++) {
+      result.push_back(cpu);
+    }
+  }
+  return result;
+}
+
+std::string ThreadTopology::formatCpus(const std::vector<int> &cpus)
+{
+  std::string result;
+  for(size_t i = 0; i < cpus.size(); ) {
+    size_t j = i;
+    while(j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      j ++;
+    }
+    if(!result.empty()) {
+      result += ",";
+    }
+    result += std::to_string(cpus[i]);
+    if(j > i) {
+      result += "-" + std::to_string(cpus[j]);
+    }
+    i = j + 1;
+  }
+  return result;
+}
+
+}
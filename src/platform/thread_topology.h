@@ -0,0 +1,92 @@
+/***************************************************
+ * thread_topology.h
+ * Created on Sun, 18 Oct 2026 19:34:55 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace platform {
+
+/**
+ * Names, CPU sets and scheduling of the platform threads, in one place.
+ * Every long running thread (WebSocket, HTTP, logger, timer, journal, TaskQueue::run) registers
+ * under a name with a Scope for its lifetime. Rules map name patterns to a CPU set and optionally
+ * a SCHED_FIFO priority; a rule applies when a matching thread registers, and configure() applies
+ * the rules to threads already running, so the order of startup and configuration does not matter.
+ * report() logs where every thread really runs.
+ */
+class ThreadTopology {
+public:
+  // Placement wanted for the threads whose name matches pattern, "name" or "prefix*"
+  struct Rule {
+    std::string pattern;
+    std::vector<int> cpus; // Empty to keep the inherited affinity
+    int priority;          // SCHED_FIFO priority, 0 to keep the default policy
+  };
+
+  // Placement a thread got
+  struct Placement {
+    std::string name;
+    pid_t tid;
+    std::string cpus;  // As "0-3,6"
+    int policy;        // SCHED_OTHER, SCHED_FIFO...
+    int priority;
+    std::string error; // Why the rule could not be applied, empty if it was
+  };
+
+  // Registers the calling thread under a name until destroyed
+  class Scope {
+  public:
+    explicit Scope(const std::string &name);
+    ~Scope();
+
+  private:
+    Scope(const Scope &) = delete;
+    void operator =(const Scope &) = delete;
+  };
+
+  static ThreadTopology &instance();
+
+  void configure(const std::string &json); //!< "threads": [{"name", "cpus", "priority"}], "mlock": true
+  void addRule(const std::string &pattern, const std::string &cpus, int priority = 0); //!< Applies to running threads too
+  void lockMemory(); //!< mlockall() of current and future pages
+
+  std::vector<Placement> getPlacement();
+  void report(); //!< Logs the placement of every registered thread
+
+  static std::vector<int> parseCpus(const std::string &cpus); //!< "0-3,6" to { 0, 1, 2, 3, 6 }
+  static std::string formatCpus(const std::vector<int> &cpus);
+
+private:
+  struct Thread {
+    std::string name;
+    pthread_t handle;
+    pid_t tid;
+    std::string error;
+  };
+
+  ThreadTopology();
+  ThreadTopology(const ThreadTopology &) = delete;
+  void operator =(const ThreadTopology &) = delete;
+
+  const Rule *findRule(const std::string &name) const;
+  void apply(Thread &thread);
+
+  std::mutex m_lock;
+  std::vector<Rule> m_rules; // First match wins
+  std::list<Thread> m_threads;
+  std::string m_memoryError; // Empty if memory is locked or was not asked to be
+  bool m_memoryLocked;
+};
+
+}
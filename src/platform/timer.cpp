@@ -9,6 +9,7 @@
 
 #include <iostream>
 #include "timer.h"
+#include "thread_topology.h"
 
 namespace platform {
 
@@ -24,6 +25,7 @@ TimerService::TimerService() {
   s_instance = this;
   m_thread = std::thread(
       [this]() {
+        ThreadTopology::Scope scope("timer");
         io_service::work work(m_service);
         m_service.run();
       }
@@ -12,17 +12,28 @@
 #include <exception>
 #include <platform/log.h>
 #include "websocket.h"
+#include "thread_topology.h"
+#include "ws_journal.h"
 
 namespace platform {
 
 std::set<WebSocketClient*> WebSocketClient::s_instances;
 size_t WebSocketClient::s_numInstance = 0;
+std::atomic<uint32_t> WebSocketConnection::s_nextId(1);
 
 WebSocketConnection::WebSocketConnection(WebSocketClient *client)
   : m_closing(false)
   , m_webSocket(NULL)
   , m_client(client)
   , m_wantWrite(false)
+  , m_id(s_nextId ++)
+  , m_compression(false)
+  , m_compressionActive(false)
+  , m_messageCompressed(false)
+  , m_compressedMessages(0)
+  , m_compressedBytes(0)
+  , m_inflatedBytes(0)
+  , m_inflateNanos(0)
 {
   m_writeBuffer.resize(LWS_PRE);
   m_writtenBuffer.resize(LWS_PRE);
@@ -48,6 +59,16 @@ void WebSocketConnection::setConnectionHandler(WebSocketConnectionHandler *handl
   m_handler = handler;
 }
 
+WSCompressionStats WebSocketConnection::getCompressionStats() const
+{
+  WSCompressionStats stats;
+  stats.messages = m_compressedMessages.load(std::memory_order_relaxed);
+  stats.compressedBytes = m_compressedBytes.load(std::memory_order_relaxed);
+  stats.inflatedBytes = m_inflatedBytes.load(std::memory_order_relaxed);
+  stats.inflateNanos = m_inflateNanos.load(std::memory_order_relaxed);
+  return stats;
+}
+
 void WebSocketConnection::connect(std::string url)
 {
   const char *tmpProtocol;
@@ -90,6 +111,7 @@ void WebSocketConnection::connect(std::string address, int port, std::string pat
   m_port = port;
   m_path.swap(path);
   m_ssl = ssl;
+  m_compressionActive = false;
   m_connectInfo.address = m_address.c_str();
   m_connectInfo.host    = m_address.c_str();
   m_connectInfo.port = m_port;
@@ -161,7 +183,13 @@ int WebSocketConnection::onDataReady(char *data, size_t length) {
     }
   }
 
-  if(m_handler) {
+  if(m_messageCompressed) {
+    m_compressedMessages.fetch_add(1, std::memory_order_relaxed);
+    m_messageCompressed = false;
+  }
+
+  WSJournal *journal = m_client ? m_client->m_journal.load(std::memory_order_relaxed) : NULL;
+  if(m_handler || journal) {
     WSMessage msg;
     msg.type = data ? (lws_frame_is_binary(m_webSocket) ? BINARY : TEXT) : TEXT;
     if(m_readBuffer.size() == m_readBuffer.capacity()) {
@@ -173,7 +201,13 @@ int WebSocketConnection::onDataReady(char *data, size_t length) {
     struct timespec now;
     clock_gettime(CLOCK_REALTIME, &now);
     msg.timestamp = now.tv_sec * 1000000000 + now.tv_nsec;
-    m_handler->onDataReady(this, msg);
+    if(journal) {
+      // Record before the handler, it may modify the buffer in place
+      journal->record(m_id, WSDirection::Inbound, msg);
+    }
+    if(m_handler) {
+      m_handler->onDataReady(this, msg);
+    }
   }
 
   m_readBuffer.resize(0);
@@ -224,6 +258,7 @@ int WebSocketConnection::onWrite()
   size_t ptr = LWS_PRE, i = 0;
   WSMessage msg;
   msg.type = TEXT;
+  WSJournal *journal = m_client ? m_client->m_journal.load(std::memory_order_relaxed) : NULL;
 
   while(ptr < m_writtenBuffer.size()) {
     if(m_readBuffer.size() == m_readBuffer.capacity()) {
@@ -236,6 +271,10 @@ int WebSocketConnection::onWrite()
     clock_gettime(CLOCK_REALTIME, &now);
     msg.timestamp = now.tv_sec * 1000000000 + now.tv_nsec;
 
+    if(journal) {
+      journal->record(m_id, WSDirection::Outbound, msg);
+    }
+
     if(m_handler) {
       m_handler->onMessageSent(this, msg);
     }
@@ -304,6 +343,12 @@ int WebSocketConnection::wsCallback(struct lws *wsi, enum lws_callback_reasons r
     }
     return result;
     }
+  case LWS_CALLBACK_CLIENT_CONFIRM_EXTENSION_SUPPORTED:
+    // Non-zero keeps the extension out of the handshake, compression is opt-in per connection
+    if(wsc && wsc->m_compression && !strcmp((const char*)in, "permessage-deflate")) {
+      return 0;
+    }
+    return 1;
   case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
     if(wsc) {
       wsc->onConnectFailed();
@@ -322,9 +367,67 @@ int WebSocketConnection::wsCallback(struct lws *wsi, enum lws_callback_reasons r
   return 0;
 }
 
+static inline unsigned long monotonicNanos()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000UL + now.tv_nsec;
+}
 
+/**
+ * Wraps the permessage-deflate extension of libwebsockets to account compressed and inflated
+ * payload and the time spent inflating. Inflated data is delivered to onDataReady as usual
+ * and reassembled in the connection read buffer, which keeps its capacity between messages.
+ */
+int WebSocketConnection::deflateCallback(struct lws_context *context, const struct lws_extension *ext, struct lws *wsi,
+                                         enum lws_extension_callback_reasons reason, void *user, void *in, size_t len)
+{
+  WebSocketConnection *wsc = NULL;
+  if(wsi && lws_wsi_user(wsi)) {
+    wsc = *(WebSocketConnection**)lws_wsi_user(wsi);
+  }
+
+  if(reason == LWS_EXT_CB_CLIENT_CONSTRUCT) {
+    int result = lws_extension_callback_pm_deflate(context, ext, wsi, reason, user, in, len);
+    if(wsc && !result) {
+      wsc->m_compressionActive = true;
+    }
+    return result;
+  }
+
+  if(reason != LWS_EXT_CB_PAYLOAD_RX || !wsc) {
+    return lws_extension_callback_pm_deflate(context, ext, wsi, reason, user, in, len);
+  }
+
+#if defined(LWS_LIBRARY_VERSION_NUMBER) && LWS_LIBRARY_VERSION_NUMBER >= 3002000
+  struct lws_ext_pm_deflate_rx_ebufs *buffers = (struct lws_ext_pm_deflate_rx_ebufs*)in;
+  const int compressed = buffers->eb_in.len;
+  const unsigned long start = monotonicNanos();
+  int result = lws_extension_callback_pm_deflate(context, ext, wsi, reason, user, in, len);
+  wsc->m_inflateNanos.fetch_add(monotonicNanos() - start, std::memory_order_relaxed);
 
-WebSocketClient::WebSocketClient(const std::string &outboundAddr, bool enableLWSLogging)
+  // Input left in eb_in is passed again on the next call
+  if(compressed > buffers->eb_in.len) {
+    wsc->m_compressedBytes.fetch_add(compressed - buffers->eb_in.len, std::memory_order_relaxed);
+  }
+  if(buffers->eb_out.len > 0) {
+    wsc->m_inflatedBytes.fetch_add(buffers->eb_out.len, std::memory_order_relaxed);
+  }
+#else
+  const unsigned long start = monotonicNanos();
+  int result = lws_extension_callback_pm_deflate(context, ext, wsi, reason, user, in, len);
+  wsc->m_inflateNanos.fetch_add(monotonicNanos() - start, std::memory_order_relaxed);
+#endif
+  wsc->m_messageCompressed = true;
+  return result;
+}
+
+/**
+ * @param outboundAddr local interface to connect from, empty for the default one
+ * @param enableLWSLogging pass libwebsockets log to stderr instead of the platform log
+ * @param shared false keeps the client out of instance(), so only its owner creates connections on it
+ */
+WebSocketClient::WebSocketClient(const std::string &outboundAddr, bool enableLWSLogging, bool shared)
   : m_changed(false)
   , m_protocols({
                   {
@@ -337,8 +440,17 @@ WebSocketClient::WebSocketClient(const std::string &outboundAddr, bool enableLWS
                   },
                   { NULL, NULL, 0, 0 } /* terminator */
                 })
+  , m_extensions({
+                   {
+                     "permessage-deflate",
+                     &WebSocketConnection::deflateCallback,
+                     "permessage-deflate; client_max_window_bits"
+                   },
+                   { NULL, NULL, NULL } /* terminator */
+                 })
   , m_outgoingInterface(outboundAddr)
   , m_numConnections(0)
+  , m_journal(NULL)
 {
   if(!enableLWSLogging)
   {
@@ -354,6 +466,7 @@ WebSocketClient::WebSocketClient(const std::string &outboundAddr, bool enableLWS
 
   info.port = CONTEXT_PORT_NO_LISTEN;
   info.protocols = m_protocols.data();
+  info.extensions = m_extensions.data();
   info.gid = -1;
   info.uid = -1;
 
@@ -370,7 +483,9 @@ WebSocketClient::WebSocketClient(const std::string &outboundAddr, bool enableLWS
   m_running = true;
 
   m_thread = std::thread([this]() { run(); });
-  s_instances.insert(this);
+  if(shared) {
+    s_instances.insert(this);
+  }
 }
 
 void WebSocketClient::wsLog(int level, const char *line) {
@@ -416,6 +531,16 @@ WebSocketConnection *WebSocketClient::createConnection()
   return conn;
 }
 
+/**
+ * Attach frame journal. All inbound and outbound frames of the connections created by
+ * this client are recorded. The journal must outlive the client or be detached with nullptr.
+ * @param journal Journal to record frames to, nullptr disables recording
+ */
+void WebSocketClient::setJournal(WSJournal *journal)
+{
+  m_journal = journal;
+}
+
 WebSocketClient &WebSocketClient::instance()
 {
   if(!s_instances.size()) {
@@ -469,6 +594,7 @@ void WebSocketClient::removeHandle(lws *handle)
 
 void WebSocketClient::run()
 {
+  ThreadTopology::Scope scope("ws");
   while(m_running) {
     if(m_changed) {
       std::lock_guard<std::mutex> lock(m_connectionsSync);
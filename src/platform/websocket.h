@@ -9,6 +9,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <set>
 #include <thread>
 #include <mutex>
@@ -30,10 +31,21 @@ struct WSMessage {
   unsigned long timestamp;
 };
 
+//! Compression counters of a connection, updated while permessage-deflate is in use
+struct WSCompressionStats {
+  uint64_t messages = 0; //!< Messages received compressed
+  uint64_t compressedBytes = 0; //!< Payload bytes as received on the wire
+  uint64_t inflatedBytes = 0; //!< Payload bytes after inflate
+  uint64_t inflateNanos = 0; //!< Time spent inflating
+
+  double getRatio() const { return compressedBytes ? (double)inflatedBytes / compressedBytes : 0; } //!< Inflated to wire size
+};
+
 class WebSocketConnection;
 typedef std::function<int (WebSocketConnection *)> WSCallback;
 typedef std::function<int (WebSocketConnection *, WSMessage msg)> WSReadCallback;
 class WebSocketClient;
+class WSJournal;
 
 class WebSocketConnectionHandler {
 public:
@@ -53,6 +65,11 @@ public:
   void reconnect();
   void disconnect();
   bool isConnected();
+  uint32_t getId() const { return m_id; }
+
+  void setCompression(bool enable) { m_compression = enable; } //!< Offer permessage-deflate on the next connect
+  bool isCompressed() const { return m_compressionActive; } //!< Server accepted permessage-deflate
+  WSCompressionStats getCompressionStats() const; //!< Snapshot of the compression counters
 
   int write(const char *, size_t);
 
@@ -67,6 +84,8 @@ public:
 
 private:
   static int wsCallback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len);
+  static int deflateCallback(struct lws_context *context, const struct lws_extension *ext, struct lws *wsi,
+                             enum lws_extension_callback_reasons reason, void *user, void *in, size_t len);
   WebSocketConnection(WebSocketClient *);
 
   WebSocketConnection(const WebSocketConnection &) = delete;
@@ -88,16 +107,27 @@ private:
   bool m_ssl;
   WebSocketClient *m_client;
   bool m_wantWrite;
+  uint32_t m_id;
+  bool m_compression;
+  std::atomic<bool> m_compressionActive;
+  bool m_messageCompressed;
+  std::atomic<uint64_t> m_compressedMessages;
+  std::atomic<uint64_t> m_compressedBytes;
+  std::atomic<uint64_t> m_inflatedBytes;
+  std::atomic<uint64_t> m_inflateNanos;
+
+  static std::atomic<uint32_t> s_nextId;
 
   friend class WebSocketClient;
 };
 
 class WebSocketClient {
 public:
-  WebSocketClient(const std::string &outboundAddr = "", bool enableLWSLogging = false);
+  WebSocketClient(const std::string &outboundAddr = "", bool enableLWSLogging = false, bool shared = true);
   ~WebSocketClient();
 
   WebSocketConnection *createConnection();
+  void setJournal(WSJournal *journal); //!< Record all frames of this client's connections (nullptr to stop)
 
   static WebSocketClient &instance();
 
@@ -121,12 +151,14 @@ private:
   std::set<lws*> m_removeConnections;
 
   std::vector<lws_protocols> m_protocols;
+  std::vector<lws_extension> m_extensions;
   lws_context *m_context;
   std::set<lws*> m_connections;
   static std::set<WebSocketClient*> s_instances;
   static size_t s_numInstance;
   std::string m_outgoingInterface;
   int m_numConnections;
+  std::atomic<WSJournal*> m_journal;
 
   friend class WebSocketConnection;
 };
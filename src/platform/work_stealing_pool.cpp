@@ -0,0 +1,267 @@
+/***************************************************
+ * work_stealing_pool.cpp
+ * Created on Sun, 18 Oct 2026 19:25:59 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#include <chrono>
+#include <stdexcept>
+#include "work_stealing_pool.h"
+
+namespace platform {
+
+static const unsigned long SpinsBeforeYield = 1000;
+
+static inline long steadyNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+WorkDeque::WorkDeque(size_t capacity)
+  : m_tasks(new std::atomic<Task*>[capacity])
+  , m_mask(capacity - 1)
+  , m_top(0)
+  , m_bottom(0)
+{
+  if(!capacity || (capacity & m_mask)) {
+    throw std::invalid_argument("WorkDeque capacity must be a power of 2");
+  }
+}
+
+class WorkStealingPool::Worker
+  : public TaskQueue
+{
+public:
+  Worker(WorkStealingPool *pool, size_t index, size_t capacity)
+    : TaskQueue(capacity, QueueFullPolicy::Grow)
+    , pool(pool)
+    , index(index)
+    , deque(capacity)
+    , busy(false)
+    , wakePending(false)
+    , executed(0)
+    , stolen(0)
+    , received(0)
+    , busyTime(0)
+    , started(steadyNow())
+    , m_seed(index * 2654435761u + 1)
+  {
+    setWait(QueueWait::Park, SpinsBeforeYield);
+    setName("pool-" + std::to_string(index));
+  }
+
+  // Runs the deque, then stolen jobs, until there is no job left or the queue has new submissions
+  virtual void onIdle() override {
+    while(true) {
+      Task *task = deque.pop();
+      if(!task) {
+        task = pool->steal(index, m_seed);
+        if(!task) {
+          return;
+        }
+        increment(stolen);
+      }
+      execute(task);
+      if(!empty()) {
+        return;
+      }
+    }
+  }
+
+  void execute(Task *task) noexcept {
+    busy.store(true, std::memory_order_relaxed);
+    long start = steadyNow();
+    processAndDelete(task);
+    busyTime.store(busyTime.load(std::memory_order_relaxed) + steadyNow() - start, std::memory_order_relaxed);
+    increment(executed);
+    busy.store(false, std::memory_order_relaxed);
+  }
+
+  // Counters have one writer
+  static void increment(std::atomic<unsigned long> &counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  WorkStealingPool *pool;
+  const size_t index;
+  WorkDeque deque;
+  std::atomic<bool> busy; // Running a job
+  std::atomic<bool> wakePending; // A wake-up is queued and has not run yet
+  std::atomic<unsigned long> executed;
+  std::atomic<unsigned long> stolen;
+  std::atomic<unsigned long> received; // Written by submitting threads
+  std::atomic<long> busyTime; // Nanoseconds
+  const long started;
+
+private:
+  uint32_t m_seed; // Victim selection
+};
+
+// Moves a job submitted from outside the pool to the deque of the worker running it.
+// Fits a ring slot; moved, never copied, the job is deleted if the forward never runs.
+class WorkStealingPool::ForwardTask
+{
+public:
+  ForwardTask(Task *task) : m_task(task) { }
+  ForwardTask(ForwardTask &&other) : m_task(other.m_task) { other.m_task = nullptr; }
+  ~ForwardTask() { delete m_task; }
+
+  void operator ()(TaskQueue *queue) {
+    Worker *worker = static_cast<Worker*>(queue);
+    Task *task = m_task;
+    m_task = nullptr;
+    if(worker->pool->m_stopping) {
+      delete task;
+    } else if(!worker->deque.push(task)) {
+      worker->execute(task);
+    } else if(worker->deque.size() > 1) {
+      worker->pool->wakeIdle(worker->index);
+    }
+  }
+
+private:
+  ForwardTask(const ForwardTask &) = delete;
+  void operator =(const ForwardTask &) = delete;
+
+  Task *m_task;
+};
+
+thread_local WorkStealingPool::Worker *WorkStealingPool::s_worker = nullptr;
+
+/**
+ * Starts the workers
+ * @param workers number of threads
+ * @param capacity size of each worker's deque and queue ring, rounded up to a power of 2
+ */
+WorkStealingPool::WorkStealingPool(size_t workers, size_t capacity)
+  : m_next(0)
+  , m_stopping(false)
+{
+  if(!workers) {
+    throw std::invalid_argument("WorkStealingPool needs at least one worker");
+  }
+  size_t size = 2;
+  while(size < capacity) {
+    size <<= 1;
+  }
+
+  for(size_t i = 0; i < workers; i ++) {
+    m_workers.emplace_back(new Worker(this, i, size));
+  }
+  for(auto &worker : m_workers) {
+    Worker *w = worker.get();
+    m_threads.emplace_back([w]() {
+      s_worker = w;
+      w->run();
+    });
+    // Queue is usable only after run() has registered its thread
+    while(!w->running()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  m_stopping = true;
+  for(auto &worker : m_workers) {
+    worker->stop();
+  }
+  for(auto &thread : m_threads) {
+    thread.join();
+  }
+  for(auto &worker : m_workers) {
+    while(Task *task = worker->deque.pop()) {
+      delete task;
+    }
+  }
+}
+
+/**
+ * Queues a job, from a worker to its own deque, from any other thread to a worker not running a job
+ * @param task job, deleted once run
+ */
+void WorkStealingPool::submit(Task *task)
+{
+  if(!task) {
+    return;
+  }
+
+  Worker *self = s_worker;
+  if(self && self->pool == this) {
+    if(!self->deque.push(task)) {
+      self->execute(task);
+    } else if(self->deque.size() > 1) {
+      wakeIdle(self->index);
+    }
+    return;
+  }
+
+  const size_t count = m_workers.size();
+  const size_t start = m_next.fetch_add(1, std::memory_order_relaxed);
+  Worker *target = m_workers[start % count].get();
+  for(size_t i = 0; i < count; i ++) {
+    Worker *worker = m_workers[(start + i) % count].get();
+    if(!worker->busy.load(std::memory_order_relaxed)) {
+      target = worker;
+      break;
+    }
+  }
+  target->received.fetch_add(1, std::memory_order_relaxed);
+  target->post(ForwardTask(task));
+}
+
+// Oldest job of another worker, victims are tried from a random one on
+Task *WorkStealingPool::steal(size_t thief, uint32_t &seed) noexcept
+{
+  const size_t count = m_workers.size();
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  const size_t start = seed % count;
+  for(size_t i = 0; i < count; i ++) {
+    const size_t victim = (start + i) % count;
+    if(victim == thief) {
+      continue;
+    }
+    if(Task *task = m_workers[victim]->deque.steal()) {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+// A deque has more jobs than its worker is running, make sure a worker which may be parked looks for them.
+// A worker has at most one wake-up queued, so fanning out many jobs does not fill its ring with them.
+void WorkStealingPool::wakeIdle(size_t except) noexcept
+{
+  const size_t count = m_workers.size();
+  const size_t start = m_next.fetch_add(1, std::memory_order_relaxed);
+  for(size_t i = 0; i < count; i ++) {
+    Worker *worker = m_workers[(start + i) % count].get();
+    // A worker with a wake-up queued looks for jobs anyway, the next idle one is woken instead
+    if(worker->index == except || worker->busy.load(std::memory_order_relaxed) ||
+       worker->wakePending.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    if(!worker->wakePending.exchange(true, std::memory_order_relaxed)) {
+      // Runs nothing, the worker steals from onIdle() after it
+      worker->post([worker](TaskQueue*) { worker->wakePending.store(false, std::memory_order_relaxed); });
+      return;
+    }
+  }
+}
+
+std::vector<WorkStealingPool::WorkerStats> WorkStealingPool::getStats() const
+{
+  const long now = steadyNow();
+  std::vector<WorkerStats> stats;
+  for(const auto &worker : m_workers) {
+    stats.push_back(WorkerStats{ worker->executed, worker->stolen, worker->received,
+                                 now > worker->started ? (double)worker->busyTime / (now - worker->started) : 0 });
+  }
+  return stats;
+}
+
+}
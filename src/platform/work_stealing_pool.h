@@ -0,0 +1,147 @@
+/***************************************************
+ * work_stealing_pool.h
+ * Created on Sun, 18 Oct 2026 19:25:59 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "task_queue.h"
+
+namespace platform {
+
+/**
+ * Bounded Chase-Lev deque of tasks. The owner pushes and pops at the bottom (LIFO),
+ * other threads steal from the top (FIFO); only the last task is contended, with one CAS.
+ */
+class WorkDeque {
+public:
+  explicit WorkDeque(size_t capacity);
+
+  //! Owner only, false if the deque is full
+  inline bool push(Task *task) noexcept {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    const int64_t top = m_top.load(std::memory_order_acquire);
+    if(bottom - top > (int64_t)m_mask) {
+      return false;
+    }
+    m_tasks[bottom & m_mask].store(task, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  //! Owner only, most recently pushed task or nullptr
+  inline Task *pop() noexcept {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+    if(top > bottom) {
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Task *task = m_tasks[bottom & m_mask].load(std::memory_order_relaxed);
+    if(top == bottom) {
+      // Last task, thieves may race for it
+      if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  //! Any thread, oldest task or nullptr if the deque is empty or another thread won the race
+  inline Task *steal() noexcept {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+    if(top >= bottom) {
+      return nullptr;
+    }
+    Task *task = m_tasks[top & m_mask].load(std::memory_order_relaxed);
+    if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+  inline size_t size() const noexcept {
+    int64_t size = m_bottom.load(std::memory_order_relaxed) - m_top.load(std::memory_order_relaxed);
+    return size > 0 ? size : 0;
+  }
+
+private:
+  static const size_t CacheLine = 64;
+
+  WorkDeque(const WorkDeque &) = delete;
+  void operator =(const WorkDeque &) = delete;
+
+  // Padded rather than aligned, like TaskRing
+  std::unique_ptr<std::atomic<Task*>[]> m_tasks;
+  const size_t m_mask;
+  char m_padTop[CacheLine];
+  std::atomic<int64_t> m_top;    // Thieves
+  char m_padBottom[CacheLine - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> m_bottom; // Owner
+  char m_padEnd[CacheLine - sizeof(std::atomic<int64_t>)];
+};
+
+/**
+ * Pool of threads for CPU heavy jobs whose order does not matter: snapshots, backfills, checksums, scans.
+ * Every worker is a TaskQueue in ring mode, running its own Chase-Lev deque whenever its queue is empty
+ * and stealing from the other workers' deques when its deque is empty too; idle workers park (QueueWait::Park).
+ * Jobs submitted from a worker go to its deque. Jobs submitted from other threads, e.g. a WebSocket or
+ * TaskQueue thread, are pushed to the queue of a worker which is not running a job, round robin,
+ * and moved to its deque from there, so they become stealable.
+ * Jobs are Tasks or callables taking the TaskQueue*, exactly as for TaskQueue; the queue passed is
+ * the worker's, results go back to the submitting thread by posting to its TaskQueue.
+ */
+class WorkStealingPool {
+public:
+  struct WorkerStats {
+    unsigned long executed;  // Jobs run
+    unsigned long stolen;    // Jobs taken from other workers' deques
+    unsigned long received;  // Jobs submitted from outside the pool
+    double utilization;      // Share of the time since start spent running jobs
+  };
+
+  WorkStealingPool(size_t workers, size_t capacity = 4096);
+  ~WorkStealingPool(); // Jobs not started are deleted
+
+  void submit(Task *task); //!< Any thread
+  template<typename Function>
+  void post(Function &&function) { //!< Any thread, callable taking the TaskQueue*
+    submit(new FunctionTask<typename std::decay<Function>::type>(std::forward<Function>(function)));
+  }
+
+  size_t size() const { return m_workers.size(); }
+  std::vector<WorkerStats> getStats() const;
+
+private:
+  class Worker;
+  class ForwardTask;
+
+  Task *steal(size_t thief, uint32_t &seed) noexcept;
+  void wakeIdle(size_t except) noexcept;
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  void operator =(const WorkStealingPool &) = delete;
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<std::thread> m_threads;
+  std::atomic<size_t> m_next; // Round robin start of external submissions
+  std::atomic<bool> m_stopping;
+  static thread_local Worker *s_worker; // Worker running on the calling thread, if any
+};
+
+}
@@ -0,0 +1,372 @@
+/***************************************************
+ * ws_journal.cpp
+ * Created on Sun, 18 Oct 2026 09:40:02 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+#include "log.h"
+#include "ws_journal.h"
+#include "thread_topology.h"
+
+namespace platform {
+
+static inline size_t recordSize(size_t payload) {
+  return sizeof(WSJournalRecord) + ((payload + 7) & ~(size_t)7);
+}
+
+static inline uint64_t monotonicNow() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ul + now.tv_nsec;
+}
+
+static inline size_t roundUpPow2(size_t size) {
+  size_t result = 4096;
+  while(result < size) {
+    result <<= 1;
+  }
+  return result;
+}
+
+WSJournal::WSJournal(const std::string &pathPrefix, size_t maxFileSize, size_t bufferSize)
+  : m_pathPrefix(pathPrefix)
+  , m_maxFileSize(maxFileSize)
+  , m_ring(roundUpPow2(bufferSize))
+  , m_lock(ATOMIC_FLAG_INIT)
+  , m_writePos(0)
+  , m_readPos(0)
+  , m_recordedFrames(0)
+  , m_droppedFrames(0)
+  , m_writtenBytes(0)
+  , m_running(true)
+  , m_syncRequests(0)
+  , m_syncsDone(0)
+  , m_fd(-1)
+  , m_map(NULL)
+  , m_fileOffset(0)
+  , m_fileNumber(0)
+  , m_openFailures(0)
+  , m_retryAt(0)
+{
+  if(m_maxFileSize <= sizeof(WSJournalHeader) + sizeof(WSJournalRecord)) {
+    throw std::invalid_argument("WSJournal file size is too small");
+  }
+
+  // Open the first file here, so configuration errors surface in the caller
+  openFile();
+  m_thread = std::thread([this]() { run(); });
+}
+
+WSJournal::~WSJournal() {
+  m_running = false;
+  if(m_thread.joinable()) {
+    m_thread.join();
+  }
+  closeFile();
+}
+
+/**
+ * Queue the frame to be written to the journal.
+ * Called from the WebSocket threads, it does not block on disk I/O.
+ * @return false if the frame was dropped because the staging buffer is full
+ */
+bool WSJournal::record(uint32_t connectionId, WSDirection direction, const WSMessage &msg) noexcept {
+  const size_t need = recordSize(msg.size);
+  const uint64_t capacity = m_ring.size();
+
+  if(__builtin_expect(need > capacity || need > m_maxFileSize - sizeof(WSJournalHeader), 0)) {
+    m_droppedFrames ++;
+    return false;
+  }
+
+  WSJournalRecord header;
+  header.size = msg.size;
+  header.connectionId = connectionId;
+  header.timestamp = msg.timestamp;
+  header.direction = (uint8_t)direction;
+  header.type = (uint8_t)msg.type;
+  header.reserved = 0;
+  header.reserved2 = 0;
+
+  lock();
+  uint64_t writePos = m_writePos.load(std::memory_order_relaxed);
+  if(writePos + need - m_readPos.load(std::memory_order_acquire) > capacity) {
+    unlock();
+    m_droppedFrames ++;
+    return false;
+  }
+
+  // Payload is padded to 8 bytes with zeros, the ring still holds older frames there
+  static const char padding[8] = { };
+  char *ring = m_ring.data();
+  const uint64_t mask = capacity - 1;
+  const char *parts[3] = { (const char*)&header, msg.data, padding };
+  size_t sizes[3] = { sizeof(header), msg.size, need - sizeof(header) - msg.size };
+  uint64_t pos = writePos;
+
+  for(int i = 0; i < 3; i ++) {
+    size_t offset = pos & mask;
+    size_t first = std::min<size_t>(sizes[i], capacity - offset);
+    memcpy(ring + offset, parts[i], first);
+    memcpy(ring, parts[i] + first, sizes[i] - first);
+    pos += sizes[i];
+  }
+
+  m_writePos.store(writePos + need, std::memory_order_release);
+  unlock();
+  m_recordedFrames ++;
+  return true;
+}
+
+/**
+ * Wait until all queued frames reach the file.
+ * The mapping belongs to the background thread, which also schedules its write-back.
+ */
+void WSJournal::flush() {
+  const uint64_t request = m_syncRequests.fetch_add(1) + 1;
+  while(m_running && (m_readPos.load(std::memory_order_acquire) != m_writePos.load(std::memory_order_acquire) ||
+                      m_syncsDone.load(std::memory_order_acquire) < request)) {
+    usleep(1000);
+  }
+}
+
+std::string WSJournal::getCurrentFile() const {
+  std::lock_guard<std::mutex> lock(m_fileNameLock);
+  return m_fileName;
+}
+
+void WSJournal::sync() {
+  const uint64_t requests = m_syncRequests.load(std::memory_order_acquire);
+  if(m_syncsDone.load(std::memory_order_relaxed) != requests) {
+    if(m_map) {
+      msync(m_map, m_fileOffset, MS_ASYNC);
+    }
+    m_syncsDone.store(requests, std::memory_order_release);
+  }
+}
+
+void WSJournal::copyFromRing(char *dest, uint64_t pos, size_t size) {
+  const size_t capacity = m_ring.size();
+  size_t offset = pos & (capacity - 1);
+  size_t first = std::min(size, capacity - offset);
+  memcpy(dest, m_ring.data() + offset, first);
+  memcpy(dest + first, m_ring.data(), size - first);
+}
+
+void WSJournal::drain() {
+  uint64_t writePos = m_writePos.load(std::memory_order_acquire);
+  uint64_t readPos = m_readPos.load(std::memory_order_relaxed);
+
+  if(readPos == writePos) {
+    return;
+  }
+
+  size_t written = 0;
+  while(readPos < writePos) {
+    WSJournalRecord header;
+    copyFromRing((char*)&header, readPos, sizeof(header));
+    size_t size = recordSize(header.size);
+
+    if(!m_map || m_fileOffset + size > m_maxFileSize) {
+      reopenFile();
+    }
+
+    if(m_map) {
+      copyFromRing(m_map + m_fileOffset, readPos, size);
+      m_fileOffset += size;
+      written += size;
+    } else {
+      m_droppedFrames ++;
+    }
+    readPos += size;
+  }
+
+  if(m_map) {
+    reinterpret_cast<WSJournalHeader*>(m_map)->dataSize = m_fileOffset - sizeof(WSJournalHeader);
+  }
+  m_writtenBytes += written;
+  m_readPos.store(readPos, std::memory_order_release);
+}
+
+void WSJournal::run() {
+  ThreadTopology::Scope scope("journal");
+  while(m_running) {
+    uint64_t before = m_readPos.load(std::memory_order_relaxed);
+    drain();
+    sync();
+    if(m_readPos.load(std::memory_order_relaxed) == before) {
+      usleep(1000);
+    }
+  }
+  drain();
+}
+
+/**
+ * Rotates to a new file. After a failure frames are dropped until the next attempt,
+ * which is delayed 1 s, doubling up to 64 s while the failures last.
+ */
+void WSJournal::reopenFile() {
+  closeFile();
+  const uint64_t now = monotonicNow();
+  if(now < m_retryAt) {
+    return;
+  }
+  try {
+    openFile();
+    m_openFailures = 0;
+  } catch(std::exception &e) {
+    LogError() << "WSJournal: " << e.what();
+    m_retryAt = now + (1000000000ul << std::min(m_openFailures, 6u));
+    m_openFailures ++;
+  }
+}
+
+void WSJournal::openFile() {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  const std::string fileName = m_pathPrefix + "-" + boost::lexical_cast<std::string>(now.tv_sec) + "-" +
+                               boost::lexical_cast<std::string>(m_fileNumber ++) + ".wsj";
+
+  m_fd = open(fileName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if(m_fd < 0) {
+    throw std::runtime_error("Can not open journal file " + fileName + ": " + strerror(errno));
+  }
+
+  // Blocks are reserved up front: writing a hole of a sparse file on a full disk raises SIGBUS
+  int error = posix_fallocate(m_fd, 0, m_maxFileSize);
+  if(error) {
+    close(m_fd);
+    m_fd = -1;
+    unlink(fileName.c_str());
+    throw std::runtime_error("Can not allocate journal file " + fileName + ": " + strerror(error));
+  }
+
+  void *map = mmap(NULL, m_maxFileSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if(map == MAP_FAILED) {
+    close(m_fd);
+    m_fd = -1;
+    throw std::runtime_error("Can not map journal file " + fileName + ": " + strerror(errno));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_fileNameLock);
+    m_fileName = fileName;
+  }
+
+  m_map = (char*)map;
+  WSJournalHeader *header = reinterpret_cast<WSJournalHeader*>(m_map);
+  memcpy(header->magic, WS_JOURNAL_MAGIC, sizeof(header->magic));
+  header->version = 1;
+  header->headerSize = sizeof(WSJournalHeader);
+  header->dataSize = 0;
+  header->created = now.tv_sec * 1000000000 + now.tv_nsec;
+  m_fileOffset = sizeof(WSJournalHeader);
+}
+
+void WSJournal::closeFile() {
+  if(m_map) {
+    reinterpret_cast<WSJournalHeader*>(m_map)->dataSize = m_fileOffset - sizeof(WSJournalHeader);
+    munmap(m_map, m_maxFileSize);
+    m_map = NULL;
+  }
+
+  if(m_fd >= 0) {
+    // Cut preallocated tail, so the file only holds recorded frames
+    if(ftruncate(m_fd, m_fileOffset) < 0) {
+      LogError() << "WSJournal: can not truncate " << m_fileName;
+    }
+    close(m_fd);
+    m_fd = -1;
+  }
+  m_fileOffset = 0;
+}
+
+
+WSJournalReader::WSJournalReader(const std::string &fileName)
+  : m_fd(-1)
+  , m_map(NULL)
+  , m_mapSize(0)
+  , m_dataEnd(0)
+  , m_offset(0)
+{
+  m_fd = open(fileName.c_str(), O_RDONLY);
+  if(m_fd < 0) {
+    throw std::runtime_error("Can not open journal file " + fileName + ": " + strerror(errno));
+  }
+
+  struct stat st;
+  if(fstat(m_fd, &st) < 0 || (size_t)st.st_size < sizeof(WSJournalHeader)) {
+    close(m_fd);
+    throw std::runtime_error("Invalid journal file " + fileName);
+  }
+
+  m_mapSize = st.st_size;
+  void *map = mmap(NULL, m_mapSize, PROT_READ, MAP_SHARED, m_fd, 0);
+  if(map == MAP_FAILED) {
+    close(m_fd);
+    throw std::runtime_error("Can not map journal file " + fileName + ": " + strerror(errno));
+  }
+  m_map = (const char*)map;
+
+  const WSJournalHeader *header = reinterpret_cast<const WSJournalHeader*>(m_map);
+  if(memcmp(header->magic, WS_JOURNAL_MAGIC, sizeof(header->magic)) || header->version != 1) {
+    munmap(const_cast<char*>(m_map), m_mapSize);
+    close(m_fd);
+    throw std::runtime_error("Not a WebSocket journal: " + fileName);
+  }
+
+  m_dataEnd = std::min<size_t>(header->headerSize + header->dataSize, m_mapSize);
+  m_offset = header->headerSize;
+}
+
+WSJournalReader::~WSJournalReader() {
+  munmap(const_cast<char*>(m_map), m_mapSize);
+  close(m_fd);
+}
+
+/**
+ * Read next frame. Frame data points into the mapped file and stays valid while reader exists.
+ * @return false when there are no more frames
+ */
+bool WSJournalReader::next(WSJournalFrame &frame) {
+  if(m_offset + sizeof(WSJournalRecord) > m_dataEnd) {
+    return false;
+  }
+
+  const WSJournalRecord *record = reinterpret_cast<const WSJournalRecord*>(m_map + m_offset);
+  size_t size = recordSize(record->size);
+  if(m_offset + size > m_dataEnd) {
+    return false; // Truncated record
+  }
+
+  frame.connectionId = record->connectionId;
+  frame.direction = (WSDirection)record->direction;
+  frame.type = (WSFrameType)record->type;
+  frame.timestamp = record->timestamp;
+  frame.data = m_map + m_offset + sizeof(WSJournalRecord);
+  frame.size = record->size;
+
+  m_offset += size;
+  return true;
+}
+
+void WSJournalReader::rewind() {
+  m_offset = reinterpret_cast<const WSJournalHeader*>(m_map)->headerSize;
+}
+
+uint64_t WSJournalReader::getCreated() const {
+  return reinterpret_cast<const WSJournalHeader*>(m_map)->created;
+}
+
+}
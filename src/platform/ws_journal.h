@@ -0,0 +1,143 @@
+/***************************************************
+ * ws_journal.h
+ * Created on Sun, 18 Oct 2026 09:12:40 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "websocket.h"
+
+#define WS_JOURNAL_MAGIC "WSJRNL1"
+
+namespace platform {
+
+enum class WSDirection : uint8_t {
+  Inbound = 0,
+  Outbound
+};
+
+// On-disk file header, followed by records
+struct WSJournalHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t dataSize; // Committed bytes after the header
+  uint64_t created;  // Nanoseconds, CLOCK_REALTIME
+};
+
+// On-disk record header, followed by payload padded to 8 bytes
+struct WSJournalRecord {
+  uint32_t size;
+  uint32_t connectionId;
+  uint64_t timestamp;
+  uint8_t direction;
+  uint8_t type;
+  uint16_t reserved;
+  uint32_t reserved2;
+};
+
+struct WSJournalFrame {
+  uint32_t connectionId;
+  WSDirection direction;
+  WSFrameType type;
+  uint64_t timestamp;
+  const char *data;
+  size_t size;
+};
+
+// Append-only journal of raw WebSocket frames.
+// record() only copies the frame into a bounded staging ring, the frames are written
+// to memory mapped files by the background thread. When the ring is full frames are dropped
+// and counted rather than stalling the caller.
+class WSJournal {
+public:
+  WSJournal(const std::string &pathPrefix, size_t maxFileSize = 256 << 20, size_t bufferSize = 16 << 20);
+  ~WSJournal();
+
+  bool record(uint32_t connectionId, WSDirection direction, const WSMessage &msg) noexcept;
+  void flush();
+
+  uint64_t getRecordedFrames() const { return m_recordedFrames; }
+  uint64_t getDroppedFrames() const { return m_droppedFrames; }
+  uint64_t getWrittenBytes() const { return m_writtenBytes; }
+  std::string getCurrentFile() const;
+
+private:
+  void run();
+  void drain();
+  void sync();
+  void openFile();
+  void reopenFile();
+  void closeFile();
+  void copyFromRing(char *dest, uint64_t pos, size_t size);
+
+  inline void lock() noexcept {
+    while(__builtin_expect(m_lock.test_and_set(std::memory_order_acquire), 0)) {
+      std::this_thread::yield();
+    }
+  }
+
+  inline void unlock() noexcept {
+    m_lock.clear(std::memory_order_release);
+  }
+
+  WSJournal(const WSJournal &) = delete;
+  void operator =(const WSJournal &) = delete;
+
+  std::string m_pathPrefix;
+  size_t m_maxFileSize;
+  std::vector<char> m_ring;
+  std::atomic_flag m_lock;
+  std::atomic<uint64_t> m_writePos;
+  std::atomic<uint64_t> m_readPos;
+  std::atomic<uint64_t> m_recordedFrames;
+  std::atomic<uint64_t> m_droppedFrames;
+  std::atomic<uint64_t> m_writtenBytes;
+  std::atomic<bool> m_running;
+  std::thread m_thread;
+
+  std::atomic<uint64_t> m_syncRequests; // Incremented by flush(), served by the background thread
+  std::atomic<uint64_t> m_syncsDone;
+
+  // Background thread only, once the constructor has opened the first file
+  int m_fd;
+  char *m_map;
+  size_t m_fileOffset;
+  unsigned int m_fileNumber;
+  unsigned int m_openFailures; // Consecutive failures to open a file, doubles the retry delay
+  uint64_t m_retryAt; // CLOCK_MONOTONIC nanoseconds of the next open attempt
+  mutable std::mutex m_fileNameLock;
+  std::string m_fileName;
+};
+
+// Sequential reader for journal files written by WSJournal
+class WSJournalReader {
+public:
+  WSJournalReader(const std::string &fileName);
+  ~WSJournalReader();
+
+  bool next(WSJournalFrame &frame);
+  void rewind();
+  uint64_t getCreated() const;
+
+private:
+  WSJournalReader(const WSJournalReader &) = delete;
+  void operator =(const WSJournalReader &) = delete;
+
+  int m_fd;
+  const char *m_map;
+  size_t m_mapSize;
+  size_t m_dataEnd;
+  size_t m_offset;
+};
+
+}
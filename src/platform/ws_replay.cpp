@@ -0,0 +1,121 @@
+/***************************************************
+ * ws_replay.cpp
+ * Created on Sun, 18 Oct 2026 11:52:31 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+
+#include <string.h>
+#include <stdexcept>
+#include "ws_replay.h"
+
+namespace platform {
+
+WSReplay::WSReplay(WebSocketConnectionHandler *handler, Clock *clock)
+  : m_handler(handler)
+  , m_clock(clock ? clock : &Clock::instance())
+  , m_mode(Mode::AsFastAsPossible)
+  , m_speed(1.0)
+  , m_connectionFilter(0)
+  , m_restamp(false)
+  , m_running(false)
+  , m_frames(0)
+  , m_bytes(0)
+  , m_elapsed(0)
+{
+  m_buffer.reserve(65536);
+}
+
+/**
+ * Set replay pacing
+ * @param mode Pacing mode
+ * @param speed Speed factor for Mode::Accelerated (2.0 replays twice as fast)
+ */
+void WSReplay::setMode(Mode mode, double speed) {
+  if(mode == Mode::Accelerated && speed <= 0) {
+    throw std::invalid_argument("Replay speed must be positive");
+  }
+  m_mode = mode;
+  m_speed = (mode == Mode::Accelerated) ? speed : 1.0;
+}
+
+void WSReplay::setConnectionFilter(uint32_t connectionId) {
+  m_connectionFilter = connectionId;
+}
+
+void WSReplay::setRestamp(bool restamp) {
+  m_restamp = restamp;
+}
+
+void WSReplay::addFile(const std::string &fileName) {
+  m_files.push_back(fileName);
+}
+
+void WSReplay::stop() {
+  m_running = false;
+}
+
+void WSReplay::deliver(const WSJournalFrame &frame, unsigned long timestamp) {
+  // Handlers may terminate the message in place, so keep a spare byte after the payload
+  m_buffer.resize(frame.size + 1);
+  memcpy(m_buffer.data(), frame.data, frame.size);
+  m_buffer[frame.size] = 0;
+
+  WSMessage msg;
+  msg.type = frame.type;
+  msg.data = m_buffer.data();
+  msg.size = frame.size;
+  msg.timestamp = timestamp;
+
+  if(frame.direction == WSDirection::Inbound) {
+    m_handler->onDataReady(NULL, msg);
+  } else {
+    m_handler->onMessageSent(NULL, msg);
+  }
+
+  m_frames ++;
+  m_bytes += frame.size;
+}
+
+size_t WSReplay::run() {
+  m_running = true;
+  m_frames = 0;
+  m_bytes = 0;
+
+  const unsigned long start = m_clock->now();
+  unsigned long firstRecorded = 0;
+  bool first = true;
+
+  for(const auto &fileName : m_files) {
+    WSJournalReader reader(fileName);
+    WSJournalFrame frame;
+
+    while(m_running && reader.next(frame)) {
+      if(m_connectionFilter && frame.connectionId != m_connectionFilter) {
+        continue;
+      }
+
+      if(first) {
+        firstRecorded = frame.timestamp;
+        first = false;
+      }
+
+      if(m_mode != Mode::AsFastAsPossible && frame.timestamp > firstRecorded) {
+        unsigned long target = start + (unsigned long)((frame.timestamp - firstRecorded) / m_speed);
+        if(target > m_clock->now()) { // Do not sleep when we are behind the schedule
+          m_clock->sleepUntil(target);
+        }
+      }
+
+      deliver(frame, m_restamp ? m_clock->now() : frame.timestamp);
+    }
+  }
+
+  m_elapsed = m_clock->now() - start;
+  m_running = false;
+  return m_frames;
+}
+
+}
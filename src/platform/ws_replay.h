@@ -0,0 +1,62 @@
+/***************************************************
+ * ws_replay.h
+ * Created on Sun, 18 Oct 2026 11:34:05 +0000 by agent
+ *
+ * $Author$
+ * $Rev$
+ * $Date$
+ ***************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "clock.h"
+#include "websocket.h"
+#include "ws_journal.h"
+
+namespace platform {
+
+// Feeds frames recorded by WSJournal into a WebSocketConnectionHandler without any sockets.
+// Inbound frames go to onDataReady, outbound ones to onMessageSent, the connection argument is NULL.
+class WSReplay {
+public:
+  enum class Mode {
+    Original = 0,     // Keep recorded gaps between frames
+    Accelerated,      // Recorded gaps divided by speed factor
+    AsFastAsPossible  // No pacing at all
+  };
+
+  WSReplay(WebSocketConnectionHandler *handler, Clock *clock = nullptr);
+
+  void setMode(Mode mode, double speed = 1.0);
+  void setConnectionFilter(uint32_t connectionId); //!< Replay only given connection, 0 replays all
+  void setRestamp(bool restamp); //!< Stamp frames with clock time instead of recorded time
+  void addFile(const std::string &fileName);
+  void stop();
+
+  size_t run(); //!< Replay all added files in order, returns number of delivered frames
+
+  uint64_t getFrames() const { return m_frames; }
+  uint64_t getBytes() const { return m_bytes; }
+  uint64_t getElapsed() const { return m_elapsed; } //!< Clock nanoseconds spent in the last run
+
+private:
+  void deliver(const WSJournalFrame &frame, unsigned long timestamp);
+
+  WebSocketConnectionHandler *m_handler;
+  Clock *m_clock;
+  Mode m_mode;
+  double m_speed;
+  uint32_t m_connectionFilter;
+  bool m_restamp;
+  std::atomic<bool> m_running;
+  std::vector<std::string> m_files;
+  std::vector<char> m_buffer;
+  uint64_t m_frames;
+  uint64_t m_bytes;
+  uint64_t m_elapsed;
+};
+
+}